@@ -2,19 +2,37 @@
 
 namespace Aya {
 	void BVHAccel::construct(const std::vector<Primitive*> &prims) {
+		size_t tri_count = 0;
+		m_meshes.clear();
+		for (auto prim : prims) {
+			m_meshes.push_back(prim->getMesh());
+			tri_count += prim->getMesh()->getTriangleCount();
+		}
+
+		// The layout is chosen up front from the node counts, a binary tree has one inner node
+		// less than leaves, and the build writes straight into it. Both builds share the small
+		// reference list as scratch, full leaves are only made once a subtree is a single triangle
+		const size_t inner_count = tri_count > 0 ? tri_count - 1 : 0;
+		const size_t scratch_bytes = tri_count * sizeof(BVHBuildRef);
+		m_compact = !MemoryTracker::fitsBudget(tri_count * sizeof(BVHLeaf) + inner_count * sizeof(BVHNode) + scratch_bytes);
+		if (m_compact)
+			printf("BVH exceeds the memory budget, building with compact leaves\n");
+
+		m_refs.reserve(tri_count);
 		for (uint32_t i = 0; i < prims.size(); i++) {
 			auto mesh = prims[i]->getMesh();
 			for (uint32_t j = 0; j < mesh->getTriangleCount(); j++) {
-				m_leafs.emplace_back(
-					mesh->getPositionAt(3 * j + 0),
-					mesh->getPositionAt(3 * j + 1),
-					mesh->getPositionAt(3 * j + 2),
-					i,
-					j
-				);
+				BVHBuildRef ref;
+				ref.box = BBox(mesh->getPositionAt(3 * j + 0), mesh->getPositionAt(3 * j + 1));
+				ref.box.unity(mesh->getPositionAt(3 * j + 2));
+				ref.mesh_id = i;
+				ref.tri_id = j;
+				m_refs.push_back(ref);
 			}
 		}
-		construct(&m_root, 0, (int)m_leafs.size() - 1);
+		construct(&m_root, 0, (int)m_refs.size() - 1);
+
+		std::vector<BVHBuildRef>().swap(m_refs);
 		return;
 	}
 	BBox BVHAccel::worldBound() const {
@@ -81,14 +99,14 @@ namespace Aya {
 		}
 		return false;
 	}
-	inline bool xBVHCmp(const BVHLeaf &a, const BVHLeaf &b) {
-		return a.m_box.m_pmin.x < b.m_box.m_pmin.x;
+	inline bool xBVHCmp(const BVHBuildRef &a, const BVHBuildRef &b) {
+		return a.box.m_pmin.x < b.box.m_pmin.x;
 	}
-	inline bool yBVHCmp(const BVHLeaf &a, const BVHLeaf &b) {
-		return a.m_box.m_pmin.y < b.m_box.m_pmin.y;
+	inline bool yBVHCmp(const BVHBuildRef &a, const BVHBuildRef &b) {
+		return a.box.m_pmin.y < b.box.m_pmin.y;
 	}
-	inline bool zBVHCmp(const BVHLeaf &a, const BVHLeaf &b) {
-		return a.m_box.m_pmin.z < b.m_box.m_pmin.z;
+	inline bool zBVHCmp(const BVHBuildRef &a, const BVHBuildRef &b) {
+		return a.box.m_pmin.z < b.box.m_pmin.z;
 	}
 
 	void BVHAccel::construct(BVHNode **node, const int &L, const int &R) {
@@ -96,27 +114,40 @@ namespace Aya {
 			node = NULL;
 			return;
 		}
-		*node = new BVHNode();
 		static int axis;
 		axis = (axis + 1) % 3;
 		switch (axis) {
 		case 0:
-			std::sort(m_leafs.begin() + L, m_leafs.begin() + R + 1, xBVHCmp);
+			std::sort(m_refs.begin() + L, m_refs.begin() + R + 1, xBVHCmp);
 			break;
 		case 1:
-			std::sort(m_leafs.begin() + L, m_leafs.begin() + R + 1, yBVHCmp);
+			std::sort(m_refs.begin() + L, m_refs.begin() + R + 1, yBVHCmp);
 			break;
 		default:
-			std::sort(m_leafs.begin() + L, m_leafs.begin() + R + 1, zBVHCmp);
+			std::sort(m_refs.begin() + L, m_refs.begin() + R + 1, zBVHCmp);
 		}
 
 		if (L == R) {
-			*node = new BVHLeaf(m_leafs[L]);
+			const BVHBuildRef &ref = m_refs[L];
+			const TriangleMesh *mesh = m_meshes[ref.mesh_id];
+			if (m_compact) {
+				void *mem = BulkAllocator::scene().alloc<BVHCompactLeaf>(1, MemoryCategory::Accelerator, alignof(BVHCompactLeaf));
+				*node = new (mem) BVHCompactLeaf(ref.box, mesh, ref.mesh_id, ref.tri_id);
+			}
+			else {
+				void *mem = BulkAllocator::scene().alloc<BVHLeaf>(1, MemoryCategory::Accelerator, alignof(BVHLeaf));
+				*node = new (mem) BVHLeaf(
+					mesh->getPositionAt(3 * ref.tri_id + 0),
+					mesh->getPositionAt(3 * ref.tri_id + 1),
+					mesh->getPositionAt(3 * ref.tri_id + 2),
+					ref.mesh_id, ref.tri_id);
+			}
 			return;
 		}
 
 		int mid = (L + R) >> 1;
-		*node = new BVHNode();
+		void *mem = BulkAllocator::scene().alloc<BVHNode>(1, MemoryCategory::Accelerator, alignof(BVHNode));
+		*node = new (mem) BVHNode();
 		construct(&(*node)->l_l, L, mid);
 		construct(&(*node)->r_l, mid + 1, R);
 		(*node)->unity();
@@ -128,6 +159,7 @@ namespace Aya {
 		if ((*node)->r_l != NULL) {
 			freeNode(&(*node)->r_l);
 		}
-		delete *node;
+		// Nodes live in the scene allocator and are trivially destructible
+		*node = NULL;
 	}
 }
\ No newline at end of file
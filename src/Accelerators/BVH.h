@@ -23,6 +23,13 @@ namespace Aya {
 			n = e1.cross(e2);
 		}
 
+		inline uint32_t getMeshId() const {
+			return mesh_id;
+		}
+		inline uint32_t getTriId() const {
+			return tri_id;
+		}
+
 		AYA_FORCE_INLINE bool intersect(const Ray &ray, Intersection *isect) const {
 			Point3 ori = ray.m_ori;
 			Vector3 dir = ray.m_dir;
@@ -133,11 +140,50 @@ namespace Aya {
 		}
 	};
 
+	// Compact leaf used when the memory budget is tight, the triangle
+	// is rebuilt from the mesh buffers on every test instead of being stored
+	class BVHCompactLeaf : public BVHNode {
+	public:
+		const TriangleMesh *mesh;
+		uint32_t mesh_id, tri_id;
+
+		BVHCompactLeaf(const BBox &box, const TriangleMesh *m, const uint32_t mid, const uint32_t tid) :
+			mesh(m), mesh_id(mid), tri_id(tid) {
+			m_box = box;
+		}
+
+		AYA_FORCE_INLINE BVHTriangle triangle() const {
+			return BVHTriangle(
+				mesh->getPositionAt(3 * tri_id + 0),
+				mesh->getPositionAt(3 * tri_id + 1),
+				mesh->getPositionAt(3 * tri_id + 2),
+				mesh_id, tri_id);
+		}
+		virtual inline bool intersect(const Ray &ray, Intersection * si, bool &is_leaf) const {
+			is_leaf = true;
+			if (!m_box.intersect(ray)) return false;
+			return triangle().intersect(ray, si);
+		}
+		virtual inline bool occluded(const Ray &ray, bool &is_leaf) const {
+			is_leaf = true;
+			if (!m_box.intersect(ray)) return false;
+			return triangle().occluded(ray);
+		}
+	};
+
+	// Build time reference to a triangle, leaves of either layout are made from it
+	struct BVHBuildRef {
+		BBox box;
+		uint32_t mesh_id, tri_id;
+	};
+
 	class BVHAccel : public Accelerator{
 	private:
 		BVHNode *m_root;
 
-		std::vector<BVHLeaf> m_leafs;
+		std::vector<BVHBuildRef> m_refs;
+		std::vector<const TriangleMesh*> m_meshes;
+		bool m_compact;
 
 		bool intersect(BVHNode *node, const Ray &ray, Intersection *si) const;
 		bool occluded(BVHNode *node, const Ray &ray) const;
@@ -145,7 +191,7 @@ namespace Aya {
 		void freeNode(BVHNode **node);
 
 	public:
-		BVHAccel() {}
+		BVHAccel() : m_root(NULL), m_compact(false) {}
 		~BVHAccel() {
 
 		}
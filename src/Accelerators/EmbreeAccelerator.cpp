@@ -6,11 +6,25 @@ namespace Aya {
 #if (AYA_USE_EMBREE == 3)
 		if (!m_device) {
 			m_device = rtcNewDevice(nullptr);
+			rtcSetDeviceMemoryMonitorFunction(m_device, &memoryMonitor, nullptr);
 		}
 		if (!m_rtcScene) {
+			size_t tri_count = 0;
+			for (auto prim : prims)
+				tri_count += prim->getMesh()->getTriangleCount();
+
+			// Spatial splits of the high quality build roughly double the node count,
+			// over the memory budget build a compact BVH without them
 			m_rtcScene = rtcNewScene(m_device);
-			rtcSetSceneBuildQuality(m_rtcScene, RTC_BUILD_QUALITY_HIGH);
-			rtcSetSceneFlags(m_rtcScene, RTC_SCENE_FLAG_ROBUST);
+			if (MemoryTracker::fitsBudget(tri_count * COMPACT_BYTES_PER_TRIANGLE * 2)) {
+				rtcSetSceneBuildQuality(m_rtcScene, RTC_BUILD_QUALITY_HIGH);
+				rtcSetSceneFlags(m_rtcScene, RTC_SCENE_FLAG_ROBUST);
+			}
+			else {
+				printf("Embree BVH exceeds the memory budget, building a compact scene\n");
+				rtcSetSceneBuildQuality(m_rtcScene, RTC_BUILD_QUALITY_MEDIUM);
+				rtcSetSceneFlags(m_rtcScene, RTC_SCENE_FLAG_ROBUST | RTC_SCENE_FLAG_COMPACT);
+			}
 		}
 
 		for (int i = 0; i < prims.size(); i++) {
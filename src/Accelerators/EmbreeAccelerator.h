@@ -67,6 +67,14 @@ namespace Aya {
 		}
 
 #if (AYA_USE_EMBREE == 3) 
+		// Rough size of a compact Embree build per triangle, used for the budget estimate
+		static const size_t COMPACT_BYTES_PER_TRIANGLE = 64;
+
+		static bool memoryMonitor(void *user_ptr, ssize_t bytes, bool post) {
+			MemoryTracker::add(MemoryCategory::Accelerator, int64_t(bytes));
+			return true;
+		}
+
 		static void alphaTest(const struct RTCFilterFunctionNArguments* args) {
 			Primitive *prim = (Primitive*)args->geometryUserPtr;
 
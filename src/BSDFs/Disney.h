@@ -17,7 +17,7 @@ namespace Aya {
 		float m_clearCoatGloss;
 
 	public:
-		Disney(const Spectrum &reflectance,
+		Disney(const StoredSpectrum &reflectance,
 			std::unique_ptr<Texture2D<float>> roughness,
 			std::unique_ptr<Texture2D<float>> specular,
 			float metallic					= 0.0f,
@@ -29,7 +29,7 @@ namespace Aya {
 
 		Vector3 wo = intersection.worldToLocal(v_out), wi;
 
-		float fresnel = fresnelDielectric(CosTheta(wo), m_etai, m_etat);
+		float fresnel = fresnelDielectric(CosTheta(wo), m_etai, DispersedEta(m_etat, m_dispersion));
 		float prob = .5f * fresnel + .25f;
 
 		// reflect
@@ -45,7 +45,7 @@ namespace Aya {
 		// refract
 		else if (sample.w > prob && sample_both || (sample_refract && !sample_both)) {
 			bool entering = CosTheta(wo) > 0.f;
-			float etai = m_etai, etat = m_etat;
+			float etai = m_etai, etat = DispersedEta(m_etat, m_dispersion);
 			if (!entering)
 				std::swap(etai, etat);
 
@@ -7,9 +7,10 @@ namespace Aya {
 	class Glass : public BSDF {
 	private:
 		float m_etai, m_etat;
+		float m_dispersion = 0.f;
 
 	public:
-		Glass(const Spectrum &color = Spectrum(), float etai = 1.0f, float etat = 1.5f)
+		Glass(const StoredSpectrum &color = StoredSpectrum(), float etai = 1.0f, float etat = 1.5f)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_TRANSMISSION | BSDF_SPECULAR), BSDFType::Glass, color)
 			, m_etai(etai), m_etat(etat) {}
 		Glass(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal, float etai = 1.0f, float etat = 1.5f)
@@ -22,6 +23,14 @@ namespace Aya {
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_TRANSMISSION | BSDF_SPECULAR), BSDFType::Glass, texture_file, normal_file)
 			, m_etai(etai), m_etat(etat) {}
 
+		void setDispersion(const float cauchy_b) {
+			m_dispersion = cauchy_b;
+		}
+
+		virtual bool isDispersive() const override {
+			return IsDispersive(m_dispersion);
+		}
+
 		virtual Spectrum f(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types = BSDF_ALL) const override;
 		virtual float pdf(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types = BSDF_ALL) const override;
 		virtual Spectrum sample_f(const Vector3 &v_out, const Sample &sample,
@@ -6,7 +6,7 @@
 namespace Aya {
 	class LambertianDiffuse : public BSDF {
 	public:
-		LambertianDiffuse(const Spectrum &color = Spectrum())
+		LambertianDiffuse(const StoredSpectrum &color = StoredSpectrum())
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_DIFFUSE), BSDFType::LambertianDiffuse, color) {}
 		LambertianDiffuse(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_DIFFUSE), BSDFType::LambertianDiffuse, std::move(tex), std::move(normal)) {}
@@ -6,7 +6,7 @@
 namespace Aya {
 	class Mirror : public BSDF {
 	public:
-		Mirror(const Spectrum &color = Spectrum())
+		Mirror(const StoredSpectrum &color = StoredSpectrum())
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_SPECULAR), BSDFType::Mirror, color) {}
 		Mirror(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_SPECULAR), BSDFType::Mirror, std::move(tex), std::move(normal)) {}
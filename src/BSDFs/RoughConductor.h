@@ -9,7 +9,7 @@ namespace Aya {
 		std::unique_ptr<Texture2D<float>> m_roughness;
 
 	public:
-		RoughConductor(const Spectrum &color = Spectrum(), float roughness = .3f)
+		RoughConductor(const StoredSpectrum &color = StoredSpectrum(), float roughness = .3f)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_GLOSSY), BSDFType::RoughConductor, color),
 			m_roughness(new ConstantTexture2D<float>(roughness)) {}
 		RoughConductor(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal, float roughness = .3f)
@@ -22,7 +22,7 @@ namespace Aya {
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_GLOSSY), BSDFType::RoughConductor, texture_file, normal_file),
 			m_roughness(new ConstantTexture2D<float>(roughness)) {}
 
-		RoughConductor(const Spectrum &color, char *roughness_texture)
+		RoughConductor(const StoredSpectrum &color, char *roughness_texture)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_GLOSSY), BSDFType::RoughConductor, color),
 			m_roughness(new ImageTexture2D<float, float>(roughness_texture)) {}
 		RoughConductor(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal, char *roughness_texture)
@@ -35,7 +35,7 @@ namespace Aya {
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_GLOSSY), BSDFType::RoughConductor, texture_file, normal_file),
 			m_roughness(new ImageTexture2D<float, float>(roughness_texture)) {}
 
-		RoughConductor(const Spectrum &color, std::unique_ptr<Texture2D<float>> roughness)
+		RoughConductor(const StoredSpectrum &color, std::unique_ptr<Texture2D<float>> roughness)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_GLOSSY), BSDFType::RoughConductor, color),
 			m_roughness(std::move(roughness)) {}
 		RoughConductor(std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal, std::unique_ptr<Texture2D<float>> roughness)
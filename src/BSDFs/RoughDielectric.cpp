@@ -33,7 +33,7 @@ namespace Aya {
 			if (!sample_refract)
 				return 0.f;
 
-			float etai = m_etai, etat = m_etat;
+			float etai = m_etai, etat = DispersedEta(m_etat, m_dispersion);
 			if (!entering)
 				std::swap(etai, etat);
 
@@ -52,7 +52,7 @@ namespace Aya {
 		roughness = roughness * roughness;
 		float wh_prob = GGX_Pdf_VisibleNormal(wo * (CosTheta(wo) >= 0.f ? 1.f : -1.f), wh, roughness);
 		if (sample_reflect && sample_refract) {
-			float F = fresnelDielectric(wo.dot(wh), m_etai, m_etat);
+			float F = fresnelDielectric(wo.dot(wh), m_etai, DispersedEta(m_etat, m_dispersion));
 			//F = 0.5f * F + 0.25f;
 			wh_prob *= reflect ? F : 1.f - F;
 		}
@@ -81,7 +81,7 @@ namespace Aya {
 		bool reflect = fac > 0.f;
 		bool entering = OdotN > 0.f;
 
-		float etai = m_etai, etat = m_etat;
+		float etai = m_etai, etat = DispersedEta(m_etat, m_dispersion);
 		if (!entering)
 			std::swap(etai, etat);
 
@@ -113,7 +113,7 @@ namespace Aya {
 		if (D == 0.f)
 			return 0.f;
 
-		float F = fresnelDielectric(wo.dot(wh), m_etai, m_etat);
+		float F = fresnelDielectric(wo.dot(wh), m_etai, DispersedEta(m_etat, m_dispersion));
 		float G = GGX_G(wo, wi, wh, roughness);
 
 		if (reflect) {
@@ -161,7 +161,7 @@ namespace Aya {
 		if (D == 0.f)
 			return 0.f;
 
-		float F = fresnelDielectric(wo.dot(wh), m_etai, m_etat);
+		float F = fresnelDielectric(wo.dot(wh), m_etai, DispersedEta(m_etat, m_dispersion));
 		float prob = F;
 
 		Vector3 wi;
@@ -187,7 +187,7 @@ namespace Aya {
 				Abs(F * D * G / (4.f * CosTheta(wi) * CosTheta(wo)));
 		}
 		else if (sample.w > prob && sample_both || (sample_refract && !sample_both)) { // Sample refraction
-			float eta = m_etat / m_etai;
+			float eta = DispersedEta(m_etat, m_dispersion) / m_etai;
 			float odoth = -wo.dot(wh);
 			if (odoth < 0.f)
 				eta = 1.f / eta;
@@ -211,7 +211,7 @@ namespace Aya {
 
 			*pdf = !sample_both ? microfacet_pdf : microfacet_pdf * (1.f - prob);
 			bool entering = CosTheta(wo) > 0.f;
-			float etai = m_etai, etat = m_etat;
+			float etai = m_etai, etat = DispersedEta(m_etat, m_dispersion);
 			if (!entering)
 				std::swap(etai, etat);
 
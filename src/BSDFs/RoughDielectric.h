@@ -8,12 +8,13 @@ namespace Aya {
 	private:
 		std::unique_ptr<Texture2D<float>> m_roughness;
 		float m_etai, m_etat;
+		float m_dispersion = 0.f;
 
 		static const ScatterType reflect_scatter = ScatterType(BSDF_REFLECTION | BSDF_GLOSSY);
 		static const ScatterType refract_scatter = ScatterType(BSDF_TRANSMISSION | BSDF_GLOSSY);
 
 	public:
-		RoughDielectric(const Spectrum &color = Spectrum(), float roughness = .3f, float etai = 1.0f, float etat = 1.5f)
+		RoughDielectric(const StoredSpectrum &color = StoredSpectrum(), float roughness = .3f, float etai = 1.0f, float etat = 1.5f)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_TRANSMISSION | BSDF_GLOSSY), BSDFType::RoughDielectric, color),
 			m_roughness(new ConstantTexture2D<float>(roughness)),
 			m_etai(etai), m_etat(etat) {}
@@ -30,7 +31,7 @@ namespace Aya {
 			m_roughness(new ConstantTexture2D<float>(roughness)),
 			m_etai(etai), m_etat(etat) {}
 
-		RoughDielectric(const Spectrum &color, char *roughness_texture, float etai = 1.0f, float etat = 1.5f)
+		RoughDielectric(const StoredSpectrum &color, char *roughness_texture, float etai = 1.0f, float etat = 1.5f)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_TRANSMISSION | BSDF_GLOSSY), BSDFType::RoughDielectric, color),
 			m_roughness(new ImageTexture2D<float, float>(roughness_texture)),
 			m_etai(etai), m_etat(etat) {}
@@ -47,7 +48,7 @@ namespace Aya {
 			m_roughness(new ImageTexture2D<float, float>(roughness_texture)),
 			m_etai(etai), m_etat(etat) {}
 
-		RoughDielectric(const Spectrum &color, std::unique_ptr<Texture2D<float>> roughness, float etai = 1.0f, float etat = 1.5f)
+		RoughDielectric(const StoredSpectrum &color, std::unique_ptr<Texture2D<float>> roughness, float etai = 1.0f, float etat = 1.5f)
 			: BSDF(ScatterType(BSDF_REFLECTION | BSDF_TRANSMISSION | BSDF_GLOSSY), BSDFType::RoughDielectric, color),
 			m_roughness(std::move(roughness)),
 			m_etai(etai), m_etat(etat) {}
@@ -64,6 +65,14 @@ namespace Aya {
 			m_roughness(std::move(roughness)),
 			m_etai(etai), m_etat(etat) {}
 
+		void setDispersion(const float cauchy_b) {
+			m_dispersion = cauchy_b;
+		}
+
+		virtual bool isDispersive() const override {
+			return IsDispersive(m_dispersion);
+		}
+
 		virtual Spectrum f(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types = BSDF_ALL) const override;
 		virtual float pdf(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types = BSDF_ALL) const override;
 		virtual Spectrum sample_f(const Vector3 &v_out, const Sample &sample,
@@ -1,17 +1,17 @@
 #include <Core/BSDF.h>
 
 namespace Aya {
-	BSDF::BSDF(ScatterType t1, BSDFType t2, const Spectrum &color)
-		: m_scatterType(t1), m_bsdfType(t2), mp_texture(new ConstantTexture2D<Spectrum>(color)) {}
+	BSDF::BSDF(ScatterType t1, BSDFType t2, const StoredSpectrum &color)
+		: m_scatterType(t1), m_bsdfType(t2), mp_texture(new ConstantTexture2D<Spectrum, StoredSpectrum>(color)) {}
 	BSDF::BSDF(ScatterType t1, BSDFType t2, std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal)
 		: m_scatterType(t1), m_bsdfType(t2), 
 		mp_texture(std::move(tex)), mp_normalMap(std::move(normal)) {}
 	BSDF::BSDF(ScatterType t1, BSDFType t2, const char *texture_file)
 		: m_scatterType(t1), m_bsdfType(t2),
-		mp_texture(new ImageTexture2D<Spectrum, byteSpectrum>(texture_file)) {}
+		mp_texture(new ImageTexture2D<Spectrum, sRGB8Spectrum>(texture_file)) {}
 	BSDF::BSDF(ScatterType t1, BSDFType t2, const char *texture_file, const char *normal_file)
 		: m_scatterType(t1), m_bsdfType(t2) , 
-		mp_texture(new ImageTexture2D<Spectrum, byteSpectrum>(texture_file)), 
+		mp_texture(new ImageTexture2D<Spectrum, sRGB8Spectrum>(texture_file)), 
 		mp_normalMap(new ImageTexture2D<RGBSpectrum, byteSpectrum>(normal_file, 1.f)) {}
 
 	Spectrum BSDF::f(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types) const {
@@ -137,13 +137,13 @@ namespace Aya {
 		// Special case (normal incidence)
 		if (theta < 1e-4f) {
 			float r = Sqrt(Max(u1 / ((1.f - u1) + 1e-6f), 0.f));
-			float sin_phi = std::sinf(2.f * float(M_PI) * u2);
-			float cos_phi = std::cosf(2.f * float(M_PI) * u2);
+			float sin_phi = std::sin(2.f * float(M_PI) * u2);
+			float cos_phi = std::cos(2.f * float(M_PI) * u2);
 			return Vector2f(r * cos_phi, r * sin_phi);
 		}
 
 		// Precomputations
-		float tan_theta = std::tanf(theta);
+		float tan_theta = std::tan(theta);
 		float a = 1.f / tan_theta;
 		float G1 = 2.f / (1.f + Sqrt(Max(1.f + 1.f / (a * a), 0.f)));
 
@@ -193,11 +193,11 @@ namespace Aya {
 		// Get polar coordinates
 		float theta = 0.f, phi = 0.f;
 		if (wi.z < float(0.99999f)) {
-			theta = std::acosf(wi.z);
-			phi = std::atan2f(wi.y, wi.x);
+			theta = std::acos(wi.z);
+			phi = std::atan2(wi.y, wi.x);
 		}
-		float sin_phi = std::sinf(phi);
-		float cos_phi = std::cosf(phi);
+		float sin_phi = std::sin(phi);
+		float cos_phi = std::cos(phi);
 
 		// Simulate P22_{wi}(Slope.x, Slope.y, 1, 1)
 		Vector2f slope = ImportanceSampleGGX_VisibleNormal_Unit(theta, u1, u2);
@@ -50,6 +50,26 @@ namespace Aya {
 	AYA_FORCE_INLINE bool sameHemisphere(const Vector3 &v1, const Vector3 &v2) {
 		return v1.z * v2.z > 0.f;
 	}
+	// Cauchy dispersion, eta is given at the sodium D line and cauchy_b in square micrometers.
+	// Only the hero wavelength follows the refracted direction, integrators terminate the
+	// others when they hit a dispersive BSDF
+	AYA_FORCE_INLINE bool IsDispersive(const float cauchy_b) {
+#if defined(AYA_HERO_SPECTRUM)
+		return cauchy_b != 0.f;
+#else
+		return false;
+#endif
+	}
+	AYA_FORCE_INLINE float DispersedEta(const float eta, const float cauchy_b) {
+#if defined(AYA_HERO_SPECTRUM)
+		if (cauchy_b == 0.f)
+			return eta;
+		const float lambda = SampledWavelengths::current().lambda[0] * 1e-3f;
+		return eta + cauchy_b * (1.f / (lambda * lambda) - 1.f / (.5893f * .5893f));
+#else
+		return eta;
+#endif
+	}
 
 	enum ScatterType {
 		BSDF_REFLECTION =	1 << 0,
@@ -89,7 +109,7 @@ namespace Aya {
 		std::unique_ptr<Texture2D<RGBSpectrum>> mp_normalMap;
 
 	public:
-		BSDF(ScatterType t1, BSDFType t2, const Spectrum &color);
+		BSDF(ScatterType t1, BSDFType t2, const StoredSpectrum &color);
 		BSDF(ScatterType t1, BSDFType t2, std::unique_ptr<Texture2D<Spectrum>> tex, std::unique_ptr<Texture2D<RGBSpectrum>> normal);
 		BSDF(ScatterType t1, BSDFType t2, const char *texture_file);
 		BSDF(ScatterType t1, BSDFType t2, const char *texture_file, const char *normal_file);
@@ -101,14 +121,18 @@ namespace Aya {
 		bool isSpecular() const {
 			return (ScatterType(BSDF_SPECULAR | BSDF_DIFFUSE | BSDF_GLOSSY) & m_scatterType) == ScatterType(BSDF_SPECULAR);
 		}
+		// Scatters each wavelength differently, see DispersedEta
+		virtual bool isDispersive() const {
+			return false;
+		}
 		void setNormalMap(const char *normal_file) {
 			mp_normalMap = std::make_unique<ImageTexture2D<RGBSpectrum, byteSpectrum>>(normal_file, 1.f);
 		}
 		void setTexture(const char *image_file) {
-			mp_texture = std::make_unique<ImageTexture2D<Spectrum, byteSpectrum>>(image_file);
+			mp_texture = std::make_unique<ImageTexture2D<Spectrum, sRGB8Spectrum>>(image_file);
 		}
-		void setTexture(const Spectrum &color) {
-			mp_texture = std::make_unique<ConstantTexture2D<Spectrum>>(color);
+		void setTexture(const StoredSpectrum &color) {
+			mp_texture = std::make_unique<ConstantTexture2D<Spectrum, StoredSpectrum>>(color);
 		}
 
 		virtual Spectrum f(const Vector3 &v_out, const Vector3 &v_in, const SurfaceIntersection &intersection, ScatterType types = BSDF_ALL) const;
@@ -139,6 +139,10 @@ namespace Aya {
 		ray->m_ryDir = (cam_coord + m_dyCam).normalize();
 		ray->m_hasDifferentials = true;
 
+		// Spread of a pixel, the chord approximates the angle
+		const Vector3 pinhole_dir = cam_coord.normalize();
+		ray->m_cone = RayCone(0.f, Max((ray->m_rxDir - pinhole_dir).length(), (ray->m_ryDir - pinhole_dir).length()));
+
 		*ray = m_viewInv(*ray);
 		ray->m_mint = float(AYA_RAY_EPS);
 		ray->m_maxt = float(INFINITY - AYA_RAY_EPS);
@@ -5,14 +5,15 @@
 //#define AYA_DEBUG
 #include <iostream>
 
-#ifdef _WIN32
-#if  defined(__GNUC__)	// it should handle both MINGW and CYGWIN
+#if defined(__GNUC__) || defined(__clang__)	// GCC and Clang on Linux, also handles MINGW and CYGWIN
 #define AYA_FORCE_INLINE        __inline__ __attribute__((always_inline))
+#define AYA_ALIGN(n)             __attribute__((aligned(n)))
 #define ATTRIBUTE_ALIGNED16(a)   a __attribute__((aligned(16)))
 #define ATTRIBUTE_ALIGNED64(a)   a __attribute__((aligned(64)))
 #define ATTRIBUTE_ALIGNED128(a)  a __attribute__((aligned(128)))
 #elif ( defined(_MSC_VER) && _MSC_VER < 1300 )
 #define SIMD_FORCE_INLINE inline
+#define AYA_ALIGN(n)
 #define ATTRIBUTE_ALIGNED16(a) a
 #define ATTRIBUTE_ALIGNED64(a) a
 #define ATTRIBUTE_ALIGNED128(a) a
@@ -25,17 +26,35 @@
 //			#pragma warning(disable:4786) // Disable the "debug name too long" warning
 
 #define AYA_FORCE_INLINE __forceinline
+#define AYA_ALIGN(n) __declspec(align(n))
 #define ATTRIBUTE_ALIGNED16(a) __declspec(align(16)) a
 #define ATTRIBUTE_ALIGNED64(a) __declspec(align(64)) a
 #define ATTRIBUTE_ALIGNED128(a) __declspec (align(128)) a
 #endif
-#endif
 
-#if (defined(_WIN32) && (_MSC_VER) && _MSC_VER >= 1400)
-#if _MSC_VER > 1400
-// Enable SIMD acceleration option (suggested)
+// Enable SIMD acceleration option (suggested with MSVC), define AYA_NO_SIMD to get the scalar fallbacks.
+// GCC and Clang vectorize the scalar Vector3 and Transform code as well as the intrinsics,
+// there SIMD is opt-in with -DAYA_USE_SIMD and mainly speeds up Matrix4x4::inverse.
+// SSE2 is the x64 baseline, wider paths are selected at compile time from /arch or -march
+#if !defined(AYA_NO_SIMD)
+#if defined(_MSC_VER) && _MSC_VER > 1400
 #define AYA_USE_SIMD
 #endif
+#else
+#undef AYA_USE_SIMD
+#endif
+
+// 256 bit integer paths, requires building with /arch:AVX2 or -mavx2. They do not use
+// the SIMD math types, so they do not depend on AYA_USE_SIMD
+#if !defined(AYA_NO_SIMD) && defined(__AVX2__)
+#define AYA_USE_AVX2
+#endif
+
+// Goes between the class key and the name of the vector math types
+#if defined(AYA_USE_SIMD)
+#define AYA_SIMD_ALIGN AYA_ALIGN(16)
+#else
+#define AYA_SIMD_ALIGN
 #endif
 
 // Math library only
@@ -46,6 +65,12 @@
 
 // Core/Spectrum
 //#define AYA_SAMPLED_SPECTRUM
+// Carry a few sampled wavelengths per path, takes precedence over AYA_SAMPLED_SPECTRUM
+//#define AYA_HERO_SPECTRUM
+
+// Core/Texture
+// Keep eagerly built mip levels in 4x4 Morton ordered blocks instead of rows
+//#define AYA_BLOCKED_TEXELS
 
 // Core/Memory
 #define AYA_L1_CACHE_LINE_SIZE 64
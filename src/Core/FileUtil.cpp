@@ -0,0 +1,226 @@
+#include <Core/FileUtil.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Aya {
+	MappedFile::MappedFile()
+		: mp_data(nullptr)
+		, m_size(0)
+#if defined(_WIN32)
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(nullptr)
+#endif
+	{}
+
+	bool MappedFile::open(const char *path) {
+		close();
+#if defined(_WIN32)
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) {
+			close();
+			return false;
+		}
+		mp_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!mp_data) {
+			close();
+			return false;
+		}
+		m_size = size_t(size.QuadPart);
+#else
+		const int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		// The mapping stays valid after the descriptor is closed
+		void *ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (ptr == MAP_FAILED)
+			return false;
+		mp_data = (const uint8_t*)ptr;
+		m_size = size_t(st.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::close() {
+#if defined(_WIN32)
+		if (mp_data)
+			UnmapViewOfFile(mp_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (mp_data)
+			munmap((void*)mp_data, m_size);
+#endif
+		mp_data = nullptr;
+		m_size = 0;
+	}
+
+	static uint64_t HashBytes(const uint8_t *data, const size_t size) {
+		uint64_t h = MixBits(uint64_t(size));
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			h = MixBits(h ^ word) + 0x9e3779b97f4a7c15ULL;
+		}
+		uint64_t tail = 0;
+		memcpy(&tail, data + i, size - i);
+		return MixBits(h ^ tail);
+	}
+
+	bool FileStat(const char *path, uint64_t *mtime, uint64_t *size) {
+#if defined(_WIN32)
+		struct _stat64 st;
+		if (_stat64(path, &st) != 0)
+			return false;
+#else
+		struct stat st;
+		if (stat(path, &st) != 0)
+			return false;
+#endif
+		*mtime = uint64_t(st.st_mtime);
+		*size = uint64_t(st.st_size);
+		return true;
+	}
+
+	bool FileHash(const char *path, uint64_t *hash) {
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		*hash = HashBytes(file.data(), file.size());
+		return true;
+	}
+
+	const std::string& UserCacheDir() {
+		static const std::string dir = []() {
+#if defined(_WIN32)
+			const char *base = getenv("LOCALAPPDATA");
+			if (!base || !base[0])
+				return std::string();
+			const std::string path = std::string(base) + "\\Aya";
+			_mkdir(path.c_str());
+#else
+			const char *xdg = getenv("XDG_CACHE_HOME");
+			const char *home = getenv("HOME");
+			std::string base;
+			if (xdg && xdg[0])
+				base = xdg;
+			else if (home && home[0]) {
+				base = std::string(home) + "/.cache";
+				mkdir(base.c_str(), 0755);
+			}
+			else
+				return std::string();
+			const std::string path = base + "/aya";
+			mkdir(path.c_str(), 0755);
+#endif
+			struct stat st;
+			if (stat(path.c_str(), &st) != 0 || !(st.st_mode & S_IFDIR))
+				return std::string();
+			return path;
+		}();
+		return dir;
+	}
+
+	std::string FallbackCachePath(const std::string &path) {
+		const std::string &dir = UserCacheDir();
+		if (dir.empty())
+			return std::string();
+
+		// Relative paths are made absolute, the same name from two directories must not collide
+		std::string absolute = path;
+#if defined(_WIN32)
+		char full[MAX_PATH];
+		if (_fullpath(full, path.c_str(), MAX_PATH))
+			absolute = full;
+		const char separator = '\\';
+#else
+		char cwd[4096];
+		if (path[0] != '/' && getcwd(cwd, sizeof(cwd)))
+			absolute = std::string(cwd) + "/" + path;
+		const char separator = '/';
+#endif
+		const size_t slash = path.find_last_of("/\\");
+		const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+		char prefix[20];
+		snprintf(prefix, sizeof(prefix), "%016llx-", (unsigned long long)HashBytes((const uint8_t*)absolute.data(), absolute.size()));
+		return dir + separator + prefix + name;
+	}
+
+	// Unique among the processes and threads writing next to each other
+	static std::string TempPath(const std::string &path) {
+		static std::atomic<uint32_t> counter(0);
+#if defined(_WIN32)
+		const unsigned long pid = GetCurrentProcessId();
+#else
+		const unsigned long pid = (unsigned long)getpid();
+#endif
+		const uint64_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), ".%lu.%llx.%u.tmp", pid, (unsigned long long)thread, counter.fetch_add(1));
+		return path + suffix;
+	}
+
+	static bool WriteReplace(const std::string &path, const std::function<bool(FILE*)> &write_file) {
+		const std::string temp_path = TempPath(path);
+		FILE *fp = fopen(temp_path.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		bool ok = write_file(fp);
+		ok = (fclose(fp) == 0) && ok;
+#if defined(_WIN32)
+		ok = ok && MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = ok && rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+		if (!ok)
+			remove(temp_path.c_str());
+		return ok;
+	}
+
+	std::string WriteCacheFile(const std::string &path, const std::function<bool(FILE*)> &write_file) {
+		if (WriteReplace(path, write_file))
+			return path;
+
+		const std::string fallback = FallbackCachePath(path);
+		if (!fallback.empty() && WriteReplace(fallback, write_file))
+			return fallback;
+		return std::string();
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef AYA_CORE_FILEUTIL_H
+#define AYA_CORE_FILEUTIL_H
+
+#include <Core/Config.h>
+#include <Math/MathUtility.h>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+
+namespace Aya {
+	// Read only view of a whole file, the OS pages it in on access
+	class MappedFile {
+	private:
+		const uint8_t *mp_data;
+		size_t m_size;
+#if defined(_WIN32)
+		void *m_file, *m_mapping;
+#endif
+
+	public:
+		MappedFile();
+		~MappedFile() {
+			close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		bool open(const char *path);
+		void close();
+
+		inline const uint8_t* data() const {
+			return mp_data;
+		}
+		inline size_t size() const {
+			return m_size;
+		}
+	};
+
+	// Modification time and size of a file, false if it does not exist
+	bool FileStat(const char *path, uint64_t *mtime, uint64_t *size);
+	// Hash of the contents, tells a touched but unchanged file from a changed one
+	bool FileHash(const char *path, uint64_t *hash);
+
+	// Where caches of sources in read only directories go, %LOCALAPPDATA%\Aya on Windows and
+	// $XDG_CACHE_HOME/aya or ~/.cache/aya elsewhere. Created on first use, empty if unavailable
+	const std::string& UserCacheDir();
+	// Name of the cache file path in the user cache directory, prefixed by a hash of the
+	// absolute path so equal names from different directories stay apart. Empty without one
+	std::string FallbackCachePath(const std::string &path);
+	// Writes a cache file aside under a name unique to the process, thread and call, then
+	// renames it over path, so concurrent writers and readers never see a partial file. Falls
+	// back to FallbackCachePath when path cannot be written, returns the path written or empty
+	std::string WriteCacheFile(const std::string &path, const std::function<bool(FILE*)> &write_file);
+}
+
+#endif
\ No newline at end of file
@@ -1,6 +1,78 @@
 #include <Core/Film.h>
+#include <Core/FileUtil.h>
+
+#include <cstdio>
+#include <string>
 
 namespace Aya {
+	struct CheckpointHeader {
+		char magic[4];
+		uint32_t version;
+		int32_t width, height;
+		uint32_t sample_count;
+		uint32_t pass_index;
+		uint32_t pixel_size;
+		uint32_t compressed;
+		uint32_t payload_words;
+		uint32_t checksum;
+		// Tiles of pass_index already rendered when it was cut short, one byte each after the payload
+		uint32_t tile_count;
+	};
+	static const char CHECKPOINT_MAGIC[4] = { 'A', 'Y', 'C', 'K' };
+	static const uint32_t CHECKPOINT_VERSION = 3;
+
+	static uint32_t CheckpointChecksum(const uint32_t *data, const size_t count, const std::vector<uint8_t> &tiles) {
+		// FNV-1a over the raw pixel words, then the tile flags
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < count; i++) {
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+		for (size_t i = 0; i < tiles.size(); i++) {
+			hash ^= tiles[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Zero-run encoding on 32-bit words, accumulation buffers are dominated by
+	// black pixels and empty splat channels.
+	// Stream layout: [literal count][literals...][zero count] repeated
+	static void CompressWords(const uint32_t *data, const size_t count, std::vector<uint32_t> &out) {
+		size_t i = 0;
+		while (i < count) {
+			size_t lit_start = i;
+			while (i < count && !(data[i] == 0 && i + 1 < count && data[i + 1] == 0))
+				i++;
+			out.push_back(uint32_t(i - lit_start));
+			out.insert(out.end(), data + lit_start, data + i);
+
+			size_t zero_start = i;
+			while (i < count && data[i] == 0)
+				i++;
+			out.push_back(uint32_t(i - zero_start));
+		}
+	}
+	static bool DecompressWords(const uint32_t *data, const size_t count, uint32_t *out, const size_t out_count) {
+		size_t i = 0, o = 0;
+		while (i < count) {
+			uint32_t literals = data[i++];
+			if (i + literals > count || o + literals > out_count)
+				return false;
+			memcpy(out + o, data + i, literals * sizeof(uint32_t));
+			i += literals;
+			o += literals;
+
+			if (i >= count)
+				return false;
+			uint32_t zeros = data[i++];
+			if (o + zeros > out_count)
+				return false;
+			memset(out + o, 0, zeros * sizeof(uint32_t));
+			o += zeros;
+		}
+		return o == out_count;
+	}
 
 	const float Film::INV_GAMMA = .454545f;
 		
@@ -18,6 +90,8 @@ namespace Aya {
 		m_accumulateBuffer.free();
 		m_accumulateBuffer.init(width, height);
 		m_sampleCount = 0;
+
+		m_trackedMemory.set(size_t(width) * size_t(height) * (sizeof(RGBSpectrum) + sizeof(Pixel)));
 	}
 	void Film::clear() {
 		std::lock_guard<std::mutex> lck(m_mt);
@@ -25,7 +99,7 @@ namespace Aya {
 		concurrency::parallel_for(0, m_height, [this](int y) {
 			for (int x = 0; x < m_width; x++) {
 				Pixel &pixel = m_accumulateBuffer(x, y);
-				pixel = { Spectrum(0.f), Spectrum(0.f), 0.f };
+				pixel = { StoredSpectrum(0.f), StoredSpectrum(0.f), 0.f, 0.f, 0.f, 0 };
 			}
 		});
 
@@ -35,9 +109,10 @@ namespace Aya {
 		m_sampleCount = 0;
 		m_pixelBuffer.free();
 		m_accumulateBuffer.free();
+		m_trackedMemory.set(0);
 	}
 
-	void Film::addSample(float x, float y, const Spectrum& L) {
+	void Film::addSample(float x, float y, const StoredSpectrum &L) {
 		std::lock_guard<std::mutex> lck(m_mt);
 
 		x -= .5f;
@@ -55,6 +130,34 @@ namespace Aya {
 				pixel.color += weight * L;
 			}
 		}
+
+		accumulateStatistics(x + .5f, y + .5f, L);
+	}
+
+	void Film::accumulateStatistics(float x, float y, const StoredSpectrum &L) {
+		int xx = Clamp((int)std::floor(x), 0, m_width - 1);
+		int yy = Clamp((int)std::floor(y), 0, m_height - 1);
+		Pixel &pixel = m_accumulateBuffer(xx, m_height - 1 - yy);
+
+		const float lum = L.luminance();
+		pixel.samples++;
+		const float delta = lum - pixel.mean;
+		pixel.mean += delta / float(pixel.samples);
+		pixel.m2 += delta * (lum - pixel.mean);
+	}
+
+	// Lock free, the statistics of a pixel are only written by the tile that owns it
+	// and read by the same worker between its samples
+	float Film::getRelativeError(int x, int y) const {
+		const Pixel &pixel = m_accumulateBuffer(x, m_height - 1 - y);
+		if (pixel.samples < 2)
+			return float(INFINITY);
+
+		// Standard error of the mean relative to the mean itself,
+		// offset so that near black pixels do not dominate
+		const float variance = pixel.m2 / float(pixel.samples - 1);
+		const float std_error = std::sqrt(variance / float(pixel.samples));
+		return std_error / (pixel.mean + 1e-3f);
 	}
 
 	void Film::addFilm(const Film *film, float weight) {
@@ -69,13 +172,22 @@ namespace Aya {
 				pixel.color += pixel0.color * weight;
 				pixel.weight += pixel0.weight * weight;
 				pixel.splat += pixel0.splat * weight;
+
+				// Chan et al. parallel merge of the running statistics
+				const uint32_t n = pixel.samples + pixel0.samples;
+				if (n > 0) {
+					const float delta = pixel0.mean - pixel.mean;
+					pixel.m2 += pixel0.m2 + delta * delta * float(pixel.samples) * float(pixel0.samples) / float(n);
+					pixel.mean += delta * float(pixel0.samples) / float(n);
+					pixel.samples = n;
+				}
 			}
 		});
 
 		m_sampleCount += film->m_sampleCount;
 	}
 
-	void Film::splat(float x, float y, const Spectrum& L) {
+	void Film::splat(float x, float y, const StoredSpectrum &L) {
 		std::lock_guard<std::mutex> lck(m_mt);
 
 		int xx = Clamp((int)std::floor(x), 0, m_width - 1);
@@ -92,7 +204,7 @@ namespace Aya {
 				Pixel pixel = m_accumulateBuffer(x, y);
 				pixel.color.clamp();
 
-				Spectrum L = ((Spectrum)(
+				RGBSpectrum L = ((StoredSpectrum)(
 					pixel.color / (pixel.weight + float(AYA_EPSILON)) + pixel.splat / splat_scale
 					).pow(INV_GAMMA)).toRGBSpectrum().clamp(0.f, 1.f);
 				L[3] = 1.f;
@@ -101,4 +213,153 @@ namespace Aya {
 			}
 		});
 	}
+
+	void Film::resolveLinear(std::vector<float> *rgba, const float ss) const {
+		std::lock_guard<std::mutex> lck(m_mt);
+
+		float splat_scale = ss > 0.f ? ss : m_sampleCount;
+		rgba->resize(4 * size_t(m_width) * size_t(m_height));
+
+		concurrency::parallel_for(0, m_height, [this, splat_scale, rgba](int y) {
+			for (int x = 0; x < m_width; x++) {
+				Pixel pixel = m_accumulateBuffer(x, y);
+				pixel.color.clamp();
+
+				RGBSpectrum L = StoredSpectrum(
+					pixel.color / (pixel.weight + float(AYA_EPSILON)) + pixel.splat / splat_scale
+					).toRGBSpectrum();
+				float *dst = rgba->data() + 4 * (size_t(y) * m_width + x);
+				dst[0] = L[0];
+				dst[1] = L[1];
+				dst[2] = L[2];
+				dst[3] = 1.f;
+			}
+		});
+	}
+
+	bool Film::saveCheckpoint(const char *path, const uint32_t pass_index, const std::vector<uint8_t> &tiles_done, const bool compress) const {
+		static_assert(sizeof(Pixel) % sizeof(uint32_t) == 0, "Pixel must be word sized");
+
+		CheckpointHeader header;
+		memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+		header.version = CHECKPOINT_VERSION;
+		header.width = m_width;
+		header.height = m_height;
+		header.pass_index = pass_index;
+		header.pixel_size = sizeof(Pixel);
+		header.compressed = compress ? 1 : 0;
+		header.tile_count = uint32_t(tiles_done.size());
+
+		// Snapshot under the lock, the disk write happens outside of it
+		const size_t raw_words = size_t(m_width) * size_t(m_height) * sizeof(Pixel) / sizeof(uint32_t);
+		std::vector<uint32_t> raw(raw_words);
+		{
+			std::lock_guard<std::mutex> lck(m_mt);
+			memcpy(raw.data(), m_accumulateBuffer.data(), raw_words * sizeof(uint32_t));
+			header.sample_count = m_sampleCount;
+		}
+		header.checksum = CheckpointChecksum(raw.data(), raw.size(), tiles_done);
+
+		std::vector<uint32_t> packed;
+		if (compress) {
+			packed.reserve(raw_words / 4);
+			CompressWords(raw.data(), raw.size(), packed);
+		}
+		const std::vector<uint32_t> &payload = compress ? packed : raw;
+		header.payload_words = uint32_t(payload.size());
+
+		const std::string written = WriteCacheFile(path, [&](FILE *fp) {
+			return std::fwrite(&header, sizeof(header), 1, fp) == 1 &&
+				std::fwrite(payload.data(), sizeof(uint32_t), payload.size(), fp) == payload.size() &&
+				std::fwrite(tiles_done.data(), 1, tiles_done.size(), fp) == tiles_done.size();
+		});
+		if (written.empty()) {
+			printf("Failed to write checkpoint file: %s\n", path);
+			return false;
+		}
+
+		printf("Checkpoint saved: %s (%d spp(s), %.1f MB)\n", written.c_str(), header.sample_count,
+			float(sizeof(header) + payload.size() * sizeof(uint32_t)) / (1024.f * 1024.f));
+		return true;
+	}
+
+	// Reads and validates one checkpoint file, a truncated, padded or
+	// corrupted file is rejected as a whole
+	static bool ReadCheckpoint(const char *path, const int width, const int height, const size_t pixel_size,
+		CheckpointHeader *header, std::vector<uint32_t> *raw, std::vector<uint8_t> *tiles) {
+		FILE *fp = std::fopen(path, "rb");
+		if (!fp)
+			return false;
+
+		if (std::fread(header, sizeof(*header), 1, fp) != 1 ||
+			memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != CHECKPOINT_VERSION ||
+			header->pixel_size != pixel_size ||
+			header->width != width || header->height != height) {
+			printf("Incompatible checkpoint file: %s\n", path);
+			std::fclose(fp);
+			return false;
+		}
+
+		const size_t raw_words = size_t(width) * size_t(height) * pixel_size / sizeof(uint32_t);
+		if (header->payload_words > 2 * raw_words + 2) {
+			printf("Corrupted checkpoint file: %s\n", path);
+			std::fclose(fp);
+			return false;
+		}
+
+		std::vector<uint32_t> payload(header->payload_words);
+		tiles->resize(header->tile_count);
+		bool ok = std::fread(payload.data(), sizeof(uint32_t), payload.size(), fp) == payload.size() &&
+			std::fread(tiles->data(), 1, tiles->size(), fp) == tiles->size() &&
+			std::fgetc(fp) == EOF;
+		std::fclose(fp);
+
+		if (ok) {
+			if (header->compressed) {
+				raw->resize(raw_words);
+				ok = DecompressWords(payload.data(), payload.size(), raw->data(), raw->size());
+			}
+			else {
+				ok = payload.size() == raw_words;
+				raw->swap(payload);
+			}
+		}
+		if (!ok || CheckpointChecksum(raw->data(), raw->size(), *tiles) != header->checksum) {
+			printf("Corrupted checkpoint file: %s\n", path);
+			return false;
+		}
+		return true;
+	}
+
+	bool Film::loadCheckpoint(const char *path, uint32_t *pass_index, std::vector<uint8_t> *tiles_done) {
+		// The user cache directory holds the checkpoint when path could not be written
+		CheckpointHeader header;
+		std::vector<uint32_t> raw;
+		std::vector<uint8_t> tiles;
+		std::string read_path;
+		for (const std::string &candidate : { std::string(path), FallbackCachePath(path) }) {
+			if (!candidate.empty() && ReadCheckpoint(candidate.c_str(), m_width, m_height, sizeof(Pixel), &header, &raw, &tiles)) {
+				read_path = candidate;
+				break;
+			}
+		}
+		if (read_path.empty())
+			return false;
+
+		const size_t raw_words = raw.size();
+		// Merge through a filterless film so the usual accumulation rules apply
+		Film checkpoint(m_width, m_height, nullptr);
+		memcpy(checkpoint.m_accumulateBuffer.data(), raw.data(), raw_words * sizeof(uint32_t));
+		checkpoint.m_sampleCount = header.sample_count;
+		addFilm(&checkpoint);
+
+		if (pass_index)
+			*pass_index = header.pass_index;
+		if (tiles_done)
+			tiles_done->swap(tiles);
+
+		printf("Checkpoint resumed: %s (%d spp(s))\n", read_path.c_str(), header.sample_count);
+		return true;
+	}
 }
\ No newline at end of file
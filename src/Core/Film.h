@@ -10,14 +10,21 @@
 #include <ppl.h>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 namespace Aya {
 	class Film {
 	protected :
 		struct Pixel {
-			Spectrum color;
-			Spectrum splat;
+			// Accumulated in the stored representation, paths may carry their own wavelengths
+			StoredSpectrum color;
+			StoredSpectrum splat;
 			float weight;
+
+			// Running luminance statistics (Welford) for adaptive sampling
+			float mean;
+			float m2;
+			uint32_t samples;
 		};
 
 		int m_width, m_height;
@@ -25,11 +32,14 @@ namespace Aya {
 		BlockedArray<RGBSpectrum> m_pixelBuffer;
 		BlockedArray<Pixel> m_accumulateBuffer;
 		std::unique_ptr<Filter> mp_filter;
+		MemoryTracker::Entry m_trackedMemory{ MemoryCategory::Film };
 
 		mutable std::mutex m_mt;
 
 		static const float INV_GAMMA;
 
+		void accumulateStatistics(float x, float y, const StoredSpectrum &L);
+
 	public:
 		Film() = default;
 		Film(int width, int height, Filter *filter) {
@@ -50,10 +60,11 @@ namespace Aya {
 			return { m_width, m_height };
 		}
 
-		virtual void addSample(float x, float y, const Spectrum &L);
+		// Samples come converted with ToStored at the wavelengths of their path
+		virtual void addSample(float x, float y, const StoredSpectrum &L);
 		virtual void addFilm(const Film *film, float weight = 1.f);
-		virtual void splat(float x, float y, const Spectrum &L);
-		void updateDisplay(const float splat_scale = 0.f);
+		virtual void splat(float x, float y, const StoredSpectrum &L);
+		virtual void updateDisplay(const float splat_scale = 0.f);
 		inline void addSampleCount() {
 			++m_sampleCount;
 			printf("\033[01;31m %d spp(s) \033[0m is rendered\n", m_sampleCount);
@@ -62,20 +73,56 @@ namespace Aya {
 		const RGBSpectrum* getPixelBuffer() const {
 			return m_pixelBuffer.data();
 		}
-		const Spectrum getPixel(int x, int y) const {
+		// Linear RGBA without gamma or clamping, rows ordered like the pixel buffer
+		void resolveLinear(std::vector<float> *rgba, const float splat_scale = 0.f) const;
+		const StoredSpectrum getPixel(int x, int y) const {
 			const Pixel &pixel = m_accumulateBuffer(x, y);
 			return pixel.color / (pixel.weight + float(AYA_EPSILON)) + pixel.splat / static_cast<float>(m_sampleCount);
 		}
-		void setPixel(int x, int y, const Spectrum &L) {
+		void setPixel(int x, int y, const StoredSpectrum &L) {
 			Pixel &pixel = m_accumulateBuffer(x, y);
 			pixel.color = L;
 			pixel.weight = 1.f;
-			pixel.splat = Spectrum(0.f);
+			pixel.splat = StoredSpectrum(0.f);
+			pixel.mean = L.luminance();
+			pixel.m2 = 0.f;
+			pixel.samples = 1;
 		}
 		const int getSampleCount() const {
 			return m_sampleCount;
 		}
+		float getFilterRadius() const {
+			return mp_filter ? mp_filter->getRadius() : 0.f;
+		}
+		void setSampleCount(const uint32_t count) {
+			m_sampleCount = count;
+		}
+
+		// Adaptive sampling queries, (x, y) in raster space
+		uint32_t getPixelSampleCount(int x, int y) const {
+			return m_accumulateBuffer(x, m_height - 1 - y).samples;
+		}
+		float getRelativeError(int x, int y) const;
 		virtual void denoise() {}
+
+		// Tiled mode, a tiled film only keeps the tiles between beginTile and endTile
+		// resident, integrators render such a film tile by tile instead of pass by pass
+		virtual bool isTiled() const {
+			return false;
+		}
+		virtual void beginTile(const int min_x, const int min_y, const int max_x, const int max_y) {}
+		virtual void endTile(const int min_x, const int min_y, const int max_x, const int max_y) {}
+		virtual void finish(const float splat_scale = 0.f) {}
+
+		// Checkpointing, the accumulated buffers and sample count are written through
+		// WriteCacheFile so a killed job never leaves a torn file or loses the last one.
+		// A checksum covers the pixels and tile flags, damaged files are not loaded.
+		// Loading merges the checkpoint into the current buffers like addFilm.
+		// pass_index counts the finished passes, tiles_done flags the tiles of the
+		// next pass already in the buffers when it was aborted, empty otherwise
+		bool saveCheckpoint(const char *path, const uint32_t pass_index,
+			const std::vector<uint8_t> &tiles_done = std::vector<uint8_t>(), const bool compress = true) const;
+		bool loadCheckpoint(const char *path, uint32_t *pass_index, std::vector<uint8_t> *tiles_done = nullptr);
 	};
 }
 
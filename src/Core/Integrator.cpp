@@ -1,53 +1,210 @@
-#include <Core/integrator.h>
+#include <Core/Integrator.h>
 
 namespace Aya {
+	void TiledIntegrator::samplePixel(const int x, const int y, const uint32_t sample_idx, const Scene *scene, const Camera *camera,
+		Sampler *tile_sampler, Film *film, RNG &rng, MemoryPool &memory) const {
+		MemoryPool::Scope memory_scope(memory);
+
+		rng.srand(HashSeed(x, y, sample_idx, SeedPurpose::Integrator));
+		tile_sampler->startPixel(x, y);
+		CameraSample cam_sample;
+		tile_sampler->generateSamples(x, y, &cam_sample, rng);
+		SampledWavelengths wavelengths;
+#if defined(AYA_HERO_SPECTRUM)
+		wavelengths = SampledWavelengths::sampleUniform(tile_sampler->get1D());
+		SampledWavelengths::current() = wavelengths;
+#endif
+		cam_sample.image_x += x;
+		cam_sample.image_y += y;
+
+		RayDifferential ray;
+		Spectrum L(0.f);
+		if (camera->generateRayDifferential(cam_sample, &ray)) {
+			L = li(ray, scene, tile_sampler, rng, memory, wavelengths);
+		}
+
+		film->addSample(cam_sample.image_x, cam_sample.image_y, ToStored(L, wavelengths));
+	}
+
+	void TiledIntegrator::renderTiles(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
+		m_task.beginRender();
+		// Both need the whole film resident, refuse instead of rendering something else than asked
+		const bool checkpointing = !m_checkpointPath.empty() && m_checkpointInterval > 0;
+		assert(!m_adaptive && !checkpointing);
+		if (m_adaptive || checkpointing) {
+			printf("Error: adaptive sampling and checkpoints are not available with a tiled film\n");
+			return;
+		}
+
+		int tiles_count = m_task.getTilesCount();
+		SamplerPool samplers(sampler);
+
+		concurrency::parallel_for(0, tiles_count, [&](int i) {
+			const RenderTile& tile = m_task.getTile(i);
+
+			if (m_task.checkDeadline())
+				return;
+
+			film->beginTile(tile.min_x, tile.min_y, tile.max_x, tile.max_y);
+
+			// One sampler per tile, advanced per pass like the progressive path
+			Sampler *tile_sampler = samplers.acquire(i);
+
+			RNG rng;
+			MemoryPool::Lease memory_lease;
+			MemoryPool &memory = memory_lease.pool();
+
+			for (uint32_t spp = 0; spp < m_spp && !m_task.aborted(); spp++) {
+				for (int y = tile.min_y; y < tile.max_y; ++y) {
+					for (int x = tile.min_x; x < tile.max_x; ++x) {
+						samplePixel(x, y, spp, scene, camera, tile_sampler, film, rng, memory);
+					}
+				}
+				tile_sampler->advanceSampleIndex();
+			}
+
+			film->endTile(tile.min_x, tile.min_y, tile.max_x, tile.max_y);
+		});
+
+		for (uint32_t spp = 0; spp < m_spp; spp++)
+			sampler->advanceSampleIndex();
+
+		film->setSampleCount(m_spp);
+		film->finish();
+
+		MemoryPool::printStatistics();
+		TextureCache::get().printStatistics();
+		MemoryTracker::printStatistics();
+	}
+
 	void TiledIntegrator::render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
-		for (uint32_t spp = 0; spp < m_spp; spp++) {
+		if (film->isTiled()) {
+			renderTiles(scene, camera, sampler, film);
+			return;
+		}
+
+		m_task.beginRender();
+		const uint32_t max_spp = m_adaptive ? m_maxSpp : m_spp;
+		const int color_stride = TaskSynchronizer::getColorStride(film->getFilterRadius());
+		float pass_cost = 0.f;
+		SamplerPool samplers(sampler);
+
+		// Resume from a previous checkpoint, the sampler is advanced past the
+		// passes already in the film so no sample pattern is repeated.
+		// Tiles an aborted pass finished are skipped when that pass is run again
+		uint32_t start_pass = 0;
+		std::vector<uint8_t> tiles_done;
+		const bool checkpointing = !m_checkpointPath.empty() && m_checkpointInterval > 0;
+		if (checkpointing && film->loadCheckpoint(m_checkpointPath.c_str(), &start_pass, &tiles_done)) {
+			for (uint32_t i = 0; i < start_pass; i++)
+				sampler->advanceSampleIndex();
+			film->updateDisplay();
+		}
+		if (tiles_done.size() != size_t(m_task.getTilesCount()))
+			tiles_done.assign(m_task.getTilesCount(), 0);
+
+		for (uint32_t spp = start_pass; spp < max_spp; spp++) {
 			int tiles_count = m_task.getTilesCount();
 			int height = m_task.getX();
 			int width = m_task.getY();
 
-			concurrency::parallel_for(0, tiles_count, [&](int i) {
-			//for (int i = 0; i < tiles_count; i++) {
+			// Do not start a pass that cannot finish before the deadline,
+			// the samples already in the film are the best image we can return
+			if (m_task.hasTimeBudget() && spp > start_pass) {
+				const float remaining = m_task.remainingTime();
+				if (remaining < pass_cost) {
+					if (checkpointing)
+						film->saveCheckpoint(m_checkpointPath.c_str(), spp);
+					break;
+				}
+			}
+			const auto pass_start = std::chrono::steady_clock::now();
+
+			// Once every pixel has its minimum sample count, converged pixels are skipped
+			const bool adaptive_pass = m_adaptive && spp >= m_minSpp;
+			std::atomic<int> active_pixels(0);
+
+			auto render_tile = [&](int i) {
 				const RenderTile& tile = m_task.getTile(i);
 
-				std::unique_ptr<Sampler> tile_sampler(sampler->clone(spp * tiles_count + i));
+				if (tiles_done[i] || m_task.checkDeadline())
+					return;
+
+				if (adaptive_pass) {
+					bool tile_converged = true;
+					for (int y = tile.min_y; y < tile.max_y && tile_converged; ++y)
+						for (int x = tile.min_x; x < tile.max_x && tile_converged; ++x)
+							tile_converged = pixelConverged(film, x, y);
+
+					if (tile_converged) {
+						tiles_done[i] = 1;
+						return;
+					}
+				}
+
+				Sampler *tile_sampler = samplers.acquire(spp * tiles_count + i);
 
 				RNG rng;
-				MemoryPool memory;
+				MemoryPool::Lease memory_lease;
+				MemoryPool &memory = memory_lease.pool();
 
+				// A started tile always finishes, abort is only honoured between tiles so
+				// the checkpoint never holds a partial tile the resume would sample again
 				for (int y = tile.min_y; y < tile.max_y; ++y) {
 					for (int x = tile.min_x; x < tile.max_x; ++x) {
-						if (m_task.aborted())
-							return;
-
-						tile_sampler->startPixel(x, y);
-						CameraSample cam_sample;
-						tile_sampler->generateSamples(x, y, &cam_sample, rng);
-						cam_sample.image_x += x;
-						cam_sample.image_y += y;
-
-						RayDifferential ray;
-						Spectrum L(0.f);
-						if (camera->generateRayDifferential(cam_sample, &ray)) {
-							L = li(ray, scene, tile_sampler.get(), rng, memory);
-						}
+						if (adaptive_pass && pixelConverged(film, x, y))
+							continue;
 
-						film->addSample(cam_sample.image_x, cam_sample.image_y, L);
-						memory.freeAll();
+						samplePixel(x, y, spp, scene, camera, tile_sampler, film, rng, memory);
+						active_pixels++;
 					}
 				}
-			//}
-			});
+				tiles_done[i] = 1;
+			};
+
+			// Filter footprints of tiles with the same color never overlap, running the colors
+			// one after another gives every pixel the same accumulation order on any thread count.
+			// Each color ends in a barrier, workers idle while the last tiles of a color finish.
+			// Splats land in pixels of other tiles in arrival order, integrators that splat
+			// such as BDPT are therefore not reproducible across thread counts
+			for (int color = 0; color < color_stride * color_stride; color++) {
+				concurrency::parallel_for(0, tiles_count, [&](int i) {
+					if (m_task.getTileColor(i, color_stride) == color)
+						render_tile(i);
+				});
+			}
+
+			// Exponential moving average of the pass wall time, one slow or fast pass
+			// does not swing the estimate of how many more fit
+			const float pass_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - pass_start).count();
+			pass_cost = pass_cost > 0.f ? Lerp(.3f, pass_cost, pass_time) : pass_time;
+
+			// A pass cut short by abort is not counted, the checkpoint records
+			// which of its tiles are in the film and the resume renders the rest
+			if (m_task.aborted()) {
+				film->updateDisplay();
+				if (checkpointing)
+					film->saveCheckpoint(m_checkpointPath.c_str(), spp, tiles_done);
+				break;
+			}
 
 			sampler->advanceSampleIndex();
+			std::fill(tiles_done.begin(), tiles_done.end(), 0);
 
 			film->addSampleCount();
 			film->updateDisplay();
 
-			if (m_task.aborted())
+			const bool last_pass = spp + 1 == max_spp || (adaptive_pass && active_pixels == 0);
+			if (checkpointing && ((spp + 1 - start_pass) % m_checkpointInterval == 0 || last_pass))
+				film->saveCheckpoint(m_checkpointPath.c_str(), spp + 1);
+
+			if (adaptive_pass && active_pixels == 0)
 				break;
 		}
+
+		MemoryPool::printStatistics();
+		TextureCache::get().printStatistics();
+		MemoryTracker::printStatistics();
 	}
 
 	Spectrum Integrator::estimateDirectLighting(const Scatter &scatter, const Vector3 &out, const Light *light,
@@ -166,7 +323,7 @@ namespace Aya {
 	}
 
 	Spectrum Integrator::specularReflect(const TiledIntegrator *integrator, const Scene *scene, Sampler *sampler, const RayDifferential &ray,
-		const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory) {
+		const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory, SampledWavelengths &wavelengths) {
 		const Point3 &pos = intersection.p;
 		const Normal3 &norm = intersection.n;
 		const BSDF *bsdf = intersection.bsdf;
@@ -198,7 +355,7 @@ namespace Aya {
 				rd.m_ryDir = in - doutdy + 2.0f * (out.dot(norm) * dndy + dcosdy * norm);
 			}
 
-			Spectrum L = integrator->li(rd, scene, sampler, rng, memory);
+			Spectrum L = integrator->li(rd, scene, sampler, rng, memory, wavelengths);
 			color = f * L * Abs(in.dot(norm)) / pdf;
 		}
 
@@ -206,7 +363,7 @@ namespace Aya {
 	}
 
 	Spectrum Integrator::specularTransmit(const TiledIntegrator *integrator, const Scene *scene, Sampler *sampler, const RayDifferential &ray,
-		const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory) {
+		const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory, SampledWavelengths &wavelengths) {
 		const Point3 &pos = intersection.p;
 		const Normal3 &norm = intersection.n;
 		const BSDF *bsdf = intersection.bsdf;
@@ -247,7 +404,7 @@ namespace Aya {
 				rd.m_ryDir = in + eta * doutdy - (mu * dndy + dmudy * norm);
 			}
 
-			Spectrum L = integrator->li(rd, scene, sampler, rng, memory);
+			Spectrum L = integrator->li(rd, scene, sampler, rng, memory, wavelengths);
 			color = f * L * Abs(in.dot(norm)) / pdf;
 		}
 
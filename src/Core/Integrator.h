@@ -11,6 +11,9 @@
 #include <Core/BSDF.h>
 
 #include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
 #include <ppl.h>
 
 namespace Aya {
@@ -27,7 +30,12 @@ namespace Aya {
 		int m_x, m_y;
 		std::vector<RenderTile> m_tiles;
 
-		bool m_abort;
+		// Written by the owner thread, polled by the render workers
+		mutable std::atomic<bool> m_abort;
+
+		// Wall-clock budget, the deadline is fixed when the budget is set
+		bool m_hasBudget;
+		std::chrono::steady_clock::time_point m_deadline;
 
 	public:
 		TaskSynchronizer(const int x, const int y) {
@@ -39,6 +47,7 @@ namespace Aya {
 			m_y = y;
 			m_tiles.clear();
 			m_abort = false;
+			m_hasBudget = false;
 
 			for (int i = 0; i < y; i += RenderTile::TILE_SIZE) {
 				for (int j = 0; j < x; j += RenderTile::TILE_SIZE) {
@@ -59,6 +68,16 @@ namespace Aya {
 		inline int getTilesCount() const {
 			return (int)m_tiles.size();
 		}
+		// Coloring of the tile grid, tiles of one color are stride tiles apart so the filter
+		// footprints of their pixels never overlap. Radii up to about TILE_SIZE / 2 give 2x2 colors
+		static int getColorStride(const float filter_radius) {
+			const int reach = (int)std::ceil(filter_radius + .5f);
+			return 1 + (2 * reach + RenderTile::TILE_SIZE - 1) / RenderTile::TILE_SIZE;
+		}
+		inline int getTileColor(const int idx, const int stride) const {
+			const RenderTile &tile = getTile(idx);
+			return (tile.min_x / RenderTile::TILE_SIZE) % stride + stride * ((tile.min_y / RenderTile::TILE_SIZE) % stride);
+		}
 		inline int getX() const {
 			return m_x;
 		}
@@ -66,10 +85,38 @@ namespace Aya {
 			return m_y;
 		}
 		inline void setAbort(const bool ab) {
-			m_abort = ab;
+			m_abort.store(ab, std::memory_order_relaxed);
 		}
 		inline const bool aborted() const {
-			return m_abort;
+			return m_abort.load(std::memory_order_relaxed);
+		}
+		// Clears the abort of a previous render, called as a render starts
+		inline void beginRender() const {
+			m_abort.store(false, std::memory_order_relaxed);
+		}
+
+		inline void setTimeBudget(const float seconds) {
+			m_hasBudget = true;
+			m_deadline = std::chrono::steady_clock::now() +
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(seconds));
+		}
+		inline void clearTimeBudget() {
+			m_hasBudget = false;
+		}
+		inline bool hasTimeBudget() const {
+			return m_hasBudget;
+		}
+		inline float remainingTime() const {
+			if (!m_hasBudget)
+				return float(INFINITY);
+			return std::chrono::duration<float>(m_deadline - std::chrono::steady_clock::now()).count();
+		}
+		// Raises the abort flag once the deadline has passed,
+		// meant to be polled at tile granularity
+		inline bool checkDeadline() const {
+			if (m_hasBudget && !aborted() && std::chrono::steady_clock::now() >= m_deadline)
+				m_abort.store(true, std::memory_order_relaxed);
+			return aborted();
 		}
 	};
 
@@ -88,25 +135,85 @@ namespace Aya {
 		virtual void render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) = 0;
 		virtual ~Integrator() {}
 
+		// Only integrators that render in whole passes over the film can checkpoint,
+		// the others refuse the option instead of silently running without it
+		virtual bool setCheckpoint(const char *path, const uint32_t interval_passes) {
+			if (path && *path && interval_passes > 0) {
+				printf("Checkpoints are not supported by this integrator\n");
+				return false;
+			}
+			return true;
+		}
+
 	public:
 		static Spectrum estimateDirectLighting(const Scatter &scatter, const Vector3 &out, const Light *light,
 			const Scene *scene, Sampler *sampler, ScatterType scatter_type = ScatterType(BSDF_ALL & ~BSDF_SPECULAR));
 		static Spectrum specularReflect(const TiledIntegrator *integrator, const Scene *scene, Sampler *sampler, const RayDifferential &ray,
-			const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory);
+			const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory, SampledWavelengths &wavelengths);
 		static Spectrum specularTransmit(const TiledIntegrator *integrator, const Scene *scene, Sampler *sampler, const RayDifferential &ray,
-			const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory);
+			const SurfaceIntersection &intersection, RNG &rng, MemoryPool &memory, SampledWavelengths &wavelengths);
 	};
 
 	class TiledIntegrator : public Integrator {
 	protected:
+		// Adaptive sampling, every pixel receives at least m_minSpp samples,
+		// after that only pixels whose relative error is above m_errorThreshold
+		// keep sampling until m_maxSpp is reached
+		bool m_adaptive;
+		uint32_t m_minSpp, m_maxSpp;
+		float m_errorThreshold;
+
+		// Periodic film checkpoint, resumed at the start of render if present
+		std::string m_checkpointPath;
+		uint32_t m_checkpointInterval;
+
+		bool pixelConverged(const Film *film, const int x, const int y) const {
+			return film->getPixelSampleCount(x, y) >= m_minSpp &&
+				film->getRelativeError(x, y) <= m_errorThreshold;
+		}
+
+		void samplePixel(const int x, const int y, const uint32_t sample_idx, const Scene *scene, const Camera *camera,
+			Sampler *tile_sampler, Film *film, RNG &rng, MemoryPool &memory) const;
+		// Tile by tile rendering for films that only keep in-flight tiles resident
+		void renderTiles(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film);
 
 	public:
 		TiledIntegrator(const TaskSynchronizer &task, const uint32_t &spp)
-			: Integrator(task, spp) {
+			: Integrator(task, spp), m_adaptive(false), m_minSpp(0), m_maxSpp(0), m_errorThreshold(0.f),
+			m_checkpointInterval(0) {
+		}
+
+		// Splats are normalized by the film sample count, skipping converged camera samples would
+		// darken them, so integrators that splat refuse adaptive sampling
+		bool setAdaptive(const uint32_t min_spp, const uint32_t max_spp, const float threshold) {
+			assert(min_spp <= max_spp);
+			if (usesSplats()) {
+				printf("Adaptive sampling is not supported by integrators that splat to the film\n");
+				return false;
+			}
+			m_adaptive = true;
+			m_minSpp = Max(min_spp, 2u);
+			m_maxSpp = Max(max_spp, m_minSpp);
+			m_errorThreshold = threshold;
+			return true;
+		}
+		void disableAdaptive() {
+			m_adaptive = false;
+		}
+		virtual bool setCheckpoint(const char *path, const uint32_t interval_passes) override {
+			m_checkpointPath = path ? path : "";
+			m_checkpointInterval = interval_passes;
+			return true;
 		}
 
 		virtual void render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) override;
-		virtual Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG& rng, MemoryPool &memory) const = 0;
+		// True when li also splats to other pixels of the film, e.g. light tracing
+		virtual bool usesSplats() const {
+			return false;
+		}
+		// Radiance along a ray at the wavelengths of its sample, which a dispersive hit may terminate
+		virtual Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG& rng, MemoryPool &memory,
+			SampledWavelengths &wavelengths) const = 0;
 		virtual ~TiledIntegrator() {}
 	};
 }
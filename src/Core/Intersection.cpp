@@ -8,16 +8,31 @@ namespace Aya {
 
 	void SurfaceIntersection::computeDifferentials(const RayDifferential& ray) const {
 		do {
-			if (!ray.m_hasDifferentials) break;
+			Vector3 v_px, v_py;
+			if (ray.m_hasDifferentials) {
+				float d = -n.dot(p);
+				float tx = -(n.dot(ray.m_rxOri) + d) / n.dot(ray.m_rxDir);
+				if (std::isnan(tx)) break;
+				float ty = -(n.dot(ray.m_ryOri) + d) / n.dot(ray.m_ryDir);
+				if (std::isnan(ty)) break;
 
-			float d = -n.dot(p);
-			float tx = -(n.dot(ray.m_rxOri) + d) / n.dot(ray.m_rxDir);
-			if (std::isnan(tx)) break;
-			float ty = -(n.dot(ray.m_ryOri) + d) / n.dot(ray.m_ryDir);
-			if (std::isnan(ty)) break;
-
-			Vector3 v_px = ray.m_rxOri + ray.m_rxDir * tx;
-			Vector3 v_py = ray.m_ryOri + ray.m_ryDir * ty;
+				v_px = ray.m_rxOri + ray.m_rxDir * tx;
+				v_py = ray.m_ryOri + ray.m_ryDir * ty;
+			}
+			else if (ray.m_cone.isValid()) {
+				// Cone cross section projected along the ray, stretched at grazing angles
+				const float cos_in = n.dot(ray.m_dir);
+				if (Abs(cos_in) < 1e-4f) break;
+				const float width = ray.m_cone.widthAt(dist);
+				Vector3 cx, cy;
+				BaseVector3::coordinateSystem(ray.m_dir, &cx, &cy);
+				cx *= width;
+				cy *= width;
+				v_px = p + cx - ray.m_dir * (n.dot(cx) / cos_in);
+				v_py = p + cy - ray.m_dir * (n.dot(cy) / cos_in);
+			}
+			else
+				break;
 
 			dpdx = v_px - p;
 			dpdy = v_py - p;
@@ -70,4 +85,12 @@ namespace Aya {
 		dpdx = dpdy = Vector3(0.f);
 		dudx = dudy = dvdx = dvdy = 0.f;
 	}
+
+	RayCone SurfaceIntersection::scatterCone(const RayCone &cone, const bool specular, const float pdf) const {
+		const float width = cone.widthAt(dist);
+		float spread = cone.m_spread + 2.f * curvature * width;
+		if (!specular)
+			spread += RayCone::footprint(pdf);
+		return RayCone(width, Min(spread, float(M_PI)));
+	}
 }
\ No newline at end of file
@@ -79,6 +79,8 @@ namespace Aya {
 
 		mutable Vector3 dpdx, dpdy;
 		mutable float dudx, dudy, dvdx, dvdy;
+		// Change of the shading normal per unit length, widens ray cones
+		float curvature;
 
 		Frame frame;
 
@@ -87,7 +89,7 @@ namespace Aya {
 
 	public:
 		SurfaceIntersection()
-			: dudx(0.f), dudy(0.f), dvdx(0.f), dvdy(0.f) {}
+			: dudx(0.f), dudy(0.f), dvdx(0.f), dvdy(0.f), curvature(0.f) {}
 
 		inline Vector3 worldToLocal(const Vector3 &vec) const {
 			return frame.worldToLocal(vec);
@@ -97,7 +99,11 @@ namespace Aya {
 		}
 
 		Spectrum emit(const Vector3& dir) const;
+		// From the differentials of the ray, or from its cone past the first hit
 		void computeDifferentials(const RayDifferential& ray) const;
+		// Cone of a ray scattered here, widened by the curvature and unless
+		// specular by the footprint of the lobe sampled with solid angle pdf
+		RayCone scatterCone(const RayCone &cone, const bool specular, const float pdf) const;
 
 		bool isSurfaceScatter() const override {
 			return true;
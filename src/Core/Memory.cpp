@@ -1,8 +1,211 @@
 #include <Core/Memory.h>
 
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
 namespace Aya {
+	void *AllocAligned(size_t size, size_t alignment) {
+#if defined(_WIN32)
+		return _aligned_malloc(size, alignment);
+#else
+		void *ptr = nullptr;
+		if (posix_memalign(&ptr, alignment, size) != 0)
+			return nullptr;
+		return ptr;
+#endif
+	}
+
 	void FreeAligned(void *ptr) {
 		if (!ptr) return;
+#if defined(_WIN32)
 		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	// Every pool ever leased, the free ones are also on the free list
+	static std::mutex PoolRegistryLock;
+	static std::vector<std::unique_ptr<MemoryPool>> PoolRegistry;
+	static std::vector<MemoryPool*> FreePools;
+
+	MemoryPool* MemoryPool::acquire() {
+		std::lock_guard<std::mutex> lck(PoolRegistryLock);
+		if (FreePools.empty()) {
+			PoolRegistry.emplace_back(std::make_unique<MemoryPool>());
+			return PoolRegistry.back().get();
+		}
+
+		MemoryPool *pool = FreePools.back();
+		FreePools.pop_back();
+		return pool;
+	}
+
+	void MemoryPool::release(MemoryPool *pool) {
+		pool->freeAll();
+
+		std::lock_guard<std::mutex> lck(PoolRegistryLock);
+		FreePools.push_back(pool);
+	}
+
+	void MemoryPool::printStatistics() {
+		std::lock_guard<std::mutex> lck(PoolRegistryLock);
+
+		size_t reserved = 0, high_water = 0;
+		for (auto &pool : PoolRegistry) {
+			reserved += pool->getReservedBytes();
+			high_water = Max(high_water, pool->getHighWater());
+		}
+		printf("Memory pools: %d pool(s), %.1f KB reserved, %.1f KB high water per pool\n",
+			int(PoolRegistry.size()), reserved / 1024.f, high_water / 1024.f);
+	}
+
+	static std::atomic<int64_t> TrackedBytes[size_t(MemoryCategory::Count)];
+	static std::atomic<size_t> MemoryBudget(0);
+
+	void MemoryTracker::add(const MemoryCategory category, const int64_t bytes) {
+		assert(category < MemoryCategory::Count);
+		TrackedBytes[size_t(category)].fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	size_t MemoryTracker::getBytes(const MemoryCategory category) {
+		return size_t(Max(TrackedBytes[size_t(category)].load(std::memory_order_relaxed), int64_t(0)));
+	}
+
+	size_t MemoryTracker::getTotalBytes() {
+		size_t total = 0;
+		for (int i = 0; i < int(MemoryCategory::Count); i++)
+			total += getBytes(MemoryCategory(i));
+		return total;
+	}
+
+	void MemoryTracker::setBudget(const size_t bytes) {
+		MemoryBudget = bytes;
+	}
+
+	size_t MemoryTracker::getBudget() {
+		return MemoryBudget;
+	}
+
+	bool MemoryTracker::fitsBudget(const size_t bytes) {
+		const size_t budget = MemoryBudget;
+		return budget == 0 || getTotalBytes() + bytes <= budget;
+	}
+
+	const char* MemoryTracker::categoryName(const MemoryCategory category) {
+		switch (category) {
+		case MemoryCategory::Geometry:
+			return "Geometry";
+		case MemoryCategory::Accelerator:
+			return "Accelerator";
+		case MemoryCategory::Texture:
+			return "Texture";
+		case MemoryCategory::Distribution:
+			return "Distribution";
+		case MemoryCategory::Film:
+			return "Film";
+		case MemoryCategory::Integrator:
+			return "Integrator";
+		default:
+			return "Unknown";
+		}
+	}
+
+	void MemoryTracker::printStatistics() {
+		const float MB = 1024.f * 1024.f;
+		printf("Memory usage:\n");
+		for (int i = 0; i < int(MemoryCategory::Count); i++)
+			printf("  %-14s %8.2f MB\n", categoryName(MemoryCategory(i)), getBytes(MemoryCategory(i)) / MB);
+
+		const size_t budget = getBudget();
+		if (budget > 0)
+			printf("  %-14s %8.2f MB of %.2f MB budget\n", "Total", getTotalBytes() / MB, budget / MB);
+		else
+			printf("  %-14s %8.2f MB\n", "Total", getTotalBytes() / MB);
+	}
+
+	BulkAllocator::BulkAllocator(const size_t chunk_size)
+		: m_chunkSize((chunk_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1))
+		, m_offset(0)
+		, m_reserved(0) {
+		for (auto &bytes : m_bytes)
+			bytes = 0;
+	}
+
+	void *BulkAllocator::allocBytes(const size_t size, const MemoryCategory category, const size_t alignment) {
+		assert(category < MemoryCategory::Count);
+		assert((alignment & (alignment - 1)) == 0);
+		if (size == 0)
+			return nullptr;
+
+		std::lock_guard<std::mutex> lck(m_mt);
+
+		size_t offset = m_chunks.empty() ? 0 : (m_offset + alignment - 1) & ~(alignment - 1);
+		if (m_chunks.empty() || offset + size > m_chunks.back().size) {
+			// Oversized requests get a dedicated chunk rounded up to whole huge pages
+			const size_t chunk_size = Max(m_chunkSize, (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+			uint8_t *ptr = (uint8_t*)AllocAligned(chunk_size, HUGE_PAGE_SIZE);
+			if (!ptr) {
+				printf("Bulk allocator failed to reserve %.1f MB\n", chunk_size / (1024.f * 1024.f));
+				return nullptr;
+			}
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+			// Only a hint, the kernel falls back to regular pages when THP is disabled
+			madvise(ptr, chunk_size, MADV_HUGEPAGE);
+#endif
+			Chunk chunk = { ptr, chunk_size };
+			if (!m_chunks.empty() && chunk_size > m_chunkSize) {
+				// Keep bumping through the partially used chunk
+				m_chunks.insert(m_chunks.end() - 1, chunk);
+				m_reserved += chunk_size;
+				m_bytes[size_t(category)].fetch_add(size, std::memory_order_relaxed);
+				MemoryTracker::add(category, int64_t(size));
+				return ptr;
+			}
+			m_chunks.push_back(chunk);
+			m_reserved += chunk_size;
+			offset = 0;
+		}
+
+		m_offset = offset + size;
+		m_bytes[size_t(category)].fetch_add(size, std::memory_order_relaxed);
+		MemoryTracker::add(category, int64_t(size));
+		return m_chunks.back().ptr + offset;
+	}
+
+	void BulkAllocator::release() {
+		std::lock_guard<std::mutex> lck(m_mt);
+		for (auto &chunk : m_chunks)
+			FreeAligned(chunk.ptr);
+		m_chunks.clear();
+		m_offset = 0;
+		m_reserved = 0;
+		for (int i = 0; i < int(MemoryCategory::Count); i++)
+			MemoryTracker::add(MemoryCategory(i), -int64_t(m_bytes[i].exchange(0)));
+	}
+
+	size_t BulkAllocator::getReservedBytes() const {
+		std::lock_guard<std::mutex> lck(m_mt);
+		return m_reserved;
+	}
+
+	void BulkAllocator::printStatistics() const {
+		const float MB = 1024.f * 1024.f;
+		size_t used = 0;
+		for (int i = 0; i < int(MemoryCategory::Count); i++)
+			used += getBytes(MemoryCategory(i));
+		printf("Scene allocator: %.2f MB used, %.2f MB reserved in huge page chunks\n",
+			used / MB, getReservedBytes() / MB);
+	}
+
+	BulkAllocator& BulkAllocator::scene() {
+		static BulkAllocator allocator;
+		return allocator;
 	}
-}
\ No newline at end of file
+}
@@ -2,13 +2,16 @@
 #define AYA_CORE_MEMORY_H
 
 #include <Core/Config.h>
+#include <Math/MathUtility.h>
 
 #include <atomic>
+#include <mutex>
 #include <vector>
 
 namespace Aya {
-	template<typename T> AYA_FORCE_INLINE T *AllocAligned(uint32_t count) {
-		return (T *)_aligned_malloc(count * sizeof(T), AYA_L1_CACHE_LINE_SIZE);
+	void *AllocAligned(size_t size, size_t alignment);
+	template<typename T> AYA_FORCE_INLINE T *AllocAligned(size_t count) {
+		return (T *)AllocAligned(count * sizeof(T), AYA_L1_CACHE_LINE_SIZE);
 	}
 	void FreeAligned(void *ptr);
 
@@ -28,14 +31,129 @@ namespace Aya {
 		}
 	}
 
-	template <typename T> class BlockedArray {
+	enum class MemoryCategory {
+		Geometry,
+		Accelerator,
+		Texture,
+		Distribution,
+		Film,
+		Integrator,
+		Count
+	};
+
+	// Process wide byte counts per subsystem. Bulk allocations report here
+	// automatically, heap owned buffers through an Entry. An optional budget lets
+	// loaders pick compact representations before memory runs out
+	class MemoryTracker {
+	public:
+		// Reports a buffer whose size changes over its lifetime,
+		// the bytes are withdrawn again on destruction
+		class Entry {
+		private:
+			MemoryCategory m_category;
+			size_t m_bytes;
+
+		public:
+			Entry(const MemoryCategory category)
+				: m_category(category), m_bytes(0) {}
+			~Entry() {
+				set(0);
+			}
+
+			Entry(const Entry&) = delete;
+			Entry& operator = (const Entry&) = delete;
+
+			inline void set(const size_t bytes) {
+				MemoryTracker::add(m_category, int64_t(bytes) - int64_t(m_bytes));
+				m_bytes = bytes;
+			}
+			inline size_t get() const {
+				return m_bytes;
+			}
+		};
+
+		static void add(const MemoryCategory category, const int64_t bytes);
+		static size_t getBytes(const MemoryCategory category);
+		static size_t getTotalBytes();
+
+		// Zero disables the budget
+		static void setBudget(const size_t bytes);
+		static size_t getBudget();
+		// True if another allocation of the given size stays within the budget
+		static bool fitsBudget(const size_t bytes);
+
+		static const char* categoryName(const MemoryCategory category);
+		static void printStatistics();
+	};
+
+	// Scene lifetime bulk allocator, static scene data is carved out of large
+	// chunks backed by transparent huge pages where the OS supports them.
+	// Individual allocations are never freed, release() drops everything at once
+	class BulkAllocator {
+	private:
+		struct Chunk {
+			uint8_t *ptr;
+			size_t size;
+		};
+
+		size_t m_chunkSize;
+		size_t m_offset;
+		std::vector<Chunk> m_chunks;
+		size_t m_reserved;
+		std::atomic<size_t> m_bytes[size_t(MemoryCategory::Count)];
+
+		mutable std::mutex m_mt;
+
+	public:
+		static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+		BulkAllocator(const size_t chunk_size = 32 * HUGE_PAGE_SIZE);
+		~BulkAllocator() {
+			release();
+		}
+
+		BulkAllocator(const BulkAllocator&) = delete;
+		BulkAllocator& operator = (const BulkAllocator&) = delete;
+
+		void *allocBytes(const size_t size, const MemoryCategory category, const size_t alignment = AYA_L1_CACHE_LINE_SIZE);
+		template<class T>
+		inline T* alloc(const size_t count, const MemoryCategory category, const size_t alignment = AYA_L1_CACHE_LINE_SIZE) {
+			return (T*)allocBytes(count * sizeof(T), category, Max(alignment, alignof(T)));
+		}
+
+		// Only valid once nothing references the allocations any more
+		void release();
+
+		inline size_t getBytes(const MemoryCategory category) const {
+			return m_bytes[size_t(category)].load(std::memory_order_relaxed);
+		}
+		size_t getReservedBytes() const;
+		void printStatistics() const;
+
+		// Arena of the scene being built, one Scene lives at a time and releases it on destruction
+		static BulkAllocator& scene();
+	};
+
+	// 2D array indexed (u, v) with v the fast axis. log_block = 0 stores plain rows.
+	// Otherwise square blocks of 2^log_block entries a side are stored contiguously with
+	// the entries of a block in Morton order, so 2D neighbourhoods share cache lines.
+	// data() exposes the storage order
+	template <typename T, int log_block = 0> class BlockedArray {
 	private:
+		static_assert(log_block >= 0 && log_block <= 4, "Blocks are at most 16 entries a side");
+		static const uint32_t BLOCK_SIZE = 1u << log_block;
+		static const uint32_t BLOCK_MASK = BLOCK_SIZE - 1;
+
 		T *m_data;
 		uint32_t u_res, v_res;
+		uint32_t v_blocks;
+		bool m_bulk;
 
 	public:
 		BlockedArray() {
 			m_data = NULL;
+			u_res = v_res = v_blocks = 0;
+			m_bulk = false;
 		}
 		BlockedArray(uint32_t nu, uint32_t nv) {
 			init(nu, nv);
@@ -45,43 +163,52 @@ namespace Aya {
 		}
 
 		void init(uint32_t nu, uint32_t nv, const T* data) {
-			u_res = nu;
-			v_res = nv;
-			auto roundUp = [this](const uint32_t x) {
-				return (x + 3) & ~(3);
-			};
-			uint32_t n_alloc = roundUp(u_res) * roundUp(v_res);
+			init(nu, nv);
+			for (uint32_t u = 0; u < u_res; u++)
+				for (uint32_t v = 0; v < v_res; v++)
+					(*this)(u, v) = data[u * v_res + v];
+		}
+		void init(uint32_t nu, uint32_t nv) {
+			setResolution(nu, nv);
+			const uint32_t n_alloc = allocCount();
 			m_data = AllocAligned<T>(n_alloc);
+			m_bulk = false;
 			for (uint32_t i = 0; i < n_alloc; ++i)
 				new (&m_data[i]) T();
-
-			for (uint32_t i = 0; i < u_res * v_res; i++)
-				m_data[i] = data[i];
 		}
-		void init(uint32_t nu, uint32_t nv) {
-			u_res = nu;
-			v_res = nv;
-			auto roundUp = [this](const uint32_t x) {
-				return (x + 3) & ~(3);
-			};
-			uint32_t n_alloc = roundUp(u_res) * roundUp(v_res);
-			m_data = AllocAligned<T>(n_alloc);
+		void init(uint32_t nu, uint32_t nv, BulkAllocator &allocator, const MemoryCategory category) {
+			setResolution(nu, nv);
+			const uint32_t n_alloc = allocCount();
+			m_data = allocator.alloc<T>(n_alloc, category);
+			m_bulk = true;
 			for (uint32_t i = 0; i < n_alloc; ++i)
 				new (&m_data[i]) T();
 		}
 		void free() {
-			for (uint32_t i = 0; i < u_res * v_res; ++i)
+			if (!m_data)
+				return;
+			const uint32_t n_alloc = allocCount();
+			for (uint32_t i = 0; i < n_alloc; ++i)
 				m_data[i].~T();
-			FreeAligned(m_data);
+			if (!m_bulk)
+				FreeAligned(m_data);
+			m_data = NULL;
+			u_res = v_res = v_blocks = 0;
 		}
 		AYA_FORCE_INLINE uint32_t linearSize() const {
 			return v_res * u_res;
 		}
+		AYA_FORCE_INLINE uint32_t offset(uint32_t u, uint32_t v) const {
+			if (log_block == 0)
+				return u * v_res + v;
+			const uint32_t block = (u >> log_block) * v_blocks + (v >> log_block);
+			return (block << (2 * log_block)) | (spreadBits(u & BLOCK_MASK) << 1) | spreadBits(v & BLOCK_MASK);
+		}
 		AYA_FORCE_INLINE T &operator()(uint32_t u, uint32_t v) {
-			return m_data[u * v_res + v];
+			return m_data[offset(u, v)];
 		}
 		AYA_FORCE_INLINE const T &operator()(uint32_t u, uint32_t v) const {
-			return m_data[u * v_res + v];
+			return m_data[offset(u, v)];
 		}
 		AYA_FORCE_INLINE const T* data() const {
 			return m_data;
@@ -101,57 +228,188 @@ namespace Aya {
 		AYA_FORCE_INLINE int v() const {
 			return v_res;
 		}
+
+	private:
+		inline void setResolution(uint32_t nu, uint32_t nv) {
+			u_res = nu;
+			v_res = nv;
+			v_blocks = (v_res + BLOCK_MASK) >> log_block;
+		}
+		inline uint32_t allocCount() const {
+			if (log_block == 0) {
+				auto roundUp = [](const uint32_t x) {
+					return (x + 3) & ~(3);
+				};
+				return roundUp(u_res) * roundUp(v_res);
+			}
+			return ((u_res + BLOCK_MASK) >> log_block) * v_blocks << (2 * log_block);
+		}
+		// Moves the low log_block bits to the even positions
+		static AYA_FORCE_INLINE uint32_t spreadBits(uint32_t x) {
+			if (log_block > 2)
+				x = (x | (x << 2)) & 0x33;
+			return (x | (x << 1)) & 0x55;
+		}
 	};
 
 	class MemoryPool {
 	private:
+		struct Block {
+			uint8_t *ptr;
+			uint32_t size;
+		};
+
 		uint32_t m_size;
 		uint32_t m_offset;
-		uint8_t *mp_current;
+		Block m_current;
+
+		std::vector<Block> m_used, m_avail;
 
-		std::vector<uint8_t*> m_used, m_avail;
+		// Statistics
+		size_t m_inUse, m_highWater, m_reserved;
+
+	public:
+		// Position inside the pool, rewinding to it releases everything allocated after
+		struct Marker {
+			size_t used_blocks;
+			uint32_t offset;
+			size_t in_use;
+		};
+
+		// Releases the allocations made during its lifetime
+		class Scope {
+		private:
+			MemoryPool &m_pool;
+			Marker m_marker;
+
+		public:
+			Scope(MemoryPool &pool) : m_pool(pool), m_marker(pool.mark()) {}
+			~Scope() {
+				m_pool.rewind(m_marker);
+			}
+			inline void rewind() {
+				m_pool.rewind(m_marker);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator = (const Scope&) = delete;
+		};
 
 	public:
 		MemoryPool(uint32_t size = 32768) {
 			m_size = size;
 			m_offset = 0;
-			mp_current = AllocAligned<uint8_t>(m_size);
+			m_current = { AllocAligned<uint8_t>(m_size), m_size };
+			m_inUse = m_highWater = 0;
+			m_reserved = m_size;
 		}
 		~MemoryPool() {
-			FreeAligned(mp_current);
-			for (auto p : m_used) FreeAligned(p);
-			for (auto p : m_avail) FreeAligned(p);
+			FreeAligned(m_current.ptr);
+			for (auto &b : m_used) FreeAligned(b.ptr);
+			for (auto &b : m_avail) FreeAligned(b.ptr);
 		}
 
+		MemoryPool(const MemoryPool&) = delete;
+		MemoryPool& operator = (const MemoryPool&) = delete;
+
 		template<class T>
 		inline T* alloc(uint32_t count = 1) {
 			uint32_t size = (count * sizeof(T) + 15) & (~15);
 
-			if (m_offset + size > m_size) {
-				m_used.emplace_back(mp_current);
-				if (m_avail.size() > 0 && size < m_size) {
-					mp_current = m_avail.back();
-					m_avail.pop_back();
-				}
-				else {
-					mp_current = AllocAligned<uint8_t>(Max(size, m_size));
-				}
+			if (m_offset + size > m_current.size) {
+				m_used.emplace_back(m_current);
+				m_current = acquireBlock(size);
 				m_offset = 0;
 			}
 
-			T *ret = (T*)(mp_current + m_offset);
+			T *ret = (T*)(m_current.ptr + m_offset);
 			m_offset += size;
 
+			m_inUse += size;
+			SetMax(m_highWater, m_inUse);
+
 			return ret;
 		}
 
 		inline void freeAll() {
 			m_offset = 0;
+			m_inUse = 0;
 			while (m_used.size()) {
 				m_avail.emplace_back(m_used.back());
 				m_used.pop_back();
 			}
 		}
+
+		inline Marker mark() const {
+			return { m_used.size(), m_offset, m_inUse };
+		}
+		inline void rewind(const Marker &marker) {
+			assert(marker.used_blocks <= m_used.size());
+			if (m_used.size() > marker.used_blocks) {
+				m_avail.emplace_back(m_current);
+				while (m_used.size() > marker.used_blocks + 1) {
+					m_avail.emplace_back(m_used.back());
+					m_used.pop_back();
+				}
+				m_current = m_used.back();
+				m_used.pop_back();
+			}
+			m_offset = marker.offset;
+			m_inUse = marker.in_use;
+		}
+
+		inline size_t getHighWater() const {
+			return m_highWater;
+		}
+		inline size_t getReservedBytes() const {
+			return m_reserved;
+		}
+
+		// Pool owned by one task for its whole body, released with everything in it.
+		// Pools come from a shared free list and persist across tiles and passes so the
+		// render loop never touches the system allocator. A thread local pool would be
+		// shared with tasks the scheduler runs inline while this one waits, scopes of a
+		// pool are only LIFO within the task that holds the lease
+		class Lease {
+		private:
+			MemoryPool *mp_pool;
+
+		public:
+			Lease() : mp_pool(MemoryPool::acquire()) {}
+			~Lease() {
+				MemoryPool::release(mp_pool);
+			}
+			inline MemoryPool& pool() const {
+				return *mp_pool;
+			}
+
+			Lease(const Lease&) = delete;
+			Lease& operator = (const Lease&) = delete;
+		};
+
+		static MemoryPool* acquire();
+		static void release(MemoryPool *pool);
+		static void printStatistics();
+
+	private:
+		inline Block acquireBlock(const uint32_t size) {
+			// Reuse the smallest free block that fits, large requests included
+			int best = -1;
+			for (int i = 0; i < (int)m_avail.size(); i++) {
+				if (m_avail[i].size >= size && (best < 0 || m_avail[i].size < m_avail[best].size))
+					best = i;
+			}
+			if (best >= 0) {
+				Block ret = m_avail[best];
+				m_avail[best] = m_avail.back();
+				m_avail.pop_back();
+				return ret;
+			}
+
+			const uint32_t block_size = Max(size, m_size);
+			m_reserved += block_size;
+			return { AllocAligned<uint8_t>(block_size), block_size };
+		}
 	};
 }
 
@@ -27,14 +27,16 @@ namespace Aya {
 
 		virtual inline void srand(const uint64_t &index) = 0;
 		virtual inline uint32_t rand32() = 0;
-		virtual inline float drand48() = 0 {
+		virtual inline float drand48() {
 			return Min(FLOAT_ONE_MINUS_EPSILON, rand32() * 2.3283064365386963e-10f);
 		}
 	};
 
 	// PbrtRNG
+	// Timings of 1e8 draws are from Tests/RNGBenchmark.cpp built with GCC -O2, range of the best
+	// of 5 runs over three invocations on a shared machine. Debug timings are older MSVC ones
 	// debug(1e8): 3261
-	// release(1e8): 482ms
+	// release(1e8): 299-428ms
 	// https://github.com/mmp/pbrt-v3/blob/master/src/core/rng.h
 	class PbrtRNG : public rng {
 	private:
@@ -66,7 +68,7 @@ namespace Aya {
 
 	// MT19937RNG 
 	// debug(1e8): 4727ms
-	// release(1e8): 2364ms
+	// release(1e8): 782-1031ms
 	// https://en.wikipedia.org/wiki/Mersenne_Twister
 	class MT19937RNG : public rng {
 	private:
@@ -116,7 +118,177 @@ namespace Aya {
 		}
 	};
 
-	typedef PbrtRNG RNG;
+	// PCG32
+	// Same sequence as PbrtRNG without the virtual interface, every call inlines
+	// release(1e8): 193-297ms
+	class PCG32 {
+	private:
+		uint64_t state, inc;
+
+	public:
+		AYA_FORCE_INLINE PCG32(const uint64_t &seed = 0x7F7F7F) : state(PCG32_DEFAULT_STATE), inc(PCG32_DEFAULT_STREAM) {
+			srand(seed);
+		}
+
+		AYA_FORCE_INLINE void srand(const uint64_t &index) {
+			state = 0u;
+			inc = (index << 1u) | 1u;
+			rand32();
+			state += PCG32_DEFAULT_STATE;
+			rand32();
+		}
+		AYA_FORCE_INLINE uint32_t rand32() {
+			uint64_t o = state;
+			state = o * PCG32_MULT + inc;
+			uint32_t x_s = (uint32_t)(((o >> 18u) ^ o) >> 27u);
+			uint32_t rot = (uint32_t)(o >> 59u);
+			return (x_s >> rot) | (x_s << ((~rot + 1u) & 31));
+		}
+		AYA_FORCE_INLINE float drand48() {
+			return Min(FLOAT_ONE_MINUS_EPSILON, rand32() * 2.3283064365386963e-10f);
+		}
+		inline void fill(float *values, const int count) {
+			for (int i = 0; i < count; i++)
+				values[i] = drand48();
+		}
+	};
+
+	// PCG32x8
+	// Eight independent PCG32 streams advanced together, AVX2 when available
+	// release(1e8, fill 4096 per call): 86-91ms with AVX2, 167ms scalar
+	class PCG32x8 {
+	public:
+		static const int LANES = 8;
+
+	private:
+		ATTRIBUTE_ALIGNED64(uint64_t state[LANES]);
+		ATTRIBUTE_ALIGNED64(uint64_t inc[LANES]);
+
+	public:
+		inline PCG32x8(const uint64_t &seed = 0x7F7F7F) {
+			srand(seed);
+		}
+
+		// Lane i follows stream seed * LANES + i of the scalar generator
+		inline void srand(const uint64_t &seed) {
+			for (int i = 0; i < LANES; i++) {
+				const uint64_t index = seed * LANES + i;
+				inc[i] = (index << 1u) | 1u;
+				state[i] = inc[i];
+				state[i] += PCG32_DEFAULT_STATE;
+				state[i] = state[i] * PCG32_MULT + inc[i];
+			}
+		}
+
+		// Writes count floats in [0, 1), lane outputs are interleaved
+		inline void fill(float *values, const int count) {
+#if defined(AYA_USE_AVX2)
+			const __m256i mult_lo = _mm256_set1_epi64x(PCG32_MULT & 0xffffffffULL);
+			const __m256i mult_hi = _mm256_set1_epi64x(PCG32_MULT >> 32);
+			const __m256i low_mask = _mm256_set1_epi64x(0xffffffffULL);
+			const __m256i rot_mask = _mm256_set1_epi64x(31);
+			const __m256i even_dwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+			const __m256 scale = _mm256_set1_ps(5.9604644775390625e-8f); /* 1 / 2^24 */
+
+			__m256i state0 = _mm256_load_si256((const __m256i*)state);
+			__m256i state1 = _mm256_load_si256((const __m256i*)(state + 4));
+			const __m256i inc0 = _mm256_load_si256((const __m256i*)inc);
+			const __m256i inc1 = _mm256_load_si256((const __m256i*)(inc + 4));
+
+			auto step = [&](__m256i &s, const __m256i &i) {
+				const __m256i o = s;
+				// 64 bit multiply from 32 bit halves, the high cross terms fall out of range
+				const __m256i lo = _mm256_mul_epu32(o, mult_lo);
+				const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(o, mult_hi),
+					_mm256_mul_epu32(_mm256_srli_epi64(o, 32), mult_lo));
+				s = _mm256_add_epi64(_mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32)), i);
+
+				const __m256i x_s = _mm256_and_si256(_mm256_srli_epi64(
+					_mm256_xor_si256(_mm256_srli_epi64(o, 18), o), 27), low_mask);
+				const __m256i rot = _mm256_srli_epi64(o, 59);
+				const __m256i left = _mm256_and_si256(_mm256_sub_epi64(_mm256_setzero_si256(), rot), rot_mask);
+				const __m256i ret = _mm256_or_si256(_mm256_srlv_epi64(x_s, rot), _mm256_sllv_epi64(x_s, left));
+				return _mm256_permutevar8x32_epi32(ret, even_dwords);
+			};
+
+			for (int i = 0; i < count; i += LANES) {
+				const __m256i bits = _mm256_permute2x128_si256(step(state0, inc0), step(state1, inc1), 0x20);
+				const __m256 ret = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(bits, 8)), scale);
+				if (i + LANES <= count) {
+					_mm256_storeu_ps(values + i, ret);
+				}
+				else {
+					ATTRIBUTE_ALIGNED64(float tail[LANES]);
+					_mm256_store_ps(tail, ret);
+					for (int j = 0; i + j < count; j++)
+						values[i + j] = tail[j];
+				}
+			}
+
+			_mm256_store_si256((__m256i*)state, state0);
+			_mm256_store_si256((__m256i*)(state + 4), state1);
+#else
+			for (int i = 0; i < count; i += LANES) {
+				for (int j = 0; j < LANES; j++) {
+					const uint64_t o = state[j];
+					state[j] = o * PCG32_MULT + inc[j];
+					const uint32_t x_s = (uint32_t)(((o >> 18u) ^ o) >> 27u);
+					const uint32_t rot = (uint32_t)(o >> 59u);
+					const uint32_t bits = (x_s >> rot) | (x_s << ((~rot + 1u) & 31));
+					if (i + j < count)
+						values[i + j] = (bits >> 8) * 5.9604644775390625e-8f; /* 1 / 2^24 */
+				}
+			}
+#endif
+		}
+	};
+
+	// Draws single values from a buffer refilled eight lanes at a time
+	// release(1e8): 148-186ms with AVX2, 211ms scalar
+	class BufferedRNG {
+	public:
+		static const int BUFFER_SIZE = 64;
+
+	private:
+		PCG32x8 m_lanes;
+		ATTRIBUTE_ALIGNED64(float m_buffer[BUFFER_SIZE]);
+		int m_next;
+
+	public:
+		inline BufferedRNG(const uint64_t &seed = 0x7F7F7F) : m_lanes(seed), m_next(BUFFER_SIZE) {}
+
+		inline void srand(const uint64_t &seed) {
+			m_lanes.srand(seed);
+			m_next = BUFFER_SIZE;
+		}
+		AYA_FORCE_INLINE float drand48() {
+			if (m_next == BUFFER_SIZE) {
+				m_lanes.fill(m_buffer, BUFFER_SIZE);
+				m_next = 0;
+			}
+			return m_buffer[m_next++];
+		}
+		inline void fill(float *values, int count) {
+			// Drain the buffer first so the stream is the same as single draws
+			while (count > 0 && m_next < BUFFER_SIZE) {
+				*values++ = m_buffer[m_next++];
+				count--;
+			}
+			const int direct = count - count % BUFFER_SIZE;
+			m_lanes.fill(values, direct);
+			for (int i = direct; i < count; i++)
+				values[i] = drand48();
+		}
+	};
+
+	typedef PCG32 RNG;
+
+	// Generator for consumers drawing long runs of values, the buffer only pays off with AVX2
+#if defined(AYA_USE_AVX2)
+	typedef BufferedRNG BatchRNG;
+#else
+	typedef PCG32 BatchRNG;
+#endif
 
 	// Hash lookup table as defined by Ken Perlin.  This is a randomly
 	// arranged array of all numbers from 0-255 inclusive.
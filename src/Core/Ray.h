@@ -35,11 +35,34 @@ namespace Aya {
 		}
 	};
 
+	// Footprint of a path approximated by a cone, width at the origin and spread angle.
+	// Picks texture levels where a ray no longer carries differentials
+	class RayCone {
+	public:
+		float m_width, m_spread;
+
+		RayCone(const float width = 0.f, const float spread = 0.f) : m_width(width), m_spread(spread) {}
+
+		inline float widthAt(const float dist) const {
+			return m_width + m_spread * dist;
+		}
+		inline bool isValid() const {
+			return m_width > 0.f || m_spread > 0.f;
+		}
+
+		// Diameter of a disk covering 1 / density, the cone angle of a lobe
+		// sampled with a solid angle density or the width of sampled positions
+		static inline float footprint(const float density) {
+			return density > 0.f ? 2.f / Sqrt(float(M_PI) * density) : 0.f;
+		}
+	};
+
 	class RayDifferential : public Ray {
 	public:
 		bool m_hasDifferentials;
 		Point3 m_rxOri, m_ryOri;
 		Vector3 m_rxDir, m_ryDir;
+		RayCone m_cone;
 
 		RayDifferential() { m_hasDifferentials = false; }
 		RayDifferential(const Point3 &ori, const Vector3 &dir,
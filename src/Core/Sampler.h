@@ -6,6 +6,8 @@
 #include <Core/RNG.h>
 #include <Math/Vector2.h>
 
+#include <ppl.h>
+
 namespace Aya {
 	struct CameraSample {
 		float image_x, image_y;
@@ -20,6 +22,24 @@ namespace Aya {
 		Sample(RNG &rng);
 	};
 
+	// Independent random streams drawn for one pixel sample
+	enum class SeedPurpose {
+		Integrator,
+		LightPath,
+		Bootstrap,
+		Chain,
+		SamplerStream
+	};
+
+	// Seed depending only on (pixel, sample index, purpose), so a render is identical
+	// whichever worker or tile evaluates a sample and however many threads there are
+	AYA_FORCE_INLINE uint64_t HashSeed(const int pixel_x, const int pixel_y, const uint64_t sample_idx,
+		const SeedPurpose purpose, const int stream = 0) {
+		const uint64_t pixel = (uint64_t(uint32_t(pixel_x)) << 32) | uint32_t(pixel_y);
+		const uint64_t key = (uint64_t(purpose) << 32) | uint32_t(stream);
+		return MixBits(MixBits(MixBits(pixel) + sample_idx) + key);
+	}
+
 	class Sampler {
 	public:
 		virtual ~Sampler() = default;
@@ -33,12 +53,43 @@ namespace Aya {
 		virtual void advanceSampleIndex() {}
 
 		virtual void startPixel(const int pixel_x, const int pixel_y) {}
+		// Switches to an independent set of dimensions for the current pixel, a second
+		// path of the same pixel can be regenerated from (seed, pixel, stream) alone
+		virtual void startStream(const int stream) {}
 		virtual float get1D() = 0;
 		virtual Vector2f get2D() = 0;
 		virtual Sample getSample() = 0;
+		// Draws count consecutive 1D values, samplers with bulk generators override it
+		virtual void get1DArray(float *values, const int count) {
+			for (int i = 0; i < count; i++)
+				values[i] = get1D();
+		}
 
 		virtual std::unique_ptr<Sampler> clone(const int seed) const = 0;
 		virtual std::unique_ptr<Sampler> deepClone() const = 0;
+		// Puts this instance into the state clone(seed) of source would have, without allocating
+		virtual void reset(const Sampler *source, const int seed) = 0;
+	};
+
+	// One sampler per worker thread for the duration of a render,
+	// tiles reseed it in place instead of allocating a clone each
+	class SamplerPool {
+	private:
+		const Sampler *mp_source;
+		concurrency::combinable<std::unique_ptr<Sampler>> m_samplers;
+
+	public:
+		SamplerPool(const Sampler *source) : mp_source(source) {}
+
+		Sampler* acquire(const int seed) {
+			std::unique_ptr<Sampler> &sampler = m_samplers.local();
+			if (!sampler)
+				sampler = mp_source->clone(seed);
+			else
+				sampler->reset(mp_source, seed);
+
+			return sampler.get();
+		}
 	};
 }
 #endif
\ No newline at end of file
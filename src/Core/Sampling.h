@@ -11,63 +11,74 @@
 namespace Aya {
 	class Distribution1D {
 	private:
-		std::vector<float> m_pdf;
-		std::vector<float> m_cdf;
+		// pdf and cdf share one block, owned by m_storage unless it came from a bulk allocator
+		std::vector<float> m_storage;
+		float *mp_pdf = nullptr;
+		float *mp_cdf = nullptr;
 		int m_count = -1;
 		float m_integralValue;
 		friend class Distribution2D;
 
 	public:
 		Distribution1D() = default;
-		Distribution1D(const float *func, int size) {
-			setFunction(func, size);
+		Distribution1D(const float *func, int size, BulkAllocator *allocator = nullptr) {
+			setFunction(func, size, allocator);
 		}
+		Distribution1D(const Distribution1D&) = delete;
+		Distribution1D& operator = (const Distribution1D&) = delete;
 
-		void setFunction(const float *func, int size) {
+		void setFunction(const float *func, int size, BulkAllocator *allocator = nullptr) {
 			assert(func);
 			assert(size > 0);
 			
 			if (size != m_count) {
 				m_count = size;
-				m_pdf.resize(size);
-				m_cdf.resize(size + 1);
+				if (allocator) {
+					std::vector<float>().swap(m_storage);
+					mp_pdf = allocator->alloc<float>(2 * size + 1, MemoryCategory::Distribution);
+				}
+				else {
+					m_storage.resize(2 * size + 1);
+					mp_pdf = m_storage.data();
+				}
+				mp_cdf = mp_pdf + size;
 			}
 
 			for (auto i = 0; i < size; i++) {
-				m_pdf[i] = func[i];
+				mp_pdf[i] = func[i];
 			}
 
 			float inv_size = 1.f / float(size);
-			m_cdf[0] = 0.f;
-			for (auto i = 1; i < m_cdf.size(); i++) {
-				m_cdf[i] = m_cdf[i - 1] + m_pdf[i - 1] * inv_size;
+			mp_cdf[0] = 0.f;
+			for (auto i = 1; i <= size; i++) {
+				mp_cdf[i] = mp_cdf[i - 1] + mp_pdf[i - 1] * inv_size;
 			}
 
-			m_integralValue = m_cdf[size];
+			m_integralValue = mp_cdf[size];
 			if (m_integralValue > 0.f) {
 				float inv_value = 1.f / m_integralValue;
-				for (auto i = 1; i < m_cdf.size(); i++) {
-					m_cdf[i] *= inv_value;
+				for (auto i = 1; i <= size; i++) {
+					mp_cdf[i] *= inv_value;
 				}
 			}
 		}
 
 		float sampleContinuous(float u, float *pdf, int *p_offset = nullptr) const {
-			const int idx = int(std::lower_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+			const int idx = int(std::lower_bound(mp_cdf, mp_cdf + m_count + 1, u) - mp_cdf);
 			int offset = Clamp(idx - 1, 0, m_count - 1);
 			if (pdf)
-				*pdf = m_pdf[offset] / m_integralValue;
+				*pdf = mp_pdf[offset] / m_integralValue;
 			if (p_offset)
 				*p_offset = offset;
 
-			float du = (u - m_cdf[offset]) / (m_cdf[offset + 1] - m_cdf[offset] + float(AYA_EPSILON));
+			float du = (u - mp_cdf[offset]) / (mp_cdf[offset + 1] - mp_cdf[offset] + float(AYA_EPSILON));
 			return (offset + du) / float(m_count);
 		}
 		int sampleDiscrete(float u, float *pdf) const {
-			const int idx = int(std::lower_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+			const int idx = int(std::lower_bound(mp_cdf, mp_cdf + m_count + 1, u) - mp_cdf);
 			int offset = Clamp(idx - 1, 0, m_count - 1);
 			if (pdf)
-				*pdf = m_pdf[offset] / (m_integralValue * m_count);
+				*pdf = mp_pdf[offset] / (m_integralValue * m_count);
 
 			return offset;
 		}
@@ -82,21 +93,22 @@ namespace Aya {
 		std::unique_ptr<Distribution1D> mp_marginal;
 
 	public:
-		Distribution2D(const float *func, int count_x, int count_y) {
+		// Rows are carved out of the allocator when one is given, otherwise they are heap owned
+		Distribution2D(const float *func, int count_x, int count_y, BulkAllocator *allocator = nullptr) {
 			assert(func);
 			assert(count_x > 0);
 			assert(count_y > 0);
 
 			m_conditional.resize(count_y);
 			for (auto i = 0; i < count_y; i++) {
-				m_conditional[i] = std::make_unique<Distribution1D>(&func[i * count_x], count_x);
+				m_conditional[i] = std::make_unique<Distribution1D>(&func[i * count_x], count_x, allocator);
 			}
 
 			float *marginal = new float[count_y];
 			for (auto i = 0; i < count_y; i++) {
 				marginal[i] = m_conditional[i]->getIntegral();
 			}
-			mp_marginal = std::make_unique<Distribution1D>(marginal, count_y);
+			mp_marginal = std::make_unique<Distribution1D>(marginal, count_y, allocator);
 			SafeDeleteArray(marginal);
 		}
 
@@ -114,7 +126,7 @@ namespace Aya {
 			if (m_conditional[iv]->getIntegral() * mp_marginal->getIntegral() == 0.f)
 				return 0.f;
 
-			return (m_conditional[iv]->m_pdf[iu] * mp_marginal->m_pdf[iv]) /
+			return (m_conditional[iv]->mp_pdf[iu] * mp_marginal->mp_pdf[iv]) /
 				(m_conditional[iv]->getIntegral() * mp_marginal->getIntegral());
 		}
 	};
@@ -139,8 +151,8 @@ namespace Aya {
 				phi = float(M_PI_2) - (r1 / r2) * float(M_PI_4);
 			}
 		}
-		*dx = r * std::cosf(phi);
-		*dy = r * std::sinf(phi);
+		*dx = r * std::cos(phi);
+		*dy = r * std::sin(phi);
 	}
 	inline void UniformSampleTriangle(float u1, float u2, float *u, float *v) {
 		float su1 = Sqrt(u1);
@@ -157,8 +169,8 @@ namespace Aya {
 		float z = 1.f - 2.f * u1;
 		float r = Sqrt(Max(0.f, 1.f - z * z));
 		float phi = 2.f * float(M_PI) * u2;
-		float x = r * std::cosf(phi);
-		float y = r * std::sinf(phi);
+		float x = r * std::cos(phi);
+		float y = r * std::sin(phi);
 		return Vector3(x, y, z);
 	}
 	inline Vector3 UniformSampleCone(float u1, float u2, float costhetamax,
@@ -166,8 +178,8 @@ namespace Aya {
 		float costheta = Lerp(u1, costhetamax, 1.f);
 		float sintheta = Sqrt(1.f - costheta * costheta);
 		float phi = 2.f * float(M_PI) * u2;
-		return	std::cosf(phi) * sintheta * x + 
-				std::sinf(phi) * sintheta * y +
+		return	std::cos(phi) * sintheta * x + 
+				std::sin(phi) * sintheta * y +
 				costheta * z;
 	}
 
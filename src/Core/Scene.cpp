@@ -1,7 +1,28 @@
 #include <Core/Scene.h>
 #include <Lights/AreaLight.h>
 
+#include <atomic>
+
 namespace Aya {
+	// The scene allocator holds the geometry, textures and acceleration structure of one scene
+	static std::atomic<int> LiveScenes(0);
+
+	Scene::Scene() : mp_envLight(nullptr), m_dirty(true) {
+		assert(LiveScenes == 0);
+		LiveScenes++;
+	}
+	Scene::~Scene() {
+		// Everything placed in the scene allocator is destroyed before its memory is returned
+		mp_accel.reset();
+		mp_envLight = nullptr;
+		m_lights.clear();
+		m_primitves.clear();
+		m_media.clear();
+
+		BulkAllocator::scene().release();
+		LiveScenes--;
+	}
+
 	bool Scene::intersect(const Ray &ray0, Intersection *isect) const {
 		Ray ray = m_sceneScale(ray0);
 		if (!mp_accel->intersect(ray, isect))
@@ -71,6 +92,9 @@ namespace Aya {
 
 			mp_accel->construct(prims);
 			m_dirty = false;
+
+			BulkAllocator::scene().printStatistics();
+			MemoryTracker::printStatistics();
 		}
 	}
 
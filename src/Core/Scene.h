@@ -27,8 +27,8 @@ namespace Aya {
 		Transform m_sceneScale, m_sceneScaleInv;
 
 	public:
-		Scene() : mp_envLight(nullptr), m_dirty(true) {}
-		~Scene() {}
+		Scene();
+		~Scene();
 
 		bool intersect(const Ray &ray, Intersection *isect) const;
 		void postIntersect(const RayDifferential &ray, SurfaceIntersection *intersection) const;
@@ -1,4 +1,8 @@
 #include <Core/Spectrum.h>
+#include <Core/FileUtil.h>
+
+#include <cstring>
+#include <ppl.h>
 
 namespace Aya {
 
@@ -60,89 +64,279 @@ namespace Aya {
 		toRGB(rgb);
 		return RGBSpectrum::fromRGB(rgb);
 	}
-	SampledSpectrum SampledSpectrum::fromRGB(const float rgb[3], SpectrumType type) {
-		SampledSpectrum r;
-		if (type == SpectrumType::Reflectance) {
-			// Convert reflectance spectrum to RGB
-			if (rgb[0] <= rgb[1] && rgb[0] <= rgb[2]) {
-				// Compute reflectance _SampledSpectrum_ with _rgb[0]_ as minimum
-				r += rgb[0] * rgb_refl_2spect_white;
-				if (rgb[1] <= rgb[2]) {
-					r += (rgb[1] - rgb[0]) * rgb_refl_2spect_cyan;
-					r += (rgb[2] - rgb[1]) * rgb_refl_2spect_blue;
-				}
-				else {
-					r += (rgb[2] - rgb[0]) * rgb_refl_2spect_cyan;
-					r += (rgb[1] - rgb[2]) * rgb_refl_2spect_green;
-				}
+	// Wavelengths the coefficient fit integrates over with Simpson's rule
+	static const int RGB_FIT_SAMPLES = 101;
+	struct RGBFitData {
+		double x[RGB_FIT_SAMPLES];
+		double weight[RGB_FIT_SAMPLES][3];
+		double white[3];
+	};
+
+	static void FitXYZToLab(const double xyz[3], const double white[3], double lab[3]) {
+		auto f = [](const double t) {
+			const double delta = 6.0 / 29.0;
+			return t > delta * delta * delta ? std::cbrt(t) : t / (3.0 * delta * delta) + 4.0 / 29.0;
+		};
+		const double fx = f(xyz[0] / white[0]), fy = f(xyz[1] / white[1]), fz = f(xyz[2] / white[2]);
+		lab[0] = 116.0 * fy - 16.0;
+		lab[1] = 500.0 * (fx - fy);
+		lab[2] = 200.0 * (fy - fz);
+	}
+	static void FitResidual(const RGBFitData &fit, const double coeffs[3], const double target[3], double residual[3]) {
+		double xyz[3] = { 0.0, 0.0, 0.0 };
+		for (int i = 0; i < RGB_FIT_SAMPLES; i++) {
+			const double v = (coeffs[0] * fit.x[i] + coeffs[1]) * fit.x[i] + coeffs[2];
+			const double s = .5 + v / (2.0 * std::sqrt(1.0 + v * v));
+			for (int k = 0; k < 3; k++)
+				xyz[k] += s * fit.weight[i][k];
+		}
+		double lab[3];
+		FitXYZToLab(xyz, fit.white, lab);
+		for (int k = 0; k < 3; k++)
+			residual[k] = lab[k] - target[k];
+	}
+	// Gauss-Newton on the CIELAB difference, coeffs holds the initial guess
+	static void FitCoefficients(const RGBFitData &fit, const float rgb[3], double coeffs[3]) {
+		float xyz_f[3];
+		RGBToXYZ(rgb, xyz_f);
+		const double xyz[3] = { xyz_f[0], xyz_f[1], xyz_f[2] };
+		double target[3];
+		FitXYZToLab(xyz, fit.white, target);
+
+		for (int it = 0; it < 15; it++) {
+			double residual[3];
+			FitResidual(fit, coeffs, target, residual);
+
+			double J[3][3];
+			const double eps = 1e-5;
+			for (int j = 0; j < 3; j++) {
+				double c[3] = { coeffs[0], coeffs[1], coeffs[2] };
+				c[j] += eps;
+				double r1[3];
+				FitResidual(fit, c, target, r1);
+				for (int k = 0; k < 3; k++)
+					J[k][j] = (r1[k] - residual[k]) / eps;
 			}
-			else if (rgb[1] <= rgb[0] && rgb[1] <= rgb[2]) {
-				// Compute reflectance _SampledSpectrum_ with _rgb[1]_ as minimum
-				r += rgb[1] * rgb_refl_2spect_white;
-				if (rgb[0] <= rgb[2]) {
-					r += (rgb[0] - rgb[1]) * rgb_refl_2spect_magenta;
-					r += (rgb[2] - rgb[0]) * rgb_refl_2spect_blue;
-				}
-				else {
-					r += (rgb[2] - rgb[1]) * rgb_refl_2spect_magenta;
-					r += (rgb[0] - rgb[2]) * rgb_refl_2spect_red;
-				}
+
+			// Solve J d = residual by Cramer's rule
+			const double det =
+				J[0][0] * (J[1][1] * J[2][2] - J[1][2] * J[2][1]) -
+				J[0][1] * (J[1][0] * J[2][2] - J[1][2] * J[2][0]) +
+				J[0][2] * (J[1][0] * J[2][1] - J[1][1] * J[2][0]);
+			if (std::abs(det) < 1e-15)
+				break;
+			for (int j = 0; j < 3; j++) {
+				double M[3][3];
+				for (int r = 0; r < 3; r++)
+					for (int c = 0; c < 3; c++)
+						M[r][c] = c == j ? residual[r] : J[r][c];
+				const double det_j =
+					M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1]) -
+					M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0]) +
+					M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0]);
+				coeffs[j] -= det_j / det;
 			}
-			else {
-				// Compute reflectance _SampledSpectrum_ with _rgb[2]_ as minimum
-				r += rgb[2] * rgb_refl_2spect_white;
-				if (rgb[0] <= rgb[1]) {
-					r += (rgb[0] - rgb[2]) * rgb_refl_2spect_yellow;
-					r += (rgb[1] - rgb[0]) * rgb_refl_2spect_green;
-				}
-				else {
-					r += (rgb[1] - rgb[2]) * rgb_refl_2spect_yellow;
-					r += (rgb[0] - rgb[1]) * rgb_refl_2spect_red;
-				}
+
+			// Keep saturated colors from running away
+			const double max_coeff = Max(std::abs(coeffs[0]), Max(std::abs(coeffs[1]), std::abs(coeffs[2])));
+			if (max_coeff > 200.0) {
+				for (int j = 0; j < 3; j++)
+					coeffs[j] *= 200.0 / max_coeff;
 			}
-			r *= .94f;
+
+			if (residual[0] * residual[0] + residual[1] * residual[1] + residual[2] * residual[2] < 1e-6)
+				break;
 		}
-		else {
-			// Convert illuminant spectrum to RGB
-			if (rgb[0] <= rgb[1] && rgb[0] <= rgb[2]) {
-				// Compute illuminant _SampledSpectrum_ with _rgb[0]_ as minimum
-				r += rgb[0] * rgb_illum_2spect_white;
-				if (rgb[1] <= rgb[2]) {
-					r += (rgb[1] - rgb[0]) * rgb_illum_2spect_cyan;
-					r += (rgb[2] - rgb[1]) * rgb_illum_2spect_blue;
-				}
-				else {
-					r += (rgb[2] - rgb[0]) * rgb_illum_2spect_cyan;
-					r += (rgb[1] - rgb[2]) * rgb_illum_2spect_green;
-				}
-			}
-			else if (rgb[1] <= rgb[0] && rgb[1] <= rgb[2]) {
-				// Compute illuminant _SampledSpectrum_ with _rgb[1]_ as minimum
-				r += rgb[1] * rgb_illum_2spect_white;
-				if (rgb[0] <= rgb[2]) {
-					r += (rgb[0] - rgb[1]) * rgb_illum_2spect_magenta;
-					r += (rgb[2] - rgb[0]) * rgb_illum_2spect_blue;
-				}
-				else {
-					r += (rgb[2] - rgb[1]) * rgb_illum_2spect_magenta;
-					r += (rgb[0] - rgb[2]) * rgb_illum_2spect_red;
-				}
+	}
+
+	// Bumped whenever the fit changes, the inputs it depends on are compared as well
+	static const uint32_t RGB_TABLE_VERSION = 1;
+	struct RGBTableHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t res;
+		uint32_t fit_samples;
+		float lambda_start, lambda_end;
+		float illuminant_norm;
+		uint32_t pad;
+	};
+
+	RGBToSpectrumTable::RGBToSpectrumTable() {
+		// Smits' illuminant white, the same spectrum white lights were upsampled to before
+		auto illum = [](const double l) {
+			return double(InterpolateSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_white, n_RGB_2spect_samples, float(l)));
+		};
+
+		RGBFitData fit;
+		const double range = sampled_lambda_end - sampled_lambda_start;
+		const double h = range / double(RGB_FIT_SAMPLES - 1);
+		double norm = 0.0;
+		for (int i = 0; i < RGB_FIT_SAMPLES; i++) {
+			const double l = sampled_lambda_start + h * double(i);
+			const double simpson = (i == 0 || i == RGB_FIT_SAMPLES - 1) ? 1.0 : (i & 1 ? 4.0 : 2.0);
+			const double w = illum(l) * simpson * h / 3.0;
+			fit.x[i] = double(i) / double(RGB_FIT_SAMPLES - 1);
+			fit.weight[i][0] = w * InterpolateSpectrumSamples(CIE_lambda, CIE_X, n_CIE_samples, float(l));
+			fit.weight[i][1] = w * InterpolateSpectrumSamples(CIE_lambda, CIE_Y, n_CIE_samples, float(l));
+			fit.weight[i][2] = w * InterpolateSpectrumSamples(CIE_lambda, CIE_Z, n_CIE_samples, float(l));
+			norm += fit.weight[i][1];
+		}
+		for (int i = 0; i < RGB_FIT_SAMPLES; i++)
+			for (int k = 0; k < 3; k++)
+				fit.weight[i][k] /= norm;
+		const float white_rgb[3] = { 1.f, 1.f, 1.f };
+		float white[3];
+		RGBToXYZ(white_rgb, white);
+		for (int k = 0; k < 3; k++)
+			fit.white[k] = white[k];
+		// Same normalization as SampledSpectrum::toXYZ, an unit reflectance then has unit luminance
+		m_illuminantNorm = float(norm / CIE_Y_integral);
+
+		auto smoothstep = [](const float x) { return x * x * (3.f - 2.f * x); };
+		for (int k = 0; k < RES; k++)
+			m_scale[k] = smoothstep(smoothstep(float(k) / float(RES - 1)));
+
+		// The fit takes about a second, later runs map the table fitted by the first one
+		const std::string &cache_dir = UserCacheDir();
+		const std::string cache_path = cache_dir + "/rgb_spectrum_table.bin";
+		RGBTableHeader header;
+		memset(&header, 0, sizeof(RGBTableHeader));
+		memcpy(header.magic, "AYRS", 4);
+		header.version = RGB_TABLE_VERSION;
+		header.res = RES;
+		header.fit_samples = RGB_FIT_SAMPLES;
+		header.lambda_start = sampled_lambda_start;
+		header.lambda_end = sampled_lambda_end;
+		header.illuminant_norm = m_illuminantNorm;
+		m_coeffs.resize(size_t(3) * RES * RES * RES * 3);
+		const size_t coeff_bytes = m_coeffs.size() * sizeof(float);
+		if (!cache_dir.empty()) {
+			MappedFile file;
+			if (file.open(cache_path.c_str()) && file.size() == sizeof(RGBTableHeader) + coeff_bytes &&
+				memcmp(file.data(), &header, sizeof(RGBTableHeader)) == 0) {
+				memcpy(m_coeffs.data(), file.data() + sizeof(RGBTableHeader), coeff_bytes);
+				return;
 			}
-			else {
-				// Compute illuminant _SampledSpectrum_ with _rgb[2]_ as minimum
-				r += rgb[2] * rgb_illum_2spect_white;
-				if (rgb[0] <= rgb[1]) {
-					r += (rgb[0] - rgb[2]) * rgb_illum_2spect_yellow;
-					r += (rgb[1] - rgb[0]) * rgb_illum_2spect_green;
-				}
-				else {
-					r += (rgb[1] - rgb[2]) * rgb_illum_2spect_yellow;
-					r += (rgb[0] - rgb[1]) * rgb_illum_2spect_red;
+		}
+
+		// Each fit starts from the neighbour with the next lower or higher brightness
+		const int start = RES / 5;
+		for (int l = 0; l < 3; l++) {
+			concurrency::parallel_for(0, RES, [&](int j) {
+				const float y = float(j) / float(RES - 1);
+				for (int i = 0; i < RES; i++) {
+					const float x = float(i) / float(RES - 1);
+					auto fit_at = [&](const int k, double coeffs[3]) {
+						const float z = m_scale[k];
+						float rgb[3];
+						rgb[l] = z;
+						rgb[(l + 1) % 3] = x * z;
+						rgb[(l + 2) % 3] = y * z;
+						FitCoefficients(fit, rgb, coeffs);
+
+						float *dst = &m_coeffs[((size_t(l) * RES + k) * RES + j) * RES * 3 + size_t(i) * 3];
+						for (int c = 0; c < 3; c++)
+							dst[c] = float(coeffs[c]);
+					};
+
+					double coeffs[3] = { 0.0, 0.0, 0.0 };
+					for (int k = start; k < RES; k++)
+						fit_at(k, coeffs);
+					coeffs[0] = coeffs[1] = coeffs[2] = 0.0;
+					for (int k = start; k >= 0; k--)
+						fit_at(k, coeffs);
 				}
+			});
+		}
+
+		if (!cache_dir.empty())
+			WriteCacheFile(cache_path, [&](FILE *fp) {
+				return fwrite(&header, sizeof(RGBTableHeader), 1, fp) == 1 &&
+					fwrite(m_coeffs.data(), 1, coeff_bytes, fp) == coeff_bytes;
+			});
+	}
+
+	const RGBToSpectrumTable& RGBToSpectrumTable::get() {
+		static const RGBToSpectrumTable table;
+		return table;
+	}
+
+	void RGBToSpectrumTable::coefficients(const float rgb[3], float coeffs[3]) const {
+		if (rgb[0] == rgb[1] && rgb[1] == rgb[2]) {
+			// Constant spectrum, clamped since 0 and 1 are poles. Sigmoid of +-1e4 rounds to
+			// exactly 1 or 0, and squaring it in the sigmoid stays finite
+			coeffs[0] = coeffs[1] = 0.f;
+			coeffs[2] = Clamp((rgb[0] - .5f) / std::sqrt(rgb[0] * (1.f - rgb[0])), -1e4f, 1e4f);
+			return;
+		}
+
+		const int l = (rgb[0] > rgb[1]) ? (rgb[0] > rgb[2] ? 0 : 2) : (rgb[1] > rgb[2] ? 1 : 2);
+		const float z = rgb[l];
+		const float x = rgb[(l + 1) % 3] * float(RES - 1) / z;
+		const float y = rgb[(l + 2) % 3] * float(RES - 1) / z;
+
+		const int xi = Min(int(x), RES - 2), yi = Min(int(y), RES - 2);
+		const int zi = FindInterval(RES, [&](int i) { return m_scale[i] < z; });
+		const float dx = x - float(xi), dy = y - float(yi);
+		const float dz = (z - m_scale[zi]) / (m_scale[zi + 1] - m_scale[zi]);
+
+		auto at = [&](const int k, const int j, const int i) {
+			return &m_coeffs[((size_t(l) * RES + k) * RES + j) * RES * 3 + size_t(i) * 3];
+		};
+		for (int c = 0; c < 3; c++) {
+			coeffs[c] = Lerp(dz,
+				Lerp(dy, Lerp(dx, at(zi, yi, xi)[c], at(zi, yi, xi + 1)[c]),
+					Lerp(dx, at(zi, yi + 1, xi)[c], at(zi, yi + 1, xi + 1)[c])),
+				Lerp(dy, Lerp(dx, at(zi + 1, yi, xi)[c], at(zi + 1, yi, xi + 1)[c]),
+					Lerp(dx, at(zi + 1, yi + 1, xi)[c], at(zi + 1, yi + 1, xi + 1)[c])));
+		}
+	}
+
+	float RGBToSpectrumTable::illuminant(const float lambda) const {
+		return InterpolateSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_white, n_RGB_2spect_samples, lambda) / m_illuminantNorm;
+	}
+
+	SampledSpectrum SampledSpectrum::fromRGB(const float rgb[3], SpectrumType type) {
+		// An illuminant is a reflectance at half its largest component, scaled back and lit by the fit illuminant
+		float refl[3];
+		float scale = 1.f;
+		if (type == SpectrumType::Reflectance) {
+			for (int k = 0; k < 3; k++)
+				refl[k] = Clamp(rgb[k], 0.f, 1.f);
+		}
+		else {
+			const float m = Max(rgb[0], Max(rgb[1], rgb[2]));
+			if (m <= 0.f)
+				return SampledSpectrum(0.f);
+			scale = 2.f * m;
+			for (int k = 0; k < 3; k++)
+				refl[k] = Max(rgb[k], 0.f) / scale;
+		}
+
+		SampledSpectrum r;
+		if (refl[0] == refl[1] && refl[1] == refl[2])
+			r = SampledSpectrum(refl[0]);
+		else {
+			float coeffs[3];
+			RGBToSpectrumTable::get().coefficients(refl, coeffs);
+#if defined(AYA_USE_SIMD)
+			const __m128 c0 = _mm_set1_ps(coeffs[0]), c1 = _mm_set1_ps(coeffs[1]), c2 = _mm_set1_ps(coeffs[2]);
+			const __m128 half = _mm_set1_ps(.5f), one = _mm_set1_ps(1.f);
+			for (int i = 0; i < nChips; i++) {
+				const __m128 x = normalized_lambda.c[i].m_val128;
+				const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c0, x), c1), x), c2);
+				const __m128 d = _mm_sqrt_ps(_mm_add_ps(one, _mm_mul_ps(v, v)));
+				r.c[i].m_val128 = _mm_add_ps(half, _mm_mul_ps(half, _mm_div_ps(v, d)));
 			}
-			r *= .86445f;
+#else
+			for (int i = 0; i < n_spectral_samples; i++)
+				r.c[i] = RGBToSpectrumTable::evaluate(coeffs, normalized_lambda.c[i]);
+#endif
 		}
-		return r.clamp();
+
+		if (type == SpectrumType::Illuminant)
+			r = r * rgb_illuminant * scale;
+		return r;
 	}
 	SampledSpectrum::SampledSpectrum(const RGBSpectrum &r, SpectrumType type) {
 		float rgb[3];
@@ -150,6 +344,141 @@ namespace Aya {
 		*this = SampledSpectrum::fromRGB(rgb, type);
 	}
 
+	// Curves needed by hero wavelengths, tabulated at 1nm over the sampled range
+	struct HeroSpectrumTables {
+		static const int N_ENTRIES = 301;
+
+		float cie_x[N_ENTRIES], cie_y[N_ENTRIES], cie_z[N_ENTRIES];
+		float illum[N_ENTRIES];
+
+		HeroSpectrumTables() {
+			assert(N_ENTRIES == int(sampled_lambda_end - sampled_lambda_start) + 1);
+			const RGBToSpectrumTable &table = RGBToSpectrumTable::get();
+			for (int i = 0; i < N_ENTRIES; i++) {
+				const float l = sampled_lambda_start + float(i);
+				cie_x[i] = InterpolateSpectrumSamples(CIE_lambda, CIE_X, n_CIE_samples, l);
+				cie_y[i] = InterpolateSpectrumSamples(CIE_lambda, CIE_Y, n_CIE_samples, l);
+				cie_z[i] = InterpolateSpectrumSamples(CIE_lambda, CIE_Z, n_CIE_samples, l);
+				illum[i] = table.illuminant(l);
+			}
+		}
+
+		static float lookup(const float *table, const float l) {
+			const float x = Clamp(l - sampled_lambda_start, 0.f, float(N_ENTRIES - 1));
+			const int i = Min(int(x), N_ENTRIES - 2);
+			return Lerp(x - float(i), table[i], table[i + 1]);
+		}
+		static const HeroSpectrumTables& get() {
+			static const HeroSpectrumTables tables;
+			return tables;
+		}
+	};
+
+	SampledWavelengths SampledWavelengths::sampleUniform(const float u) {
+		const HeroSpectrumTables &tables = HeroSpectrumTables::get();
+		const float range = sampled_lambda_end - sampled_lambda_start;
+		const float delta = range / float(n_hero_wavelengths);
+
+		SampledWavelengths ret;
+		ret.lambda[0] = Lerp(u, sampled_lambda_start, sampled_lambda_end);
+		for (int i = 1; i < n_hero_wavelengths; i++) {
+			float l = ret.lambda[0] + float(i) * delta;
+			if (l > sampled_lambda_end)
+				l -= range;
+			ret.lambda[i] = l;
+		}
+		for (int i = 0; i < n_hero_wavelengths; i++) {
+			ret.pdf[i] = 1.f / range;
+			ret.illuminant[i] = HeroSpectrumTables::lookup(tables.illum, ret.lambda[i]);
+		}
+		ret.updateWeights();
+
+		return ret;
+	}
+	void SampledWavelengths::terminateSecondary() {
+		if (secondaryTerminated())
+			return;
+
+		for (int i = 1; i < n_hero_wavelengths; i++)
+			pdf[i] = 0.f;
+		pdf[0] /= float(n_hero_wavelengths);
+		updateWeights();
+	}
+	void SampledWavelengths::updateWeights() {
+		const HeroSpectrumTables &tables = HeroSpectrumTables::get();
+		for (int i = 0; i < n_hero_wavelengths; i++) {
+			if (pdf[i] == 0.f) {
+				weight_x[i] = weight_y[i] = weight_z[i] = 0.f;
+				continue;
+			}
+			const float scale = 1.f / (pdf[i] * float(n_hero_wavelengths) * CIE_Y_integral);
+			weight_x[i] = HeroSpectrumTables::lookup(tables.cie_x, lambda[i]) * scale;
+			weight_y[i] = HeroSpectrumTables::lookup(tables.cie_y, lambda[i]) * scale;
+			weight_z[i] = HeroSpectrumTables::lookup(tables.cie_z, lambda[i]) * scale;
+		}
+	}
+	SampledWavelengths& SampledWavelengths::current() {
+		static thread_local SampledWavelengths wavelengths = sampleUniform(.5f);
+		return wavelengths;
+	}
+
+	HeroSpectrum HeroSpectrum::fromSampled(const float *lambda, const float *v, int n) {
+		if (!SpectrumSamplesSorted(lambda, v, n)) {
+			std::vector<float> sl(&lambda[0], &lambda[n]);
+			std::vector<float> sv(&v[0], &v[n]);
+			SortSpectrumSamples(&sl[0], &sv[0], n);
+			return fromSampled(&sl[0], &sv[0], n);
+		}
+
+		const SampledWavelengths &wavelengths = SampledWavelengths::current();
+		HeroSpectrum ret;
+		for (int i = 0; i < n_hero_wavelengths; i++)
+			ret[i] = InterpolateSpectrumSamples(lambda, v, n, wavelengths.lambda[i]);
+		return ret;
+	}
+	HeroSpectrum HeroSpectrum::fromRGB(const float rgb[3], SpectrumType type) {
+		// Same sigmoid fit as SampledSpectrum, evaluated at the current wavelengths only
+		float refl[3];
+		float scale = 1.f;
+		if (type == SpectrumType::Reflectance) {
+			for (int k = 0; k < 3; k++)
+				refl[k] = Clamp(rgb[k], 0.f, 1.f);
+		}
+		else {
+			const float m = Max(rgb[0], Max(rgb[1], rgb[2]));
+			if (m <= 0.f)
+				return HeroSpectrum(0.f);
+			scale = 2.f * m;
+			for (int k = 0; k < 3; k++)
+				refl[k] = Max(rgb[k], 0.f) / scale;
+		}
+
+		const SampledWavelengths &wavelengths = SampledWavelengths::current();
+		HeroSpectrum r;
+		if (refl[0] == refl[1] && refl[1] == refl[2])
+			r = HeroSpectrum(refl[0]);
+		else {
+			float coeffs[3];
+			RGBToSpectrumTable::get().coefficients(refl, coeffs);
+			for (int i = 0; i < n_hero_wavelengths; i++)
+				r[i] = RGBToSpectrumTable::evaluate(coeffs, RGBToSpectrumTable::normalizedLambda(wavelengths.lambda[i]));
+		}
+
+		if (type == SpectrumType::Illuminant)
+			r *= wavelengths.illuminant * scale;
+		return r;
+	}
+	HeroSpectrum::HeroSpectrum(const RGBSpectrum &r, SpectrumType type) {
+		float rgb[3];
+		r.toRGB(rgb);
+		*this = HeroSpectrum::fromRGB(rgb, type);
+	}
+	RGBSpectrum HeroSpectrum::toRGBSpectrum(const SampledWavelengths &wavelengths) const {
+		float rgb[3];
+		toRGB(rgb, wavelengths);
+		return RGBSpectrum::fromRGB(rgb);
+	}
+
 	const float CIE_X[n_CIE_samples] = {
 		// CIE X function values
 		0.0001299000f,   0.0001458470f,   0.0001638021f,   0.0001840037f,
@@ -904,20 +1233,8 @@ namespace Aya {
 	SampledSpectrum SampledSpectrum::X;
 	SampledSpectrum SampledSpectrum::Y;
 	SampledSpectrum SampledSpectrum::Z;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_white;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_cyan;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_magenta;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_yellow;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_red;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_green;
-	SampledSpectrum SampledSpectrum::rgb_refl_2spect_blue;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_white;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_cyan;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_magenta;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_yellow;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_red;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_green;
-	SampledSpectrum SampledSpectrum::rgb_illum_2spect_blue;
+	SampledSpectrum SampledSpectrum::normalized_lambda;
+	SampledSpectrum SampledSpectrum::rgb_illuminant;
 
 	const float RGB_2spect_lambda[n_RGB_2spect_samples] = {
 	380.000000f, 390.967743f, 401.935486f, 412.903229f, 423.870972f, 434.838715f,
@@ -1108,6 +1425,73 @@ namespace Aya {
 		1.4878477178237029e-01f,  1.6624255403475907e-01f,  1.6997613960634927e-01f,
 		1.5769743995852967e-01f,  1.9069090525482305e-01f };
 
+	const float sRGB8Spectrum::to_linear[256] = {
+		// sRGB transfer function decoded at every 8 bit code
+		0.000000000e+00f, 3.035269835e-04f, 6.070539671e-04f, 9.105809506e-04f,
+		1.214107934e-03f, 1.517634918e-03f, 1.821161901e-03f, 2.124688885e-03f,
+		2.428215868e-03f, 2.731742852e-03f, 3.035269835e-03f, 3.346535764e-03f,
+		3.676507324e-03f, 4.024717018e-03f, 4.391442037e-03f, 4.776953481e-03f,
+		5.181516702e-03f, 5.605391624e-03f, 6.048833023e-03f, 6.512090793e-03f,
+		6.995410187e-03f, 7.499032043e-03f, 8.023192985e-03f, 8.568125618e-03f,
+		9.134058702e-03f, 9.721217320e-03f, 1.032982303e-02f, 1.096009401e-02f,
+		1.161224518e-02f, 1.228648836e-02f, 1.298303234e-02f, 1.370208305e-02f,
+		1.444384360e-02f, 1.520851442e-02f, 1.599629337e-02f, 1.680737575e-02f,
+		1.764195449e-02f, 1.850022013e-02f, 1.938236096e-02f, 2.028856306e-02f,
+		2.121901038e-02f, 2.217388479e-02f, 2.315336618e-02f, 2.415763245e-02f,
+		2.518685963e-02f, 2.624122189e-02f, 2.732089164e-02f, 2.842603950e-02f,
+		2.955683444e-02f, 3.071344373e-02f, 3.189603307e-02f, 3.310476657e-02f,
+		3.433980681e-02f, 3.560131488e-02f, 3.688945040e-02f, 3.820437160e-02f,
+		3.954623528e-02f, 4.091519691e-02f, 4.231141062e-02f, 4.373502926e-02f,
+		4.518620439e-02f, 4.666508634e-02f, 4.817182423e-02f, 4.970656598e-02f,
+		5.126945837e-02f, 5.286064702e-02f, 5.448027644e-02f, 5.612849005e-02f,
+		5.780543019e-02f, 5.951123816e-02f, 6.124605423e-02f, 6.301001765e-02f,
+		6.480326669e-02f, 6.662593864e-02f, 6.847816984e-02f, 7.036009570e-02f,
+		7.227185068e-02f, 7.421356838e-02f, 7.618538148e-02f, 7.818742181e-02f,
+		8.021982031e-02f, 8.228270713e-02f, 8.437621154e-02f, 8.650046204e-02f,
+		8.865558629e-02f, 9.084171118e-02f, 9.305896285e-02f, 9.530746663e-02f,
+		9.758734714e-02f, 9.989872825e-02f, 1.022417331e-01f, 1.046164841e-01f,
+		1.070231030e-01f, 1.094617108e-01f, 1.119324278e-01f, 1.144353738e-01f,
+		1.169706678e-01f, 1.195384280e-01f, 1.221387722e-01f, 1.247718176e-01f,
+		1.274376804e-01f, 1.301364767e-01f, 1.328683216e-01f, 1.356333297e-01f,
+		1.384316150e-01f, 1.412632911e-01f, 1.441284709e-01f, 1.470272665e-01f,
+		1.499597898e-01f, 1.529261520e-01f, 1.559264637e-01f, 1.589608351e-01f,
+		1.620293756e-01f, 1.651321945e-01f, 1.682694002e-01f, 1.714411007e-01f,
+		1.746474037e-01f, 1.778884160e-01f, 1.811642442e-01f, 1.844749945e-01f,
+		1.878207723e-01f, 1.912016827e-01f, 1.946178304e-01f, 1.980693196e-01f,
+		2.015562538e-01f, 2.050787364e-01f, 2.086368701e-01f, 2.122307574e-01f,
+		2.158605001e-01f, 2.195261997e-01f, 2.232279573e-01f, 2.269658735e-01f,
+		2.307400485e-01f, 2.345505822e-01f, 2.383975738e-01f, 2.422811225e-01f,
+		2.462013267e-01f, 2.501582847e-01f, 2.541520943e-01f, 2.581828529e-01f,
+		2.622506575e-01f, 2.663556048e-01f, 2.704977910e-01f, 2.746773121e-01f,
+		2.788942635e-01f, 2.831487404e-01f, 2.874408377e-01f, 2.917706498e-01f,
+		2.961382708e-01f, 3.005437944e-01f, 3.049873141e-01f, 3.094689228e-01f,
+		3.139887134e-01f, 3.185467781e-01f, 3.231432091e-01f, 3.277780981e-01f,
+		3.324515363e-01f, 3.371636150e-01f, 3.419144249e-01f, 3.467040564e-01f,
+		3.515325995e-01f, 3.564001441e-01f, 3.613067798e-01f, 3.662525956e-01f,
+		3.712376805e-01f, 3.762621230e-01f, 3.813260114e-01f, 3.864294338e-01f,
+		3.915724777e-01f, 3.967552307e-01f, 4.019777798e-01f, 4.072402119e-01f,
+		4.125426135e-01f, 4.178850708e-01f, 4.232676700e-01f, 4.286904966e-01f,
+		4.341536362e-01f, 4.396571738e-01f, 4.452011945e-01f, 4.507857828e-01f,
+		4.564110232e-01f, 4.620769997e-01f, 4.677837961e-01f, 4.735314961e-01f,
+		4.793201831e-01f, 4.851499401e-01f, 4.910208498e-01f, 4.969329951e-01f,
+		5.028864580e-01f, 5.088813209e-01f, 5.149176654e-01f, 5.209955732e-01f,
+		5.271151257e-01f, 5.332764040e-01f, 5.394794890e-01f, 5.457244614e-01f,
+		5.520114015e-01f, 5.583403896e-01f, 5.647115057e-01f, 5.711248295e-01f,
+		5.775804404e-01f, 5.840784179e-01f, 5.906188409e-01f, 5.972017884e-01f,
+		6.038273389e-01f, 6.104955708e-01f, 6.172065624e-01f, 6.239603917e-01f,
+		6.307571363e-01f, 6.375968740e-01f, 6.444796820e-01f, 6.514056374e-01f,
+		6.583748173e-01f, 6.653872983e-01f, 6.724431570e-01f, 6.795424696e-01f,
+		6.866853124e-01f, 6.938717613e-01f, 7.011018919e-01f, 7.083757799e-01f,
+		7.156935005e-01f, 7.230551289e-01f, 7.304607401e-01f, 7.379104088e-01f,
+		7.454042095e-01f, 7.529422168e-01f, 7.605245047e-01f, 7.681511472e-01f,
+		7.758222183e-01f, 7.835377915e-01f, 7.912979403e-01f, 7.991027380e-01f,
+		8.069522577e-01f, 8.148465722e-01f, 8.227857544e-01f, 8.307698768e-01f,
+		8.387990117e-01f, 8.468732315e-01f, 8.549926081e-01f, 8.631572135e-01f,
+		8.713671192e-01f, 8.796223969e-01f, 8.879231179e-01f, 8.962693534e-01f,
+		9.046611744e-01f, 9.130986518e-01f, 9.215818563e-01f, 9.301108584e-01f,
+		9.386857285e-01f, 9.473065367e-01f, 9.559733532e-01f, 9.646862479e-01f,
+		9.734452904e-01f, 9.822505503e-01f, 9.911020971e-01f, 1.000000000e+00f };
+
 	SampledSpectrum::SampledSpectrum(const byteSpectrum &bs) noexcept {
 		float rgb[3] = { float(bs.r / 255.f), float(bs.g / 255.f), float(bs.b / 255.f) };
 		(*this) = fromRGB(rgb);
@@ -1118,6 +1502,11 @@ namespace Aya {
 		return *this;
 	}
 
+	HeroSpectrum::HeroSpectrum(const byteSpectrum &bs) noexcept {
+		float rgb[3] = { float(bs.r / 255.f), float(bs.g / 255.f), float(bs.b / 255.f) };
+		(*this) = fromRGB(rgb, SpectrumType::Reflectance);
+	}
+
 	RGBSpectrum::RGBSpectrum(const byteSpectrum &bs) noexcept {
 		(*this)[0] = float(bs.r / 255.f);
 		(*this)[1] = float(bs.g / 255.f);
@@ -61,6 +61,42 @@ namespace Aya {
 	extern const float RGB_illum_2spect_green[n_RGB_2spect_samples];
 	extern const float RGB_illum_2spect_blue[n_RGB_2spect_samples];
 
+	// Sigmoid polynomial RGB upsampling (Jakob and Hanika 2019), a reflectance rgb becomes
+	// sigmoid(c0 x^2 + c1 x + c2) with x the wavelength normalized over the sampled range.
+	// The coefficients are fitted on a grid indexed by the largest component, the first run
+	// stores the table in the user cache directory and later runs load it
+	class RGBToSpectrumTable {
+	public:
+		static const int RES = 32;
+
+		static const RGBToSpectrumTable& get();
+
+		// Trilinearly interpolated coefficients, rgb must lie in [0, 1]
+		void coefficients(const float rgb[3], float coeffs[3]) const;
+		// Illuminant the reflectances are fitted under, normalized to unit luminance
+		float illuminant(const float lambda) const;
+
+		static AYA_FORCE_INLINE float sigmoid(const float v) {
+			if (std::isinf(v))
+				return v > 0.f ? 1.f : 0.f;
+			return .5f + v / (2.f * std::sqrt(1.f + v * v));
+		}
+		static AYA_FORCE_INLINE float evaluate(const float coeffs[3], const float x) {
+			return sigmoid((coeffs[0] * x + coeffs[1]) * x + coeffs[2]);
+		}
+		static AYA_FORCE_INLINE float normalizedLambda(const float lambda) {
+			return (lambda - sampled_lambda_start) / (sampled_lambda_end - sampled_lambda_start);
+		}
+
+	private:
+		RGBToSpectrumTable();
+
+		float m_illuminantNorm;
+		float m_scale[RES];
+		// [largest component][z][y][x][coefficient]
+		std::vector<float> m_coeffs;
+	};
+
 	template<int n_samples>
 	class CoefficientSpectrum {
 	public:
@@ -93,8 +129,8 @@ namespace Aya {
 				cc = v0;
 			}
 #else
-			for (int i = 0; i < nSamples; i++) {
-				c[i] = 0;
+			for (int i = 0; i < nChips * 4; i++) {
+				c[i] = val;
 			}
 #endif
 		}
@@ -324,14 +360,14 @@ namespace Aya {
 		CoefficientSpectrum exp() const {
 			CoefficientSpectrum ret;
 			for (int i = 0; i < nSamples; i++) {
-				ret[i] = std::expf((*this)[i]);
+				ret[i] = std::exp((*this)[i]);
 			}
 			return ret;
 		}
 		CoefficientSpectrum pow(float p) const {
 			CoefficientSpectrum ret;
 			for (int i = 0; i < nSamples; i++) {
-				ret[i] = std::powf((*this)[i], p);
+				ret[i] = std::pow((*this)[i], p);
 			}
 			return ret;
 		}
@@ -383,18 +419,14 @@ namespace Aya {
 	class byteSpectrum;
 	class RGBSpectrum;
 	class SampledSpectrum;
+	class HeroSpectrum;
 
 	class SampledSpectrum : public CoefficientSpectrum<n_spectral_samples> {
 	public:
 		// SampledSpectrum Private Data
 		static SampledSpectrum X, Y, Z;
-		static SampledSpectrum rgb_refl_2spect_white, rgb_illum_2spect_white;
-		static SampledSpectrum rgb_refl_2spect_magenta, rgb_illum_2spect_magenta;
-		static SampledSpectrum rgb_refl_2spect_red, rgb_illum_2spect_red;
-		static SampledSpectrum rgb_refl_2spect_blue, rgb_illum_2spect_blue;
-		static SampledSpectrum rgb_refl_2spect_cyan, rgb_illum_2spect_cyan;
-		static SampledSpectrum rgb_refl_2spect_yellow, rgb_illum_2spect_yellow;
-		static SampledSpectrum rgb_refl_2spect_green, rgb_illum_2spect_green;
+		// Bin centers normalized over the sampled range and the upsampling illuminant at them
+		static SampledSpectrum normalized_lambda, rgb_illuminant;
 
 	public:
 		SampledSpectrum(const float val = 0.f) noexcept : CoefficientSpectrum(val) {}
@@ -434,40 +466,16 @@ namespace Aya {
 				Z[i] = AverageSpectrumSamples(CIE_lambda, CIE_Z, n_CIE_samples, wl0, wl1);
 			}
 			// Compute RGB
+			const RGBToSpectrumTable &table = RGBToSpectrumTable::get();
 			for (int i = 0; i < n_spectral_samples; i++) {
 				float wl0 = Lerp(float(i) / float(n_spectral_samples),
 					sampled_lambda_start, sampled_lambda_end);
 				float wl1 = Lerp(float(i + 1) / float(n_spectral_samples),
 					sampled_lambda_start, sampled_lambda_end);
 
-				rgb_refl_2spect_white[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_white, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_cyan[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_cyan, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_magenta[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_magenta, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_yellow[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_yellow, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_red[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_red, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_green[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_green, n_RGB_2spect_samples, wl0, wl1);
-				rgb_refl_2spect_blue[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_refl_2spect_blue, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_white[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_white, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_cyan[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_cyan, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_magenta[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_magenta, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_yellow[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_yellow, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_red[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_red, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_green[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_green, n_RGB_2spect_samples, wl0, wl1);
-				rgb_illum_2spect_blue[i] =
-					AverageSpectrumSamples(RGB_2spect_lambda, RGB_illum_2spect_blue, n_RGB_2spect_samples, wl0, wl1);
+				normalized_lambda[i] = (float(i) + .5f) / float(n_spectral_samples);
+				rgb_illuminant[i] = table.illuminant(.5f * (wl0 + wl1));
+
 			}
 		}
 
@@ -579,6 +587,117 @@ namespace Aya {
 		}
 	};
 
+	// Hero wavelength sampling (Wilkie et al. 2014), a path carries a few stochastically
+	// chosen wavelengths instead of the fixed bins of SampledSpectrum
+	static const int n_hero_wavelengths = 4;
+	typedef CoefficientSpectrum<n_hero_wavelengths> WavelengthSamples;
+
+	class SampledWavelengths {
+	public:
+		WavelengthSamples lambda, pdf;
+		// Matching functions already divided by pdf and normalization, zero for terminated wavelengths
+		WavelengthSamples weight_x, weight_y, weight_z;
+		// Upsampling illuminant at lambda
+		WavelengthSamples illuminant;
+
+	public:
+		// Hero wavelength from u, the others evenly rotated through the range
+		static SampledWavelengths sampleUniform(const float u);
+
+		// Keeps only the hero wavelength, called by the integrators once a path direction
+		// depends on the wavelength
+		void terminateSecondary();
+		bool secondaryTerminated() const {
+			return pdf[1] == 0.f;
+		}
+
+		// Wavelengths scene spectra are upsampled at on the calling thread, only lambda is read.
+		// Weights come from the wavelengths the integrator passes along with a path
+		static SampledWavelengths& current();
+
+	private:
+		void updateWeights();
+	};
+
+	class HeroSpectrum : public CoefficientSpectrum<n_hero_wavelengths> {
+	public:
+		HeroSpectrum(const float val = 0.f) noexcept : CoefficientSpectrum(val) {}
+		HeroSpectrum(const CoefficientSpectrum<n_hero_wavelengths> &s) noexcept :
+			CoefficientSpectrum<n_hero_wavelengths>(s) {}
+
+		HeroSpectrum(const byteSpectrum &bs) noexcept;
+		HeroSpectrum(const RGBSpectrum &r, SpectrumType type = SpectrumType::Reflectance);
+
+		static HeroSpectrum fromSampled(const float *lambda, const float *v, int n);
+		static HeroSpectrum fromRGB(const float rgb[3], SpectrumType type = SpectrumType::Illuminant);
+		static HeroSpectrum fromRGB(const float &r, const float &g, const float &b, SpectrumType type = SpectrumType::Illuminant) {
+			float rgb[3] = { r, g, b };
+			return fromRGB(rgb, type);
+		}
+		static HeroSpectrum fromXYZ(const float xyz[3], SpectrumType type = SpectrumType::Reflectance) {
+			float rgb[3];
+			XYZToRGB(xyz, rgb);
+			return fromRGB(rgb, type);
+		}
+
+		// Monte Carlo estimate of the XYZ integrals over the wavelengths the path carried
+		void toXYZ(float xyz[3], const SampledWavelengths &wavelengths) const {
+			xyz[0] = xyz[1] = xyz[2] = 0.f;
+			for (int i = 0; i < n_hero_wavelengths; i++) {
+				xyz[0] += wavelengths.weight_x[i] * (*this)[i];
+				xyz[1] += wavelengths.weight_y[i] * (*this)[i];
+				xyz[2] += wavelengths.weight_z[i] * (*this)[i];
+			}
+		}
+		float luminance(const SampledWavelengths &wavelengths) const {
+			float yy = 0.f;
+			for (int i = 0; i < n_hero_wavelengths; i++) {
+				yy += wavelengths.weight_y[i] * (*this)[i];
+			}
+			return yy;
+		}
+
+		// Plain mean of the values, needs no wavelengths
+		float average() const {
+			float sum = 0.f;
+			for (int i = 0; i < n_hero_wavelengths; i++)
+				sum += (*this)[i];
+			return sum / float(n_hero_wavelengths);
+		}
+
+		bool isBlack() const {
+			for (int i = 0; i < n_hero_wavelengths; i++) {
+				if ((*this)[i] != 0.f) return false;
+			}
+			return true;
+		}
+		bool isValid() const {
+			for (int i = 0; i < n_hero_wavelengths; i++) {
+				if (!std::isfinite((*this)[i])) return false;
+			}
+			return true;
+		}
+
+		void toRGB(float rgb[3], const SampledWavelengths &wavelengths) const {
+			float xyz[3];
+			toXYZ(xyz, wavelengths);
+			XYZToRGB(xyz, rgb);
+		}
+
+		RGBSpectrum toRGBSpectrum(const SampledWavelengths &wavelengths) const;
+		const HeroSpectrum & toHeroSpectrum() const {
+			return *this;
+		}
+
+		friend inline std::ostream &operator << (std::ostream &os, const HeroSpectrum &s) {
+			os << "(" << n_hero_wavelengths << ")[ ";
+			for (int i = 0; i < n_hero_wavelengths; i++) {
+				os << AYA_SCALAR_OUTPUT(s[i]) << (i < n_hero_wavelengths - 1 ? ", " : " ]");
+			}
+			return os;
+		}
+	};
+
 	class RGBSpectrum : public CoefficientSpectrum<3> {
 	public:
 		RGBSpectrum(const float val = 0.f) noexcept : CoefficientSpectrum<3>(val) {
@@ -663,6 +782,9 @@ namespace Aya {
 			toRGB(rgb);
 			return SampledSpectrum::fromRGB(rgb);
 		}
+		HeroSpectrum toHeroSpectrum() const {
+			return HeroSpectrum(*this);
+		}
 		float luminance() const {
 			const float yy[3] = { 0.212671f, 0.715160f, 0.072169f };
 			return yy[0] * (*this)[0] + yy[1] * (*this)[1] + yy[2] * (*this)[2];
@@ -686,14 +808,53 @@ namespace Aya {
 		}
 	};
 
-#ifdef AYA_SAMPLED_SPECTRUM
+#if defined(AYA_HERO_SPECTRUM)
+	typedef HeroSpectrum Spectrum;
+	// Spectra kept in the scene stay RGB, each path upsamples them at its own wavelengths
+	typedef RGBSpectrum StoredSpectrum;
+#define toSpectrum toHeroSpectrum
+#elif defined(AYA_SAMPLED_SPECTRUM)
 	typedef SampledSpectrum Spectrum;
+	typedef SampledSpectrum StoredSpectrum;
 #define toSpectrum toSampledSpectrum
 #else
 	typedef RGBSpectrum Spectrum;
+	typedef RGBSpectrum StoredSpectrum;
 #define toSpectrum toRGBSpectrum
 #endif
 
+	// Converts between the representation stored in the scene or film and the one carried by paths
+	inline Spectrum FromStored(const StoredSpectrum &s, SpectrumType type = SpectrumType::Reflectance) {
+#if defined(AYA_HERO_SPECTRUM)
+		return HeroSpectrum(s, type);
+#else
+		return s;
+#endif
+	}
+	inline StoredSpectrum ToStored(const Spectrum &s, const SampledWavelengths &wavelengths) {
+#if defined(AYA_HERO_SPECTRUM)
+		return s.toRGBSpectrum(wavelengths);
+#else
+		return s;
+#endif
+	}
+	// Luminance of a path spectrum, the wavelengths are only read by hero spectra
+	inline float Luminance(const Spectrum &s, const SampledWavelengths &wavelengths) {
+#if defined(AYA_HERO_SPECTRUM)
+		return s.luminance(wavelengths);
+#else
+		return s.luminance();
+#endif
+	}
+	// Brightness for heuristics without wavelengths at hand, e.g. inside BSDFs
+	inline float ApproxLuminance(const Spectrum &s) {
+#if defined(AYA_HERO_SPECTRUM)
+		return s.average();
+#else
+		return s.luminance();
+#endif
+	}
+
 	typedef short Byte;
 	class byteSpectrum {
 	public:
@@ -770,5 +931,92 @@ namespace Aya {
 			return *this;
 		}
 	};
+
+	// Compact texel formats, filtered as the RGBSpectrum they decode to
+	class halfSpectrum {
+	public:
+		uint16_t r, g, b;
+
+		halfSpectrum() : r(0), g(0), b(0) {}
+		halfSpectrum(const RGBSpectrum &c) noexcept {
+			// Clamped to the largest finite half, a bright sun must not turn into Inf
+			r = FloatToHalf(Min(c[0], 65504.f));
+			g = FloatToHalf(Min(c[1], 65504.f));
+			b = FloatToHalf(Min(c[2], 65504.f));
+		}
+		AYA_FORCE_INLINE RGBSpectrum toRGBSpectrum() const {
+			return RGBSpectrum(HalfToFloat(r), HalfToFloat(g), HalfToFloat(b));
+		}
+	};
+
+	// Shared exponent RGB, 9 bit mantissas and a 5 bit exponent in one word
+	class rgb9e5Spectrum {
+	public:
+		static const int MANTISSA_BITS = 9;
+		static const int EXP_BIAS = 15;
+		static const int MAX_EXP = 31;
+
+		uint32_t v;
+
+		rgb9e5Spectrum() : v(0) {}
+		rgb9e5Spectrum(const RGBSpectrum &c) noexcept {
+			const float max_val = float((1 << MANTISSA_BITS) - 1) / float(1 << MANTISSA_BITS) * float(1 << (MAX_EXP - EXP_BIAS));
+			const float rc = Clamp(c[0], 0.f, max_val);
+			const float gc = Clamp(c[1], 0.f, max_val);
+			const float bc = Clamp(c[2], 0.f, max_val);
+			const float maxc = Max(rc, Max(gc, bc));
+			if (!(maxc > 0.f)) {
+				v = 0;
+				return;
+			}
+
+			// frexp gives maxc = m * 2^e with m in [.5, 1)
+			int e;
+			std::frexp(maxc, &e);
+			int exp_shared = Max(-EXP_BIAS - 1, e - 1) + 1 + EXP_BIAS;
+			float denom = std::ldexp(1.f, exp_shared - EXP_BIAS - MANTISSA_BITS);
+			if (int(std::floor(maxc / denom + .5f)) == 1 << MANTISSA_BITS) {
+				denom *= 2.f;
+				exp_shared++;
+			}
+
+			const uint32_t rm = uint32_t(std::floor(rc / denom + .5f));
+			const uint32_t gm = uint32_t(std::floor(gc / denom + .5f));
+			const uint32_t bm = uint32_t(std::floor(bc / denom + .5f));
+			v = rm | (gm << 9) | (bm << 18) | (uint32_t(exp_shared) << 27);
+		}
+		AYA_FORCE_INLINE RGBSpectrum toRGBSpectrum() const {
+			const float scale = std::ldexp(1.f, int(v >> 27) - EXP_BIAS - MANTISSA_BITS);
+			return RGBSpectrum(float(v & 0x1ff) * scale, float((v >> 9) & 0x1ff) * scale, float((v >> 18) & 0x1ff) * scale);
+		}
+	};
+
+	// 8 bit sRGB encoded color with linear alpha
+	class sRGB8Spectrum {
+	public:
+		static const float to_linear[256];
+
+		uint8_t r, g, b, a;
+
+		sRGB8Spectrum() : r(0), g(0), b(0), a(255) {}
+		sRGB8Spectrum(uint8_t R, uint8_t G, uint8_t B, uint8_t A = 255) : r(R), g(G), b(B), a(A) {}
+		sRGB8Spectrum(const RGBSpectrum &c) noexcept {
+			r = encode(c[0]);
+			g = encode(c[1]);
+			b = encode(c[2]);
+			a = uint8_t(Clamp(int(c[3] * 255.f + .5f), 0, 255));
+		}
+		AYA_FORCE_INLINE RGBSpectrum toRGBSpectrum() const {
+			RGBSpectrum ret = RGBSpectrum(to_linear[r], to_linear[g], to_linear[b]);
+			ret[3] = float(a) / 255.f;
+			return ret;
+		}
+
+		static uint8_t encode(const float linear) {
+			const float v = Clamp(linear, 0.f, 1.f);
+			const float s = v <= .0031308f ? 12.92f * v : 1.055f * std::pow(v, 1.f / 2.4f) - .055f;
+			return uint8_t(Clamp(int(s * 255.f + .5f), 0, 255));
+		}
+	};
 }
 #endif
\ No newline at end of file
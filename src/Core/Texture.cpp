@@ -1,49 +1,348 @@
 #include <Core/Texture.h>
 
+#include <atomic>
 #include <cstring>
+#include <string>
+#include <ppl.h>
 
 namespace Aya {
 	template<class T>
-	inline void Mipmap2D<T>::generate(const Vector2i &dims, const T *raw_tex) {
+	std::vector<Vector2i> Mipmap2D<T>::levelDims(const Vector2i &dims) {
+		const int levels = Max(int(CeilLog2(Max(dims.x, dims.y))), 1);
+		std::vector<Vector2i> ret(levels);
+		ret[0] = dims;
+		for (auto l = 1; l < levels; l++)
+			ret[l] = Vector2i(Max(ret[l - 1].x >> 1, 1), Max(ret[l - 1].y >> 1, 1));
+		return ret;
+	}
+
+	template<class T>
+	void Mipmap2D<T>::initLevels(const Vector2i &dims) {
 		m_texDims = dims;
-		m_levels = CeilLog2(Max(dims.x, dims.y));
-		SetMax(m_levels, 1);
+		m_levelDims = levelDims(dims);
+		m_levels = int(m_levelDims.size());
+	}
 
-		mp_leveled_texels = new BlockedArray<T>[m_levels];
-		mp_leveled_texels[0].init(dims.y, dims.x, raw_tex);
+	static std::atomic<MipFilter> DefaultMipFilter(MipFilter::Box);
 
-		Vector2i level_dims = m_texDims;
-		for (auto l = 1; l < m_levels; l++) {
-			level_dims.x = Max(level_dims.x >> 1, 1);
-			level_dims.y = Max(level_dims.y >> 1, 1);
+	void SetMipFilter(const MipFilter filter) {
+		DefaultMipFilter = filter;
+	}
+	MipFilter GetMipFilter() {
+		return DefaultMipFilter;
+	}
 
-			mp_leveled_texels[l].init(level_dims.y, level_dims.x);
-			for (auto x = 0; x < level_dims.x; x++)
-				for (auto y = 0; y < level_dims.y; y++) {
-					Vector2i idx0, idx1;
+	// Taps of one axis of a region resampled from the next finer level
+	struct MipAxisWeights {
+		int taps;
+		// First finer texel of every coarser one, before clamping to the edge
+		std::vector<int> first;
+		std::vector<float> weights;
+	};
+
+	static float Sinc(const float x) {
+		if (Abs(x) < 1e-5f)
+			return 1.f;
+		const float px = float(M_PI) * x;
+		return std::sin(px) / px;
+	}
+	// Zeroth order modified Bessel function of the first kind
+	static float BesselI0(const float x) {
+		float sum = 1.f, term = 1.f;
+		const float quarter_x2 = .25f * x * x;
+		for (int k = 1; k < 32 && term > 1e-7f * sum; k++) {
+			term *= quarter_x2 / float(k * k);
+			sum += term;
+		}
+		return sum;
+	}
 
-					if (level_dims.x < mp_leveled_texels[l - 1].v()) {
-						idx0.x = x << 1;
-						idx1.x = x << 1 | 1;
-					}
-					else
-						idx0.x = idx1.x = x;
+	static MipAxisWeights AxisWeights(const MipFilter filter, const int finer_res, const int res, const int begin, const int count) {
+		MipAxisWeights ret;
+		if (res == finer_res) {
+			ret.taps = 1;
+			ret.first.resize(count);
+			ret.weights.assign(count, 1.f);
+			for (auto i = 0; i < count; i++)
+				ret.first[i] = begin + i;
+			return ret;
+		}
 
-					if (level_dims.y < mp_leveled_texels[l - 1].u()) {
-						idx0.y = y << 1;
-						idx1.y = y << 1 | 1;
+		// Kernels are evaluated at finer texel centers in units of coarser texels
+		const int LOBES = 3;
+		const float KAISER_ALPHA = 4.f;
+		const float scale = float(finer_res) / float(res);
+		const float radius = filter == MipFilter::Box ? .5f * scale : LOBES * scale;
+		const int max_taps = CeilToInt(2.f * radius) + 2;
+
+		std::vector<float> taps(max_taps);
+		std::vector<int> span_first(count), span_count(count);
+		std::vector<float> span_weights(size_t(count) * max_taps);
+		ret.taps = 1;
+		for (auto i = 0; i < count; i++) {
+			const float center = (begin + i + .5f) * scale;
+			const int first = FloorToInt(center - radius);
+			float sum = 0.f;
+			for (auto k = 0; k < max_taps; k++) {
+				const float x = first + k + .5f;
+				float w;
+				if (filter == MipFilter::Box)
+					w = Max(0.f, Min(x + .5f, center + radius) - Max(x - .5f, center - radius));
+				else {
+					const float t = (x - center) / scale;
+					if (Abs(t) >= LOBES)
+						w = 0.f;
+					else if (filter == MipFilter::Lanczos)
+						w = Sinc(t) * Sinc(t / LOBES);
+					else {
+						const float r = t / LOBES;
+						w = Sinc(t) * BesselI0(KAISER_ALPHA * std::sqrt(1.f - r * r)) / BesselI0(KAISER_ALPHA);
 					}
-					else
-						idx0.y = idx1.y = y;
-
-					T sum = T(0);
-					sum += mp_leveled_texels[l - 1](idx0.y, idx0.x);
-					sum += mp_leveled_texels[l - 1](idx1.y, idx1.x);
-					sum += mp_leveled_texels[l - 1](idx0.y, idx1.x);
-					sum += mp_leveled_texels[l - 1](idx1.y, idx0.x);
-					mp_leveled_texels[l](y, x) = sum / 4;
 				}
+				taps[k] = w;
+				sum += w;
+			}
+
+			// Zero taps at both ends are trimmed, they would only cost fetches
+			int lo = 0, hi = max_taps - 1;
+			while (lo < hi && taps[lo] == 0.f) lo++;
+			while (hi > lo && taps[hi] == 0.f) hi--;
+			span_first[i] = first + lo;
+			span_count[i] = hi - lo + 1;
+			for (auto k = lo; k <= hi; k++)
+				span_weights[size_t(i) * max_taps + k - lo] = taps[k] / sum;
+			SetMax(ret.taps, span_count[i]);
+		}
+
+		ret.first = span_first;
+		ret.weights.assign(size_t(count) * ret.taps, 0.f);
+		for (auto i = 0; i < count; i++)
+			for (auto k = 0; k < span_count[i]; k++)
+				ret.weights[size_t(i) * ret.taps + k] = span_weights[size_t(i) * max_taps + k];
+		return ret;
+	}
+
+	static AYA_FORCE_INLINE float NonNegative(const float v) {
+		return Max(v, 0.f);
+	}
+	template<int n_samples>
+	static AYA_FORCE_INLINE CoefficientSpectrum<n_samples> NonNegative(const CoefficientSpectrum<n_samples> &v) {
+		return v.clamp();
+	}
+
+	// Resamples the region [x0, x0 + width) x [y0, y0 + height) of a level from the next finer
+	// one, rows first and columns second. finer(x, y) returns a finer texel, store(x, y, value)
+	// receives a filtered one. Texels past the finer edges repeat the edge
+	template<class Value, class Fetch, class Store>
+	static void FilterRegion(const MipFilter filter, const Vector2i &dims, const Vector2i &finer_dims,
+		const int x0, const int y0, const int width, const int height, const Fetch &finer, const Store &store) {
+		const MipAxisWeights wx = AxisWeights(filter, finer_dims.x, dims.x, x0, width);
+		const MipAxisWeights wy = AxisWeights(filter, finer_dims.y, dims.y, y0, height);
+		const int row0 = wy.first[0];
+		const int rows = wy.first[height - 1] + wy.taps - row0;
+
+		std::vector<Value> filtered_rows(size_t(rows) * width);
+		for (auto r = 0; r < rows; r++) {
+			const int fy = Clamp(row0 + r, 0, finer_dims.y - 1);
+			for (auto x = 0; x < width; x++) {
+				const int first = wx.first[x];
+				const float *weights = &wx.weights[size_t(x) * wx.taps];
+				Value sum = finer(Clamp(first, 0, finer_dims.x - 1), fy) * weights[0];
+				for (auto k = 1; k < wx.taps; k++)
+					sum += finer(Clamp(first + k, 0, finer_dims.x - 1), fy) * weights[k];
+				filtered_rows[size_t(r) * width + x] = sum;
+			}
+		}
+
+		for (auto y = 0; y < height; y++) {
+			const Value *column = &filtered_rows[size_t(wy.first[y] - row0) * width];
+			const float *weights = &wy.weights[size_t(y) * wy.taps];
+			for (auto x = 0; x < width; x++) {
+				Value sum = column[x] * weights[0];
+				for (auto k = 1; k < wy.taps; k++)
+					sum += column[size_t(k) * width + x] * weights[k];
+				// Negative lobes may ring below zero
+				store(x0 + x, y0 + y, filter == MipFilter::Box ? sum : Value(NonNegative(sum)));
+			}
+		}
+	}
+
+	// Whole level in bands of rows filtered in parallel
+	template<class Value, class Fetch, class Store>
+	static void FilterLevel(const MipFilter filter, const Vector2i &dims, const Vector2i &finer_dims,
+		const Fetch &finer, const Store &store) {
+		const int BAND_HEIGHT = 64;
+		const int bands = (dims.y + BAND_HEIGHT - 1) / BAND_HEIGHT;
+		concurrency::parallel_for(0, bands, [&](int band) {
+			const int y0 = band * BAND_HEIGHT;
+			FilterRegion<Value>(filter, dims, finer_dims, 0, y0, dims.x, Min(BAND_HEIGHT, dims.y - y0), finer, store);
+		});
+	}
+
+	template<class T>
+	void Mipmap2D<T>::downsample(const int level, const int x0, const int y0, const int width, const int height, T *texels) const {
+		typedef TexelFormat<T> Format;
+		FilterRegion<Value>(m_mipFilter, m_levelDims[level], m_levelDims[level - 1], x0, y0, width, height,
+			[this, level](const int x, const int y) {
+			return fetch(level - 1, x, y);
+		}, [texels, x0, y0, width](const int x, const int y, const Value &v) {
+			new (&texels[(y - y0) * width + x - x0]) T(Format::encode(v));
+		});
+	}
+
+	template<class T>
+	inline void Mipmap2D<T>::generate(const Vector2i &dims, const T *raw_tex) {
+		typedef TexelFormat<T> Format;
+
+		// Over the memory budget the finest levels are dropped, the whole chain takes at most 4/3 of its base
+		auto chainBytes = [](const Vector2i &size) {
+			return size_t(size.x) * size_t(size.y) * sizeof(T) * 4 / 3;
+		};
+		std::vector<T> reduced;
+		Vector2i base_dims = dims;
+		m_skippedLevels = 0;
+		m_mipFilter = GetMipFilter();
+		while ((base_dims.x > 1 || base_dims.y > 1) && !MemoryTracker::fitsBudget(chainBytes(base_dims))) {
+			const T *src = reduced.empty() ? raw_tex : reduced.data();
+			const Vector2i half_dims = Vector2i(Max(base_dims.x >> 1, 1), Max(base_dims.y >> 1, 1));
+			std::vector<T> half(size_t(half_dims.x) * size_t(half_dims.y));
+			FilterLevel<Value>(m_mipFilter, half_dims, base_dims, [src, base_dims](const int x, const int y) {
+				return Format::decode(src[size_t(y) * base_dims.x + x]);
+			}, [&half, half_dims](const int x, const int y, const Value &v) {
+				half[size_t(y) * half_dims.x + x] = Format::encode(v);
+			});
+			reduced.swap(half);
+			base_dims = half_dims;
+			m_skippedLevels++;
+		}
+		if (m_skippedLevels > 0)
+			printf("Texture %dx%d exceeds the memory budget, base level reduced to %dx%d\n",
+				dims.x, dims.y, base_dims.x, base_dims.y);
+
+		m_lazy = false;
+		initLevels(base_dims);
+
+		const T *base_tex = reduced.empty() ? raw_tex : reduced.data();
+		BulkAllocator &allocator = BulkAllocator::scene();
+		mp_leveled_texels = new LevelArray[m_levels];
+		mp_leveled_texels[0].init(base_dims.y, base_dims.x, allocator, MemoryCategory::Texture);
+		for (auto y = 0; y < base_dims.y; y++)
+			for (auto x = 0; x < base_dims.x; x++)
+				mp_leveled_texels[0](y, x) = base_tex[y * base_dims.x + x];
+
+		for (auto l = 1; l < m_levels; l++) {
+			const Vector2i &level_dims = m_levelDims[l];
+			const LevelArray &finer = mp_leveled_texels[l - 1];
+			LevelArray &level = mp_leveled_texels[l];
+			level.init(level_dims.y, level_dims.x, allocator, MemoryCategory::Texture);
+			FilterLevel<Value>(m_mipFilter, level_dims, m_levelDims[l - 1], [&finer](const int x, const int y) {
+				return Format::decode(finer(y, x));
+			}, [&level](const int x, const int y, const Value &v) {
+				level(y, x) = Format::encode(v);
+			});
+		}
+	}
+
+	template<class T>
+	void Mipmap2D<T>::generateLazy(const Vector2i &dims, const BaseLoader &load_base) {
+		// Resident size is bounded by the cache capacity, the budget reduction is not needed
+		m_skippedLevels = 0;
+		m_mipFilter = GetMipFilter();
+		m_lazy = true;
+		m_cacheId = TextureCache::get().registerTexture();
+		m_loadBase = load_base;
+		initLevels(dims);
+	}
+
+	template<class T>
+	void Mipmap2D<T>::generateMapped(std::unique_ptr<TxFile> file) {
+		m_skippedLevels = 0;
+		m_lazy = false;
+		m_texDims = Vector2i(file->header().width, file->header().height);
+		m_levels = file->header().levels;
+		m_levelDims.resize(m_levels);
+		for (auto l = 0; l < m_levels; l++)
+			m_levelDims[l] = file->levelDims(l);
+		mp_file = std::move(file);
+	}
+
+	template<class T>
+	bool Mipmap2D<T>::convert(const char *source, const float gamma, const int channels, const MipFilter filter,
+		const Vector2i &dims, const T *base) {
+		typedef TexelFormat<T> Format;
+
+		// Same filter as the lazily generated levels, only held in memory while converting
+		const std::vector<Vector2i> level_dims = levelDims(dims);
+		std::vector<std::vector<T>> levels(level_dims.size());
+		std::vector<const void*> level_data(level_dims.size());
+		level_data[0] = base;
+		for (size_t l = 1; l < level_dims.size(); l++) {
+			const Vector2i &level = level_dims[l];
+			const Vector2i &finer = level_dims[l - 1];
+			const T *finer_texels = (const T*)level_data[l - 1];
+			levels[l].resize(size_t(level.x) * size_t(level.y));
+			T *texels = levels[l].data();
+			FilterLevel<Value>(filter, level, finer, [finer_texels, &finer](const int x, const int y) {
+				return Format::decode(finer_texels[size_t(y) * finer.x + x]);
+			}, [texels, &level](const int x, const int y, const Value &v) {
+				texels[size_t(y) * level.x + x] = Format::encode(v);
+			});
+			level_data[l] = texels;
 		}
+
+		return TxFile::write(source, Format::name(), sizeof(T), gamma, channels, uint32_t(filter), level_dims, level_data);
+	}
+
+	template<class T>
+	size_t Mipmap2D<T>::tileBytes(const int level, const int tile_x, const int tile_y) const {
+		const Vector2i &dims = m_levelDims[level];
+		const int width = Min(TextureCache::TILE_SIZE, dims.x - (tile_x << TextureCache::TILE_LOG2));
+		const int height = Min(TextureCache::TILE_SIZE, dims.y - (tile_y << TextureCache::TILE_LOG2));
+		return size_t(width) * size_t(height) * sizeof(T);
+	}
+
+	template<class T>
+	void Mipmap2D<T>::loadTile(const int level, const int tile_x, const int tile_y, void *texels) const {
+		typedef TexelFormat<T> Format;
+		const Vector2i &dims = m_levelDims[level];
+		const int min_x = tile_x << TextureCache::TILE_LOG2, min_y = tile_y << TextureCache::TILE_LOG2;
+		const int width = Min(TextureCache::TILE_SIZE, dims.x - min_x);
+		const int height = Min(TextureCache::TILE_SIZE, dims.y - min_y);
+		T *dst = (T*)texels;
+
+		if (level > 0) {
+			downsample(level, min_x, min_y, width, height, dst);
+			return;
+		}
+
+		// The image is decoded once and cut into all of its base tiles,
+		// a thread waiting here finds its tile resident afterwards
+		std::lock_guard<std::mutex> lck(m_baseLock);
+		TextureCache &cache = TextureCache::get();
+		if (cache.copyResident(m_cacheId, 0, tile_x, tile_y, texels, tileBytes(0, tile_x, tile_y)))
+			return;
+
+		T *base = m_loadBase();
+		std::vector<T> tile;
+		const int tiles_x = (dims.x + TextureCache::TILE_SIZE - 1) >> TextureCache::TILE_LOG2;
+		const int tiles_y = (dims.y + TextureCache::TILE_SIZE - 1) >> TextureCache::TILE_LOG2;
+		for (auto ty = 0; ty < tiles_y; ty++)
+			for (auto tx = 0; tx < tiles_x; tx++) {
+				const int x0 = tx << TextureCache::TILE_LOG2, y0 = ty << TextureCache::TILE_LOG2;
+				const int w = Min(TextureCache::TILE_SIZE, dims.x - x0);
+				const int h = Min(TextureCache::TILE_SIZE, dims.y - y0);
+				tile.resize(size_t(w) * size_t(h));
+				for (auto y = 0; y < h; y++)
+					for (auto x = 0; x < w; x++)
+						tile[y * w + x] = base ? base[size_t(y0 + y) * dims.x + x0 + x] : T();
+
+				if (tx == tile_x && ty == tile_y)
+					memcpy(texels, tile.data(), tile.size() * sizeof(T));
+				else
+					cache.insert(m_cacheId, 0, tx, ty, tile.data(), tile.size() * sizeof(T));
+			}
+
+		SafeDeleteArray(base);
 	}
 
 	inline float fast_log2(float val) {
@@ -60,23 +359,24 @@ namespace Aya {
 	}
 
 	template<class T>
-	T Mipmap2D<T>::linearSample(const Vector2f &coord, const Vector2f diffs[2]) const {
+	typename Mipmap2D<T>::Value Mipmap2D<T>::linearSample(const Vector2f &coord, const Vector2f diffs[2]) const {
 		float filter_width = Max(diffs[0].length(), diffs[1].length());
 		float lod = m_levels - 1 + fast_log2(Max(filter_width, 1e-8f));
 		if (lod < 0)
 			return levelLinearSample(coord, 0);
-		else
-			return nearestSample(coord);
+
+		// Bilinear on the nearest level, wide footprints read small coarse levels
+		return levelLinearSample(coord, Min(RoundToInt(lod), m_levels - 1));
 	}
 
 	template<class T>
-	T Mipmap2D<T>::triLinearSample(const Vector2f &coord, const Vector2f diffs[2]) const {
+	typename Mipmap2D<T>::Value Mipmap2D<T>::triLinearSample(const Vector2f &coord, const Vector2f diffs[2]) const {
 		float filter_width = Max(diffs[0].length(), diffs[1].length());
 		float lod = m_levels - 1 + fast_log2(Max(filter_width, 1e-8f));
 		if (lod < 0)
 			return levelLinearSample(coord, 0);
 		if (lod >= m_levels - 1)
-			return mp_leveled_texels[m_levels - 1](0, 0);
+			return fetch(m_levels - 1, 0, 0);
 
 		uint32_t lod_base = FloorToInt(lod);
 		float lin = lod - lod_base;
@@ -93,25 +393,26 @@ namespace Aya {
 	}
 
 	template<class T>
-	T Mipmap2D<T>::levelLinearSample(const Vector2f &coord, const int level) const
+	typename Mipmap2D<T>::Value Mipmap2D<T>::levelLinearSample(const Vector2f &coord, const int level) const
 	{
-		const BlockedArray<T> &texel = mp_leveled_texels[level];
-		
-		float coord_x = Clamp(coord.x * texel.v(), 0, texel.v() - 1.f);
-		float coord_y = Clamp(coord.y * texel.u(), 0, texel.u() - 1.f);
+		const Vector2i &dims = m_levelDims[level];
+
+		float coord_x = Clamp(coord.x * dims.x, 0, dims.x - 1.f);
+		float coord_y = Clamp(coord.y * dims.y, 0, dims.y - 1.f);
 		int idx0_x = Max(FloorToInt(coord_x), 0);
 		int idx0_y = Max(FloorToInt(coord_y), 0);
-		int idx1_x = Min(idx0_x + 1, texel.v() - 1);
-		int idx1_y = Min(idx0_y + 1, texel.u() - 1);
+		int idx1_x = Min(idx0_x + 1, dims.x - 1);
+		int idx1_y = Min(idx0_y + 1, dims.y - 1);
 
 		if (coord_x == idx0_x && coord_y == idx0_y) {
-			return texel(idx0_y, idx0_x);
+			return fetch(level, idx0_x, idx0_y);
 		}
 
-		const T &v1 = texel(idx0_y, idx0_x);
-		const T &v2 = texel(idx1_y, idx0_x);
-		const T &v3 = texel(idx0_y, idx1_x);
-		const T &v4 = texel(idx1_y, idx1_x);
+		// Copies, a cache lookup may unpin the tile of a previous fetch
+		const Value v1 = fetch(level, idx0_x, idx0_y);
+		const Value v2 = fetch(level, idx0_x, idx1_y);
+		const Value v3 = fetch(level, idx1_x, idx0_y);
+		const Value v4 = fetch(level, idx1_x, idx1_y);
 		return Lerp(
 			coord_x - idx0_x,
 			Lerp(coord_y - idx0_y, v1, v2),
@@ -119,34 +420,182 @@ namespace Aya {
 		);
 	}
 
+	// Gaussian falloff over the squared radius of the unit ellipse, zero at its edge
+	static const int EWA_LUT_SIZE = 128;
+	struct EWAWeightTable {
+		float weights[EWA_LUT_SIZE];
+
+		EWAWeightTable() {
+			const float alpha = 2.f;
+			for (auto i = 0; i < EWA_LUT_SIZE; i++) {
+				const float r2 = float(i) / float(EWA_LUT_SIZE - 1);
+				weights[i] = std::exp(-alpha * r2) - std::exp(-alpha);
+			}
+		}
+	};
+	static const EWAWeightTable EWAWeights;
+
+	static AYA_FORCE_INLINE int WrapTexel(int i, const int res) {
+		i %= res;
+		return i < 0 ? i + res : i;
+	}
+
 	template<class T>
-	T Mipmap2D<T>::nearestSample(const Vector2f &coord) const
+	typename Mipmap2D<T>::Value Mipmap2D<T>::ewaSample(const Vector2f &coord, const Vector2f diffs[2], const int max_aniso) const {
+		Vector2f axis0 = diffs[0], axis1 = diffs[1];
+		const Vector2i &dims = m_levelDims[0];
+		Vector2f texel0(axis0.x * dims.x, axis0.y * dims.y), texel1(axis1.x * dims.x, axis1.y * dims.y);
+		float length0 = texel0.length(), length1 = texel1.length();
+		if (length0 < length1) {
+			std::swap(axis0, axis1);
+			std::swap(texel0, texel1);
+			std::swap(length0, length1);
+		}
+
+		// Too eccentric footprints are widened, a coarser level is filtered instead
+		if (length1 * max_aniso < length0 && length1 > 0.f) {
+			const float scale = length0 / (length1 * max_aniso);
+			axis1 *= scale;
+			length1 *= scale;
+		}
+		if (length1 == 0.f)
+			return levelLinearSample(coord, 0);
+
+		// The minor axis spans a texel on the finer level, less where the most eccentric ellipse
+		// would exceed EWA_TEXEL_BUDGET there. Grown by a texel, axes a and b at right angles
+		// cover pi * sqrt(a^2 b^2 + a^2 + b^2 + 1) texels
+		const float aniso2 = float(max_aniso * max_aniso);
+		const float budget = EWA_TEXEL_BUDGET / float(M_PI);
+		const float minor2 = Min((Sqrt((aniso2 + 1.f) * (aniso2 + 1.f) + 4.f * aniso2 * (budget * budget - 1.f)) - aniso2 - 1.f) / (2.f * aniso2), 1.f);
+		const float lod = Max(fast_log2(length1) - .5f * fast_log2(minor2), 0.f);
+
+		const int level = FloorToInt(lod);
+		if (level >= m_levels - 1)
+			return fetch(m_levels - 1, 0, 0);
+
+		const float lin = lod - level;
+		if (lin < .2f)
+			return ewaLevel(level, coord, axis0, axis1);
+		if (lin > .8f)
+			return ewaLevel(level + 1, coord, axis0, axis1);
+
+		return Lerp(lin, ewaLevel(level, coord, axis0, axis1), ewaLevel(level + 1, coord, axis0, axis1));
+	}
+
+	template<class T>
+	typename Mipmap2D<T>::Value Mipmap2D<T>::ewaLevel(const int level, const Vector2f &coord, const Vector2f &axis0, const Vector2f &axis1) const {
+		const Vector2i &dims = m_levelDims[level];
+		const float s = coord.x * dims.x - .5f;
+		const float t = coord.y * dims.y - .5f;
+		const float du0 = axis0.x * dims.x, dv0 = axis0.y * dims.y;
+		const float du1 = axis1.x * dims.x, dv1 = axis1.y * dims.y;
+
+		// Implicit ellipse A ds^2 + B ds dt + C dt^2 < 1, grown by a texel for reconstruction
+		float A = dv0 * dv0 + dv1 * dv1 + 1.f;
+		float B = -2.f * (du0 * dv0 + du1 * dv1);
+		float C = du0 * du0 + du1 * du1 + 1.f;
+		const float inv_F = 1.f / (A * C - .25f * B * B);
+		A *= inv_F;
+		B *= inv_F;
+		C *= inv_F;
+
+		// Rows are only walked over their span inside the ellipse
+		const float det = 4.f * A * C - B * B;
+		const float t_extent = 2.f * Sqrt(A / det);
+		const int t0 = CeilToInt(t - t_extent), t1 = FloorToInt(t + t_extent);
+		const float inv_2A = .5f / A;
+
+		Value sum = Value(0.f);
+		float weight_sum = 0.f;
+		for (auto y = t0; y <= t1; y++) {
+			const float dt = y - t;
+			const float disc = B * B * dt * dt - 4.f * A * (C * dt * dt - 1.f);
+			if (disc <= 0.f)
+				continue;
+
+			const float root = Sqrt(disc);
+			const int s0 = CeilToInt(s - (B * dt + root) * inv_2A);
+			const int s1 = FloorToInt(s - (B * dt - root) * inv_2A);
+			const int row = (y < 0 || y >= dims.y) ? WrapTexel(y, dims.y) : y;
+			const bool wrap = s0 < 0 || s1 >= dims.x;
+
+			// Radius stepped along the row, the ends round to the edge of the table
+			float ds = s0 - s;
+			float r2 = (A * ds + B * dt) * ds + C * dt * dt;
+			float dr2 = A * (2.f * ds + 1.f) + B * dt;
+			for (auto x = s0; x <= s1; x++) {
+				const float weight = EWAWeights.weights[Clamp(int(r2 * EWA_LUT_SIZE), 0, EWA_LUT_SIZE - 1)];
+				sum += fetch(level, wrap ? WrapTexel(x, dims.x) : x, row) * weight;
+				weight_sum += weight;
+				r2 += dr2;
+				dr2 += 2.f * A;
+			}
+		}
+
+		return weight_sum > 0.f ? sum * (1.f / weight_sum) : levelLinearSample(coord, level);
+	}
+
+	template<class T>
+	typename Mipmap2D<T>::Value Mipmap2D<T>::nearestSample(const Vector2f &coord) const
 	{
-		const BlockedArray<T> &texel = mp_leveled_texels[0];
-		int coord_x = Clamp(int(coord.x * texel.v()), 0, texel.v() - 1);
-		int coord_y = Clamp(int(coord.y * texel.u()), 0, texel.u() - 1);
-		return texel(coord_y, coord_x);
+		const Vector2i &dims = m_levelDims[0];
+		int coord_x = Clamp(int(coord.x * dims.x), 0, dims.x - 1);
+		int coord_y = Clamp(int(coord.y * dims.y), 0, dims.y - 1);
+		return fetch(0, coord_x, coord_y);
 	}
 
 	template<class TRet, class TMem>
 	ImageTexture2D<TRet, TMem>::ImageTexture2D(const char *file_name, const float gamma) {
-		int channel;
-		TMem *pixels = Bitmap::read<TMem>(file_name, &m_width, &m_height, &channel);
-		std::exception("Texture file load failed.");
+		// Converted once, later runs map the pre-filtered levels and decode nothing
+		const char *texel = TexelFormat<TMem>::name();
+		const MipFilter filter = GetMipFilter();
+		std::unique_ptr<TxFile> file = TxFile::open(file_name, texel, sizeof(TMem), gamma, uint32_t(filter));
+		if (!file && TxFile::isEnabled()) {
+			int width, height, channel;
+			TMem *pixels = readPixels(file_name, gamma, &width, &height, &channel);
+			if (pixels && Mipmap2D<TMem>::convert(file_name, gamma, channel, filter, Vector2i(width, height), pixels))
+				file = TxFile::open(file_name, texel, sizeof(TMem), gamma, uint32_t(filter));
+			SafeDeleteArray(pixels);
+		}
+		if (file) {
+			m_width = file->header().width;
+			m_height = file->header().height;
+			m_hasAlpha = (file->header().channels == 4);
+			m_widthInv = 1.f / float(m_width);
+			m_heightInv = 1.f / float(m_height);
+			m_texels.generateMapped(std::move(file));
+			return;
+		}
 
-		if (gamma != 1.f) {
-			for (int i = 0; i < m_width * m_height; i++) {
-				pixels[i] = gammaCorrect(pixels[i], gamma);
-			}
+		int channel;
+		if (!Bitmap::info(file_name, &m_width, &m_height, &channel)) {
+			printf("Texture file load failed: %s\n", file_name);
+			m_width = m_height = 1;
+			channel = 3;
 		}
 
+		// Pixels are decoded when a base tile is first looked up
+		const std::string path = file_name;
+		m_texels.generateLazy(Vector2i(m_width, m_height), [path, gamma]() {
+			int width, height, channel;
+			return readPixels(path.c_str(), gamma, &width, &height, &channel);
+		});
+
 		m_hasAlpha = (channel == 4);
-		m_texels.generate(Vector2i(m_width, m_height), pixels);
 		m_widthInv = 1.f / float(m_width);
 		m_heightInv = 1.f / float(m_height);
-
-		SafeDeleteArray(pixels);
 	}
+	template<class TRet, class TMem>
+	TMem* ImageTexture2D<TRet, TMem>::readPixels(const char *file_name, const float gamma, int *width, int *height, int *channel) {
+		TMem *pixels = Bitmap::read<TMem>(file_name, width, height, channel);
+		if (pixels && gamma != 1.f) {
+			for (int i = 0; i < *width * *height; i++) {
+				pixels[i] = gammaCorrect(pixels[i], gamma);
+			}
+		}
+		return pixels;
+	}
+
 	template<class TRet, class TMem>
 	ImageTexture2D<TRet, TMem>::ImageTexture2D(const TMem *pixels, const int width, const int height) {
 		m_width = width;
@@ -175,6 +624,8 @@ namespace Aya {
 			return anisotropicSample(wrapped_coord, diffs, 8);
 		case TextureFilter::Anisotropic16x:
 			return anisotropicSample(wrapped_coord, diffs, 16);
+		case TextureFilter::EWA:
+			return m_texels.ewaSample(wrapped_coord, diffs, EWA_MAX_ANISOTROPY);
 		}
 
 		return TRet(0);
@@ -198,6 +649,8 @@ namespace Aya {
 			return anisotropicSample(wrapped_coord, diffs, 8);
 		case TextureFilter::Anisotropic16x:
 			return anisotropicSample(wrapped_coord, diffs, 16);
+		case TextureFilter::EWA:
+			return m_texels.ewaSample(wrapped_coord, diffs, EWA_MAX_ANISOTROPY);
 		}
 
 		return TRet(0);
@@ -254,7 +707,7 @@ namespace Aya {
 			length_minor = 1.f;
 		}
 
-		float LOD = fast_log2(length_minor);
+		float LOD = Max(fast_log2(length_minor) - m_texels.getSkippedLevels(), 0.f);
 		float inv_rate = 1.f / (int)ratio_of_anisotropy;
 		float start_u = coord.u * m_width - length_major * aniso_dir.x * .5f;
 		float start_v = coord.v * m_height - length_major * aniso_dir.y * .5f;
@@ -264,7 +717,7 @@ namespace Aya {
 		lod1 = Min(FloorToInt(LOD), m_texels.getLevels() - 1);
 		lod2 = Min(CeilToInt(LOD), m_texels.getLevels() - 1);
 
-		TMem ret;
+		typename Mipmap2D<TMem>::Value ret = typename Mipmap2D<TMem>::Value(0);
 		Vector2f uv;
 		for (int i = 0; i < (int)ratio_of_anisotropy; i++) {
 			uv.u = (start_u + step_u * (i + 0.5f)) * m_widthInv;
@@ -284,10 +737,22 @@ namespace Aya {
 	template class Mipmap2D<Spectrum>;
 	template class Mipmap2D<byteSpectrum>;
 	template class Mipmap2D<float>;
+	template class Mipmap2D<halfSpectrum>;
+	template class Mipmap2D<rgb9e5Spectrum>;
+	template class Mipmap2D<sRGB8Spectrum>;
 	template class ImageTexture2D<RGBSpectrum, byteSpectrum>;
 	template class ImageTexture2D<RGBSpectrum, RGBSpectrum>;
 	template class ImageTexture2D<SampledSpectrum, byteSpectrum>;
 	template class ImageTexture2D<SampledSpectrum, SampledSpectrum>;
 	template class ImageTexture2D<float, float>;
+	template class ImageTexture2D<RGBSpectrum, halfSpectrum>;
+	template class ImageTexture2D<RGBSpectrum, rgb9e5Spectrum>;
+	template class ImageTexture2D<RGBSpectrum, sRGB8Spectrum>;
+	template class ImageTexture2D<SampledSpectrum, sRGB8Spectrum>;
+#if defined(AYA_HERO_SPECTRUM)
+	template class ImageTexture2D<HeroSpectrum, byteSpectrum>;
+	template class ImageTexture2D<HeroSpectrum, RGBSpectrum>;
+	template class ImageTexture2D<HeroSpectrum, sRGB8Spectrum>;
+#endif
 	
 }
\ No newline at end of file
@@ -6,6 +6,12 @@
 #include <Core/Spectrum.h>
 #include <Loaders/Bitmap.h>
 #include <Core/Memory.h>
+#include <Core/TextureCache.h>
+#include <Loaders/TxFile.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
 
 namespace Aya {
 	enum class TextureFilter {
@@ -14,13 +20,27 @@ namespace Aya {
 		TriLinear = 2,
 		Anisotropic4x = 3,
 		Anisotropic8x = 4,
-		Anisotropic16x = 5
+		Anisotropic16x = 5,
+		// Elliptically weighted average with Gaussian weights. A quality option, sharper than
+		// Anisotropic16x on strongly slanted surfaces at about twice its cost per lookup
+		EWA = 6
 	};
 	enum class TextureWrapMode {
 		Clamp,
 		Repeat,
 		Mirror
 	};
+	// Filter coarser mip levels are reduced with, separable over rows and columns.
+	// Box averages the area a coarser texel covers, odd sizes included.
+	// Lanczos and Kaiser are windowed sincs that keep more detail
+	enum class MipFilter {
+		Box = 0,
+		Lanczos = 1,
+		Kaiser = 2
+	};
+	// Process wide, applies to mip chains built afterwards
+	void SetMipFilter(const MipFilter filter);
+	MipFilter GetMipFilter();
 
 	template<class T>
 	class Texture2D {
@@ -50,61 +70,196 @@ namespace Aya {
 		virtual void setValue(const T &value) {}
 	};
 
-	template<class T>
+	// Like ImageTexture2D the stored type may differ from the returned one
+	template<class T, class TMem = T>
 	class ConstantTexture2D : public Texture2D<T> {
 	private:
-		T m_val;
+		TMem m_val;
 
 	public:
-		ConstantTexture2D(const T &val) : m_val(val) {}
+		ConstantTexture2D(const TMem &val) : m_val(val) {}
 		inline T sample(const Vector2f &coord, const Vector2f diffs[2]) const override {
-			return m_val;
+			return T(m_val);
 		}
 		inline T sample(const Vector2f &coord, const Vector2f diffs[2], TextureFilter filter) const override {
-			return m_val;
+			return T(m_val);
 		}
 		bool isConstant() const override {
 			return true;
 		}
 		T getValue() const {
-			return m_val;
+			return T(m_val);
 		}
 		void setValue(const T &value) const {
 			this->m_val = value;
 		}
 	};
 
+	// Type a stored texel is filtered in, full precision texels filter as themselves.
+	// The name tells texture cache files of different storage formats apart
+	template<class T>
+	struct TexelFormat {
+		typedef T Value;
+		static AYA_FORCE_INLINE const T& decode(const T &t) {
+			return t;
+		}
+		static AYA_FORCE_INLINE T encode(const T &v) {
+			return v;
+		}
+		static const char* name();
+	};
+	template<> inline const char* TexelFormat<float>::name() {
+		return "float";
+	}
+	template<> inline const char* TexelFormat<RGBSpectrum>::name() {
+		return "rgb";
+	}
+	template<> inline const char* TexelFormat<SampledSpectrum>::name() {
+		return "sampled";
+	}
+	template<> inline const char* TexelFormat<HeroSpectrum>::name() {
+		return "hero";
+	}
 	template<class T>
-	class Mipmap2D {
+	struct CompactTexelFormat {
+		typedef RGBSpectrum Value;
+		static AYA_FORCE_INLINE RGBSpectrum decode(const T &t) {
+			return t.toRGBSpectrum();
+		}
+		static AYA_FORCE_INLINE T encode(const RGBSpectrum &v) {
+			return T(v);
+		}
+	};
+	// Filtered in float, sums of bytes would wrap around
+	template<> struct TexelFormat<byteSpectrum> {
+		typedef RGBSpectrum Value;
+		static AYA_FORCE_INLINE RGBSpectrum decode(const byteSpectrum &t) {
+			return RGBSpectrum(t);
+		}
+		static AYA_FORCE_INLINE byteSpectrum encode(const RGBSpectrum &v) {
+			return byteSpectrum(
+				Byte(Clamp(v[0] * 255.f + .5f, 0.f, 255.f)),
+				Byte(Clamp(v[1] * 255.f + .5f, 0.f, 255.f)),
+				Byte(Clamp(v[2] * 255.f + .5f, 0.f, 255.f)),
+				Byte(Clamp(v[3] * 255.f + .5f, 0.f, 255.f)));
+		}
+		static const char* name() {
+			return "byte";
+		}
+	};
+	template<> struct TexelFormat<halfSpectrum> : public CompactTexelFormat<halfSpectrum> {
+		static const char* name() {
+			return "half";
+		}
+	};
+	template<> struct TexelFormat<rgb9e5Spectrum> : public CompactTexelFormat<rgb9e5Spectrum> {
+		static const char* name() {
+			return "rgb9e5";
+		}
+	};
+	template<> struct TexelFormat<sRGB8Spectrum> : public CompactTexelFormat<sRGB8Spectrum> {
+		static const char* name() {
+			return "srgb8";
+		}
+	};
+
+	// Levels are built eagerly by generate, by generateLazy as tiles of the texture cache
+	// that are filtered from the next finer level on first access, or mapped pre-filtered
+	// from a texture cache file by generateMapped
+	template<class T>
+	class Mipmap2D : public TextureCache::Source {
+	public:
+		typedef typename TexelFormat<T>::Value Value;
+		// Returns the full resolution texels allocated with new[], or nullptr on failure
+		typedef std::function<T*()> BaseLoader;
+		// Texels an elliptical lookup covers at most on the finer of the two levels it blends,
+		// larger footprints move to coarser levels
+		static const int EWA_TEXEL_BUDGET = 64;
+#if defined(AYA_BLOCKED_TEXELS)
+		// 4x4 blocks, the texels of a bilinear footprint mostly share a block
+		typedef BlockedArray<T, 2> LevelArray;
+#else
+		typedef BlockedArray<T> LevelArray;
+#endif
+
 	private:
 		Vector2i m_texDims;
 		int m_levels;
+		int m_skippedLevels;
+		std::vector<Vector2i> m_levelDims;
+		MipFilter m_mipFilter;
+
+		bool m_lazy;
+		uint32_t m_cacheId;
+		BaseLoader m_loadBase;
+		mutable std::mutex m_baseLock;
+
+		std::unique_ptr<TxFile> mp_file;
 
 	public:
-		BlockedArray<T>* mp_leveled_texels;
-		Mipmap2D() {}
+		LevelArray* mp_leveled_texels;
+		Mipmap2D() : m_skippedLevels(0), m_mipFilter(MipFilter::Box), m_lazy(false), m_cacheId(0), mp_leveled_texels(nullptr) {}
 		~Mipmap2D() {
 			SafeDeleteArray(mp_leveled_texels);
+			if (m_lazy)
+				TextureCache::get().releaseTexture(m_cacheId);
 		}
 
 		void generate(const Vector2i &dims, const T* raw_tex);
+		void generateLazy(const Vector2i &dims, const BaseLoader &load_base);
+		void generateMapped(std::unique_ptr<TxFile> file);
+		// Filters the whole chain and writes it as the texture cache file of a source image
+		static bool convert(const char *source, const float gamma, const int channels, const MipFilter filter,
+			const Vector2i &dims, const T *base);
+
+		Value linearSample(const Vector2f& coord, const Vector2f diffs[2]) const;
+		Value triLinearSample(const Vector2f& coord, const Vector2f diffs[2]) const;
+		Value levelLinearSample(const Vector2f& coord, const int level) const;
+		Value nearestSample(const Vector2f& coord) const;
+		// Elliptically weighted average over the footprint the differentials span,
+		// at most max_aniso times longer than wide
+		Value ewaSample(const Vector2f& coord, const Vector2f diffs[2], const int max_aniso) const;
 
-		T linearSample(const Vector2f& coord, const Vector2f diffs[2]) const;
-		T triLinearSample(const Vector2f& coord, const Vector2f diffs[2]) const;
-		T levelLinearSample(const Vector2f& coord, const int level) const;
-		T nearestSample(const Vector2f& coord) const;
+		AYA_FORCE_INLINE Value fetch(const int level, const int x, const int y) const {
+			if (mp_leveled_texels)
+				return TexelFormat<T>::decode(mp_leveled_texels[level](y, x));
 
+			const int tile_x = x >> TextureCache::TILE_LOG2, tile_y = y >> TextureCache::TILE_LOG2;
+			const T *texels = mp_file ? (const T*)mp_file->tile(level, tile_x, tile_y)
+				: (const T*)TextureCache::get().lookup(this, m_cacheId, level, tile_x, tile_y);
+			const int tile_width = Min(TextureCache::TILE_SIZE, m_levelDims[level].x - (tile_x << TextureCache::TILE_LOG2));
+			return TexelFormat<T>::decode(texels[(y & (TextureCache::TILE_SIZE - 1)) * tile_width + (x & (TextureCache::TILE_SIZE - 1))]);
+		}
+
+		// Only resident for eagerly generated levels, blocked order with AYA_BLOCKED_TEXELS
 		const T* getLevelData(const int level = 0) const {
 			assert(level < m_levels);
-			return mp_leveled_texels[level].data();
+			return mp_leveled_texels ? mp_leveled_texels[level].data() : nullptr;
 		}
 		const int getLevels() const {
 			return m_levels;
 		}
+		// Finest levels dropped to stay within the memory budget
+		const int getSkippedLevels() const {
+			return m_skippedLevels;
+		}
+
+		size_t tileBytes(const int level, const int tile_x, const int tile_y) const override;
+		void loadTile(const int level, const int tile_x, const int tile_y, void *texels) const override;
+
+	private:
+		void initLevels(const Vector2i &dims);
+		static std::vector<Vector2i> levelDims(const Vector2i &dims);
+		Value ewaLevel(const int level, const Vector2f& coord, const Vector2f& axis0, const Vector2f& axis1) const;
+		// Filters a region of a level from the next finer one
+		void downsample(const int level, const int x0, const int y0, const int width, const int height, T *texels) const;
 	};
 
 	template<class TRet, class TMem>
 	class ImageTexture2D : public Texture2D<TRet> {
+	public:
+		static const int EWA_MAX_ANISOTROPY = 16;
+
 	private:
 		int m_width;
 		int m_height;
@@ -118,6 +273,9 @@ namespace Aya {
 		ImageTexture2D(const TMem* pixels, const int width, const int height);
 		~ImageTexture2D() {}
 
+		// Gamma corrected pixels allocated with new[], nullptr on failure
+		static TMem* readPixels(const char *file_name, const float gamma, int *width, int *height, int *channel);
+
 		TRet sample(const Vector2f &coord, const Vector2f diffs[2]) const override;
 		TRet sample(const Vector2f &coord, const Vector2f diffs[2], TextureFilter filter) const override;
 		TRet anisotropicSample(const Vector2f &coord, const Vector2f diffs[2], const int max_rate) const;
@@ -151,7 +309,14 @@ namespace Aya {
 			return (byteSpectrum)RGBSpectrum(s).pow(gamma);
 		}
 		static float gammaCorrect(float s, const float gamma) {
-			return std::powf(s, gamma);
+			return std::pow(s, gamma);
+		}
+		template<class TCompact>
+		static TCompact gammaCorrect(const TCompact &s, const float gamma) {
+			const RGBSpectrum rgb = s.toRGBSpectrum();
+			RGBSpectrum ret = rgb.pow(gamma);
+			ret[3] = rgb[3];
+			return TCompact(ret);
 		}
 
 		static float alpha(const RGBSpectrum &s) {
@@ -160,6 +325,9 @@ namespace Aya {
 		static float alpha(const SampledSpectrum &s) {
 			return -1;
 		}
+		static float alpha(const HeroSpectrum &s) {
+			return -1;
+		}
 		static float alpha(const byteSpectrum &s) {
 			return s.a;
 		}
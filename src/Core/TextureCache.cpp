@@ -0,0 +1,229 @@
+#include <Core/TextureCache.h>
+
+#include <cstring>
+
+namespace Aya {
+	const int TextureCache::TILE_LOG2;
+	const int TextureCache::TILE_SIZE;
+
+	TextureCache::MicroCache::MicroCache() {
+		for (int i = 0; i < MICRO_CACHE_SIZE; i++) {
+			keys[i] = INVALID_KEY;
+			tiles[i] = nullptr;
+		}
+	}
+	TextureCache::MicroCache::~MicroCache() {
+		// Threads exiting release their pins
+		TextureCache &cache = TextureCache::get();
+		for (int i = 0; i < MICRO_CACHE_SIZE; i++) {
+			if (tiles[i])
+				cache.unpin(tiles[i]);
+		}
+	}
+
+	TextureCache::TextureCache()
+		: m_capacity(size_t(1024) * 1024 * 1024)
+		, m_bytes(0)
+		, m_peakBytes(0)
+		, m_nextTexture(0)
+		, m_lookups(0)
+		, m_loads(0)
+		, m_evictions(0) {
+		for (auto &shard : m_shards)
+			shard.lru.prev = shard.lru.next = &shard.lru;
+	}
+	TextureCache::~TextureCache() {
+		for (auto &shard : m_shards) {
+			for (auto &it : shard.tiles)
+				freeTile(it.second);
+			shard.tiles.clear();
+		}
+	}
+
+	uint32_t TextureCache::registerTexture() {
+		const uint32_t texture = m_nextTexture++;
+		assert(texture < (1u << 24));
+		return texture;
+	}
+
+	void TextureCache::releaseTexture(const uint32_t texture) {
+		for (auto &shard : m_shards) {
+			std::lock_guard<std::mutex> lck(shard.mt);
+			for (auto it = shard.tiles.begin(); it != shard.tiles.end();) {
+				Tile *tile = it->second;
+				if ((tile->key >> 40) != texture) {
+					++it;
+					continue;
+				}
+
+				tile->prev->next = tile->next;
+				tile->next->prev = tile->prev;
+				it = shard.tiles.erase(it);
+				if (tile->pins > 0)
+					tile->detached = true;
+				else
+					freeTile(tile);
+			}
+		}
+	}
+
+	const void* TextureCache::lookupSlow(const Source *source, const uint64_t key,
+		const int level, const int tile_x, const int tile_y, MicroCache &micro, const uint32_t slot) {
+		m_lookups.fetch_add(1, std::memory_order_relaxed);
+
+		Tile *tile = nullptr;
+		{
+			Shard &shard = shardOf(key);
+			std::lock_guard<std::mutex> lck(shard.mt);
+			auto it = shard.tiles.find(key);
+			if (it != shard.tiles.end()) {
+				tile = it->second;
+				tile->pins++;
+
+				tile->prev->next = tile->next;
+				tile->next->prev = tile->prev;
+				tile->next = shard.lru.next;
+				tile->prev = &shard.lru;
+				shard.lru.next->prev = tile;
+				shard.lru.next = tile;
+			}
+		}
+
+		if (!tile) {
+			// Produced without holding a lock, coarser levels look up finer tiles recursively
+			const size_t bytes = source->tileBytes(level, tile_x, tile_y);
+			uint8_t *texels = AllocAligned<uint8_t>(bytes);
+			source->loadTile(level, tile_x, tile_y, texels);
+			m_loads.fetch_add(1, std::memory_order_relaxed);
+
+			tile = insertTile(key, texels, bytes, true);
+			evict();
+		}
+
+		// The slot may have been refilled by the recursive lookups above
+		if (micro.tiles[slot])
+			unpin(micro.tiles[slot]);
+		micro.keys[slot] = key;
+		micro.tiles[slot] = tile;
+
+		return tile->texels;
+	}
+
+	void TextureCache::insert(const uint32_t texture, const int level, const int tile_x, const int tile_y,
+		const void *texels, const size_t bytes) {
+		const uint64_t key = tileKey(texture, level, tile_x, tile_y);
+		{
+			Shard &shard = shardOf(key);
+			std::lock_guard<std::mutex> lck(shard.mt);
+			if (shard.tiles.find(key) != shard.tiles.end())
+				return;
+		}
+
+		uint8_t *copy = AllocAligned<uint8_t>(bytes);
+		memcpy(copy, texels, bytes);
+		insertTile(key, copy, bytes, false);
+		evict();
+	}
+
+	bool TextureCache::copyResident(const uint32_t texture, const int level, const int tile_x, const int tile_y,
+		void *texels, const size_t bytes) {
+		const uint64_t key = tileKey(texture, level, tile_x, tile_y);
+		Shard &shard = shardOf(key);
+		std::lock_guard<std::mutex> lck(shard.mt);
+		auto it = shard.tiles.find(key);
+		if (it == shard.tiles.end())
+			return false;
+
+		assert(it->second->bytes == bytes);
+		memcpy(texels, it->second->texels, bytes);
+		return true;
+	}
+
+	TextureCache::Tile* TextureCache::insertTile(const uint64_t key, uint8_t *texels, const size_t bytes, const bool pin) {
+		Shard &shard = shardOf(key);
+		std::lock_guard<std::mutex> lck(shard.mt);
+
+		Tile *&tile = shard.tiles[key];
+		if (tile) {
+			// Another thread produced it first
+			FreeAligned(texels);
+		}
+		else {
+			tile = new Tile;
+			tile->key = key;
+			tile->texels = texels;
+			tile->bytes = bytes;
+			tile->pins = 0;
+			tile->detached = false;
+			tile->next = shard.lru.next;
+			tile->prev = &shard.lru;
+			shard.lru.next->prev = tile;
+			shard.lru.next = tile;
+
+			const size_t total = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			size_t peak = m_peakBytes.load(std::memory_order_relaxed);
+			while (total > peak && !m_peakBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed));
+			MemoryTracker::add(MemoryCategory::Texture, int64_t(bytes));
+		}
+
+		if (pin)
+			tile->pins++;
+		return tile;
+	}
+
+	void TextureCache::unpin(Tile *tile) {
+		Shard &shard = shardOf(tile->key);
+		std::lock_guard<std::mutex> lck(shard.mt);
+		assert(tile->pins > 0);
+		if (--tile->pins == 0 && tile->detached)
+			freeTile(tile);
+	}
+
+	void TextureCache::freeTile(Tile *tile) {
+		m_bytes.fetch_sub(tile->bytes, std::memory_order_relaxed);
+		MemoryTracker::add(MemoryCategory::Texture, -int64_t(tile->bytes));
+		FreeAligned(tile->texels);
+		delete tile;
+	}
+
+	void TextureCache::evict() {
+		// Least recently used order is kept per shard, the shards are visited in turn
+		static std::atomic<uint32_t> next_shard(0);
+		const uint32_t first = next_shard.fetch_add(1, std::memory_order_relaxed);
+		for (int i = 0; i < SHARD_COUNT && m_bytes > m_capacity; i++) {
+			Shard &shard = m_shards[(first + i) & (SHARD_COUNT - 1)];
+			std::lock_guard<std::mutex> lck(shard.mt);
+
+			Tile *tile = shard.lru.prev;
+			while (tile != &shard.lru && m_bytes > m_capacity) {
+				Tile *prev = tile->prev;
+				if (tile->pins == 0) {
+					tile->prev->next = tile->next;
+					tile->next->prev = tile->prev;
+					shard.tiles.erase(tile->key);
+					freeTile(tile);
+					m_evictions.fetch_add(1, std::memory_order_relaxed);
+				}
+				tile = prev;
+			}
+		}
+	}
+
+	void TextureCache::setCapacity(const size_t bytes) {
+		m_capacity = bytes;
+		evict();
+	}
+
+	void TextureCache::printStatistics() const {
+		const float MB = 1024.f * 1024.f;
+		printf("Texture cache: %llu lookup(s) past the micro caches, %llu tile(s) loaded, %llu evicted\n",
+			(unsigned long long)m_lookups.load(), (unsigned long long)m_loads.load(), (unsigned long long)m_evictions.load());
+		printf("  %.2f MB resident, %.2f MB peak of %.2f MB capacity\n",
+			m_bytes.load() / MB, m_peakBytes.load() / MB, m_capacity.load() / MB);
+	}
+
+	TextureCache& TextureCache::get() {
+		static TextureCache cache;
+		return cache;
+	}
+}
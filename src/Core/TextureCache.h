@@ -0,0 +1,133 @@
+#ifndef AYA_CORE_TEXTURECACHE_H
+#define AYA_CORE_TEXTURECACHE_H
+
+#include <Core/Config.h>
+#include <Core/Memory.h>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace Aya {
+	// Process wide cache of mip level tiles. A tile is produced by its texture on first
+	// access and evicted least recently used first once the capacity is exceeded.
+	// Every thread keeps a small direct mapped micro cache of pinned tiles,
+	// lookups hitting it take no lock
+	class TextureCache {
+	public:
+		static const int TILE_LOG2 = 6;
+		static const int TILE_SIZE = 1 << TILE_LOG2;
+
+		// Produces the texels of a tile, rows are stored at the width of the tile
+		class Source {
+		public:
+			virtual ~Source() {}
+			virtual size_t tileBytes(const int level, const int tile_x, const int tile_y) const = 0;
+			virtual void loadTile(const int level, const int tile_x, const int tile_y, void *texels) const = 0;
+		};
+
+	private:
+		static const int SHARD_COUNT = 16;
+		static const int MICRO_CACHE_LOG2 = 5;
+		static const int MICRO_CACHE_SIZE = 1 << MICRO_CACHE_LOG2;
+		static const uint64_t INVALID_KEY = ~0ULL;
+
+		struct Tile {
+			uint64_t key;
+			uint8_t *texels;
+			size_t bytes;
+			// Micro cache slots referencing the tile, pinned tiles are never freed
+			int pins;
+			// Texture released while the tile was pinned, freed by the last unpin
+			bool detached;
+			// Shard LRU list, the sentinel's next is the most recently used
+			Tile *prev, *next;
+		};
+		struct Shard {
+			std::mutex mt;
+			std::unordered_map<uint64_t, Tile*> tiles;
+			Tile lru;
+		};
+		struct MicroCache {
+			uint64_t keys[MICRO_CACHE_SIZE];
+			Tile *tiles[MICRO_CACHE_SIZE];
+
+			MicroCache();
+			~MicroCache();
+		};
+
+		Shard m_shards[SHARD_COUNT];
+		std::atomic<size_t> m_capacity;
+		std::atomic<size_t> m_bytes, m_peakBytes;
+		std::atomic<uint32_t> m_nextTexture;
+		std::atomic<uint64_t> m_lookups, m_loads, m_evictions;
+
+	public:
+		TextureCache();
+		~TextureCache();
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache& operator = (const TextureCache&) = delete;
+
+		// Ids are never reused, stale micro cache entries cannot match a later texture
+		uint32_t registerTexture();
+		// Drops every tile of the texture
+		void releaseTexture(const uint32_t texture);
+
+		// Texels of the tile, valid until the calling thread looks up another tile
+		AYA_FORCE_INLINE const void* lookup(const Source *source, const uint32_t texture,
+			const int level, const int tile_x, const int tile_y) {
+			const uint64_t key = tileKey(texture, level, tile_x, tile_y);
+			MicroCache &micro = microCache();
+			const uint32_t slot = microSlot(key);
+			if (micro.keys[slot] == key)
+				return micro.tiles[slot]->texels;
+
+			return lookupSlow(source, key, level, tile_x, tile_y, micro, slot);
+		}
+		// Adds a tile produced ahead of its first access, an already resident one is kept
+		void insert(const uint32_t texture, const int level, const int tile_x, const int tile_y,
+			const void *texels, const size_t bytes);
+		// Copies a resident tile, false if it is not cached
+		bool copyResident(const uint32_t texture, const int level, const int tile_x, const int tile_y,
+			void *texels, const size_t bytes);
+
+		void setCapacity(const size_t bytes);
+		inline size_t getCapacity() const {
+			return m_capacity;
+		}
+		inline size_t getBytes() const {
+			return m_bytes;
+		}
+		void printStatistics() const;
+
+		static TextureCache& get();
+
+	private:
+		static AYA_FORCE_INLINE uint64_t tileKey(const uint32_t texture, const int level, const int tile_x, const int tile_y) {
+			assert(tile_x < (1 << 17) && tile_y < (1 << 17) && level < 64);
+			return (uint64_t(texture) << 40) | (uint64_t(level) << 34) | (uint64_t(tile_y) << 17) | uint64_t(tile_x);
+		}
+		// Fibonacci hashing, neighbouring tiles of a footprint land in different slots
+		static AYA_FORCE_INLINE uint32_t microSlot(const uint64_t key) {
+			return uint32_t((key * 0x9e3779b97f4a7c15ULL) >> (64 - MICRO_CACHE_LOG2));
+		}
+		static AYA_FORCE_INLINE MicroCache& microCache() {
+			static thread_local MicroCache cache;
+			return cache;
+		}
+		AYA_FORCE_INLINE Shard& shardOf(const uint64_t key) {
+			return m_shards[MixBits(key) & (SHARD_COUNT - 1)];
+		}
+
+		const void* lookupSlow(const Source *source, const uint64_t key,
+			const int level, const int tile_x, const int tile_y, MicroCache &micro, const uint32_t slot);
+		// Takes ownership of the texels unless the tile became resident meanwhile
+		Tile* insertTile(const uint64_t key, uint8_t *texels, const size_t bytes, const bool pin);
+		void unpin(Tile *tile);
+		void freeTile(Tile *tile);
+		void evict();
+	};
+}
+
+#endif
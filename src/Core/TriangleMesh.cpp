@@ -1,4 +1,5 @@
 #include <Core/TriangleMesh.h>
+#include <Loaders/MeshFile.h>
 
 namespace Aya {
 	void TriangleMesh::loadMesh(const Transform &O2W, const ObjMesh * obj_mesh) {
@@ -7,15 +8,30 @@ namespace Aya {
 
 		m_verts = obj_mesh->getVertexCount();
 		m_tris = obj_mesh->getTriangleCount();
-		mp_vertices = new MeshVertex[m_verts];
+
+		// Cached meshes are used in place, vertices only when they need no transform
+		mp_file = obj_mesh->getMeshFile();
+		if (mp_file) {
+			mp_vertIdx = obj_mesh->getIndexBuffer();
+			if (O2W.isIdentity()) {
+				mp_vertices = obj_mesh->getVertexBuffer();
+				return;
+			}
+		}
+		else {
+			uint32_t *vert_idx = BulkAllocator::scene().alloc<uint32_t>(3 * m_tris, MemoryCategory::Geometry);
+			std::memcpy(vert_idx, obj_mesh->getIndexAt(0), sizeof(uint32_t) * 3 * m_tris);
+			mp_vertIdx = vert_idx;
+		}
+
+		MeshVertex *vertices = BulkAllocator::scene().alloc<MeshVertex>(m_verts, MemoryCategory::Geometry);
 		for (auto i = (uint32_t)0; i < m_verts; ++i) {
 			const MeshVertex &vertex = obj_mesh->getVertexAt(i);
-			mp_vertices[i].p = (*o2w)(vertex.p);
-			mp_vertices[i].n = (*o2w)(vertex.n);
-			mp_vertices[i].uv = vertex.uv;
+			vertices[i].p = (*o2w)(vertex.p);
+			vertices[i].n = (*o2w)(vertex.n);
+			vertices[i].uv = vertex.uv;
 		}
-		mp_vertIdx = new uint32_t[3 * m_tris];
-		std::memcpy(mp_vertIdx, obj_mesh->getIndexAt(0), sizeof(uint32_t) * 3 * m_tris);
+		mp_vertices = vertices;
 	}
 	void TriangleMesh::loadSphere(const Transform & O2W, const float radius, const uint32_t slices, const uint32_t stacks) {
 		o2w = std::make_unique<Transform>(O2W);
@@ -24,7 +40,7 @@ namespace Aya {
 		const float theta_step = float(M_PI) / float(stacks);
 		const float phi_step = float(M_PI) * 2.f / float(slices);
 
-		mp_vertices = new MeshVertex[(stacks + 1) * (slices + 1)];
+		MeshVertex *vertices = BulkAllocator::scene().alloc<MeshVertex>((stacks + 1) * (slices + 1), MemoryCategory::Geometry);
 
 		float theta = 0.f;
 		for (auto i = (uint32_t)0; i <= stacks; ++i) {
@@ -32,7 +48,7 @@ namespace Aya {
 			for (auto j = (uint32_t)0; j <= slices; ++j) {
 				Vector3 dir = BaseVector3::sphericalDirection(sinf(theta), cosf(theta), phi);
 				Point3 pt = dir * radius;
-				mp_vertices[i * (1 + slices) + j] = MeshVertex(
+				vertices[i * (1 + slices) + j] = MeshVertex(
 					(*o2w)(pt),
 					(*o2w)(dir),
 					phi * float(M_1_PI) * 0.5f, theta * float(M_1_PI)
@@ -42,21 +58,23 @@ namespace Aya {
 			theta += theta_step;
 		}
 
-		mp_vertIdx = new uint32_t[stacks * slices * 6];
+		uint32_t *vert_idx = BulkAllocator::scene().alloc<uint32_t>(stacks * slices * 6, MemoryCategory::Geometry);
 
 		for (auto i = (uint32_t)0; i < stacks; ++i) {
 			for (auto j = (uint32_t)0; j < slices; ++j) {
 				auto idx = (i * slices + j) * 6;
-				mp_vertIdx[idx + 0] = i * (slices + 1) + j;
-				mp_vertIdx[idx + 1] = i * (slices + 1) + j + 1;
-				mp_vertIdx[idx + 2] = (i + 1) * (slices + 1) + j;
+				vert_idx[idx + 0] = i * (slices + 1) + j;
+				vert_idx[idx + 1] = i * (slices + 1) + j + 1;
+				vert_idx[idx + 2] = (i + 1) * (slices + 1) + j;
 
-				mp_vertIdx[idx + 3] = i * (slices + 1) + j + 1;
-				mp_vertIdx[idx + 4] = (i + 1) * (slices + 1) + j + 1;
-				mp_vertIdx[idx + 5] = (i + 1) * (slices + 1) + j;
+				vert_idx[idx + 3] = i * (slices + 1) + j + 1;
+				vert_idx[idx + 4] = (i + 1) * (slices + 1) + j + 1;
+				vert_idx[idx + 5] = (i + 1) * (slices + 1) + j;
 			}
 		}
 
+		mp_vertices = vertices;
+		mp_vertIdx = vert_idx;
 		m_verts = (stacks + 1) * (slices + 1);
 		m_tris = stacks * slices * 2;
 	}
@@ -67,20 +85,22 @@ namespace Aya {
 		const float length_2 = length * .5f;
 		const Normal3 n = (*o2w)(Normal3(0.f, 1.f, 0.f));
 
-		mp_vertices = new MeshVertex[4];
-		mp_vertices[0] = MeshVertex((*o2w)(Point3(-length_2, 0.f, length_2)), n, 0.f, 0.f);
-		mp_vertices[1] = MeshVertex((*o2w)(Point3(-length_2, 0.f, -length_2)), n, 0.f, 1.f);
-		mp_vertices[2] = MeshVertex((*o2w)(Point3(length_2, 0.f, -length_2)), n, 1.f, 1.f);
-		mp_vertices[3] = MeshVertex((*o2w)(Point3(length_2, 0.f, length_2)), n, 1.f, 0.f);
-
-		mp_vertIdx = new uint32_t[6];
-		mp_vertIdx[0] = 0;
-		mp_vertIdx[1] = 2;
-		mp_vertIdx[2] = 1;
-		mp_vertIdx[3] = 2;
-		mp_vertIdx[4] = 0;
-		mp_vertIdx[5] = 3;
-
+		MeshVertex *vertices = BulkAllocator::scene().alloc<MeshVertex>(4, MemoryCategory::Geometry);
+		vertices[0] = MeshVertex((*o2w)(Point3(-length_2, 0.f, length_2)), n, 0.f, 0.f);
+		vertices[1] = MeshVertex((*o2w)(Point3(-length_2, 0.f, -length_2)), n, 0.f, 1.f);
+		vertices[2] = MeshVertex((*o2w)(Point3(length_2, 0.f, -length_2)), n, 1.f, 1.f);
+		vertices[3] = MeshVertex((*o2w)(Point3(length_2, 0.f, length_2)), n, 1.f, 0.f);
+
+		uint32_t *vert_idx = BulkAllocator::scene().alloc<uint32_t>(6, MemoryCategory::Geometry);
+		vert_idx[0] = 0;
+		vert_idx[1] = 2;
+		vert_idx[2] = 1;
+		vert_idx[3] = 2;
+		vert_idx[4] = 0;
+		vert_idx[5] = 3;
+
+		mp_vertices = vertices;
+		mp_vertIdx = vert_idx;
 		m_verts = (uint32_t)4;
 		m_tris = (uint32_t)2;
 	}
@@ -113,6 +133,12 @@ namespace Aya {
 		if (intersection->n == Normal3(0.f, 0.f, 0.f))
 			intersection->n = intersection->gn;
 
+		// Normals interpolated across the triangle bend rays scattered here
+		Normal3 dn1 = n1 - n2;
+		Normal3 dn2 = n3 - n1;
+		const float len1 = e1.length(), len2 = e2.length();
+		intersection->curvature = Max(len1 > 0.f ? dn1.length() / len1 : 0.f, len2 > 0.f ? dn2.length() / len2 : 0.f);
+
 		if (intersection->bsdf->getTexture() || intersection->bsdf->getNormalMap()) {
 			const Vector2f &uv1 = getUVAt(id1);
 			const Vector2f &uv2 = getUVAt(id2);
@@ -124,9 +150,6 @@ namespace Aya {
 			Vector2f d2 = uv3 - uv1;
 			float det = d1.u * d2.v - d2.u * d1.v;
 
-			Normal3 dn1 = n1 - n2;
-			Normal3 dn2 = n3 - n1;
-
 			if (det != 0.f) {
 				float inv_det = 1.f / det;
 				intersection->dpdu = (d2.v * e1 - d1.v * e2) * inv_det;
@@ -7,12 +7,16 @@
 #include <Loaders/ObjMesh.h>
 #include <Core/BSDF.h>
 
+#include <memory>
+
 namespace Aya {
 	class TriangleMesh {
 		std::unique_ptr<Transform> w2o, o2w;
 		uint32_t m_tris, m_verts;
-		uint32_t *mp_vertIdx;
-		MeshVertex *mp_vertices;
+		const uint32_t *mp_vertIdx;
+		const MeshVertex *mp_vertices;
+		// Mesh cache the buffers point into, kept mapped while they are referenced
+		std::shared_ptr<MeshFile> mp_file;
 
 	public:
 		TriangleMesh()
@@ -22,8 +26,11 @@ namespace Aya {
 		~TriangleMesh() {
 			release();
 		}
+		// Vertex data belongs to the scene allocator or a mesh cache, only the references are dropped
 		void release() {
-			SafeDeleteArray(mp_vertices);
+			mp_vertices = nullptr;
+			mp_vertIdx = nullptr;
+			mp_file.reset();
 			m_tris = 0;
 			m_verts = 0;
 		}
@@ -17,6 +17,9 @@ namespace Aya {
 		Film::resize(width, height);
 		m_sampleHistogram.free();
 		m_sampleHistogram.init(width, height);
+
+		m_trackedMemory.set(m_trackedMemory.get() +
+			size_t(width) * size_t(height) * (Histogram::NUM_BINS * sizeof(RGBSpectrum) + sizeof(float)));
 	}
 
 	void FilmRHF::free() {
@@ -36,7 +39,7 @@ namespace Aya {
 		});
 	}
 
-	void FilmRHF::addSample(float x, float y, const Spectrum &sample) {
+	void FilmRHF::addSample(float x, float y, const StoredSpectrum &sample) {
 		x -= .5f;
 		y -= .5f;
 		int min_x = CeilToInt(x - mp_filter->getRadius());
@@ -55,7 +58,7 @@ namespace Aya {
 				Pixel &pixel = m_accumulateBuffer(col, row);
 
 				float weight = mp_filter->evaluate(j - x, i - y);
-				RGBSpectrum weighted_sample = Spectrum(weight * sample).toRGBSpectrum();
+				RGBSpectrum weighted_sample = StoredSpectrum(weight * sample).toRGBSpectrum();
 				
 				weighted_sample[0] = Max(0.f, weighted_sample[0]);
 				weighted_sample[1] = Max(0.f, weighted_sample[1]);
@@ -97,6 +100,9 @@ namespace Aya {
 				m_sampleHistogram.totalWeights(col, row) += 1.f;
 			}
 		}
+
+		std::lock_guard<std::mutex> lck(m_mt);
+		accumulateStatistics(x + .5f, y + .5f, sample);
 	}
 
 	void FilmRHF::denoise() {
@@ -45,7 +45,7 @@ namespace Aya {
 		void free() override;
 		void clear() override;
 
-		void addSample(float x, float y, const Spectrum &L) override;
+		void addSample(float x, float y, const StoredSpectrum &L) override;
 		void denoise() override;
 
 	private:
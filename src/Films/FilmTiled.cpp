@@ -0,0 +1,314 @@
+#include <Films/FilmTiled.h>
+
+namespace Aya {
+	static int SeekFile(FILE *fp, const int64_t offset) {
+#if defined(_WIN32)
+		return _fseeki64(fp, offset, SEEK_SET);
+#else
+		return fseeko(fp, offset, SEEK_SET);
+#endif
+	}
+
+	void FilmTiled::init(int width, int height, Filter *filter) {
+		mp_filter.reset();
+		mp_filter = std::unique_ptr<Filter>(filter);
+
+		// Footprints of samples in a tile reach at most this far out of it,
+		// the band must stay within the direct neighbours
+		m_guardBand = (int)std::ceil(mp_filter->getRadius() + .5f);
+		assert(m_guardBand < m_tileSize);
+		resize(width, height);
+	}
+	void FilmTiled::resize(int width, int height) {
+		free();
+
+		m_width = width;
+		m_height = height;
+		m_sampleCount = 0;
+
+		openOutput();
+	}
+	void FilmTiled::free() {
+		Film::free();
+
+		{
+			std::lock_guard<std::mutex> lck(m_mt);
+			for (auto &tile : m_residentTiles)
+				MemoryTracker::add(MemoryCategory::Film, -int64_t(tileBytes(*tile)));
+			m_residentTiles.clear();
+		}
+		{
+			std::lock_guard<std::mutex> lck(m_splatLock);
+			m_splatBlocks.clear();
+		}
+		{
+			std::lock_guard<std::mutex> lck(m_fileLock);
+			if (mp_file) {
+				fclose(mp_file);
+				mp_file = nullptr;
+			}
+			closeAccumulation();
+		}
+	}
+	void FilmTiled::closeAccumulation() {
+		if (mp_accumFile) {
+			fclose(mp_accumFile);
+			mp_accumFile = nullptr;
+			remove(m_accumPath.c_str());
+		}
+	}
+	void FilmTiled::clear() {
+		// Tiles already streamed out cannot be cleared, start a new output instead
+		resize(m_width, m_height);
+	}
+
+	bool FilmTiled::openOutput() {
+		std::lock_guard<std::mutex> lck(m_fileLock);
+
+		mp_file = fopen(m_path.c_str(), "wb+");
+		if (!mp_file) {
+			printf("Cannot open tiled film output: %s\n", m_path.c_str());
+			return false;
+		}
+
+		// Little endian PFM, rows are stored bottom to top which matches raster y
+		char header[64];
+		int header_len = snprintf(header, sizeof(header), "PF\n%d %d\n-1.0\n", m_width, m_height);
+		fwrite(header, 1, header_len, mp_file);
+		m_dataOffset = header_len;
+
+		// Reserve the whole image so tiles can be written in any order,
+		// pixels of tiles that never finish stay black
+		const int64_t file_size = m_dataOffset + int64_t(m_width) * int64_t(m_height) * 3 * sizeof(float);
+		const char zero = 0;
+		if (SeekFile(mp_file, file_size - 1) != 0 || fwrite(&zero, 1, 1, mp_file) != 1) {
+			printf("Cannot reserve tiled film output: %s\n", m_path.c_str());
+			fclose(mp_file);
+			mp_file = nullptr;
+			return false;
+		}
+
+		// Zero accumulators for every pixel, the file stays sparse where nothing is written
+		mp_accumFile = fopen(m_accumPath.c_str(), "wb+");
+		const int64_t accum_size = int64_t(m_width) * int64_t(m_height) * sizeof(Pixel);
+		if (!mp_accumFile || SeekFile(mp_accumFile, accum_size - 1) != 0 || fwrite(&zero, 1, 1, mp_accumFile) != 1) {
+			printf("Cannot create tiled film accumulation file: %s\n", m_accumPath.c_str());
+			closeAccumulation();
+			fclose(mp_file);
+			mp_file = nullptr;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool FilmTiled::writeRow(const int x, const int y, const int count, const float *rgb) {
+		if (!mp_file)
+			return false;
+
+		const int64_t offset = m_dataOffset + (int64_t(y) * m_width + x) * 3 * sizeof(float);
+		return SeekFile(mp_file, offset) == 0 &&
+			fwrite(rgb, sizeof(float), 3 * count, mp_file) == size_t(3 * count);
+	}
+	bool FilmTiled::readRow(const int x, const int y, const int count, float *rgb) {
+		if (!mp_file)
+			return false;
+
+		const int64_t offset = m_dataOffset + (int64_t(y) * m_width + x) * 3 * sizeof(float);
+		return SeekFile(mp_file, offset) == 0 &&
+			fread(rgb, sizeof(float), 3 * count, mp_file) == size_t(3 * count);
+	}
+
+	bool FilmTiled::writePixels(const int x, const int y, const int count, const Pixel *pixels) {
+		if (!mp_accumFile)
+			return false;
+
+		const int64_t offset = (int64_t(y) * m_width + x) * sizeof(Pixel);
+		return SeekFile(mp_accumFile, offset) == 0 &&
+			fwrite(pixels, sizeof(Pixel), count, mp_accumFile) == size_t(count);
+	}
+	bool FilmTiled::readPixels(const int x, const int y, const int count, Pixel *pixels) {
+		if (!mp_accumFile)
+			return false;
+
+		const int64_t offset = (int64_t(y) * m_width + x) * sizeof(Pixel);
+		return SeekFile(mp_accumFile, offset) == 0 &&
+			fread(pixels, sizeof(Pixel), count, mp_accumFile) == size_t(count);
+	}
+
+	void FilmTiled::beginTile(const int min_x, const int min_y, const int max_x, const int max_y) {
+		std::unique_ptr<Tile> tile = std::make_unique<Tile>();
+		tile->min_x = min_x;
+		tile->min_y = min_y;
+		tile->max_x = max_x;
+		tile->max_y = max_y;
+		tile->band_min_x = Max(min_x - m_guardBand, 0);
+		tile->band_min_y = Max(min_y - m_guardBand, 0);
+		tile->band_max_x = Min(max_x + m_guardBand, m_width);
+		tile->band_max_y = Min(max_y + m_guardBand, m_height);
+		tile->pixels.init(tile->band_max_x - tile->band_min_x, tile->band_max_y - tile->band_min_y);
+		MemoryTracker::add(MemoryCategory::Film, int64_t(tileBytes(*tile)));
+
+		std::lock_guard<std::mutex> lck(m_mt);
+		m_residentTiles.emplace_back(std::move(tile));
+		m_peakResidentTiles = Max(m_peakResidentTiles, int(m_residentTiles.size()));
+	}
+
+	void FilmTiled::endTile(const int min_x, const int min_y, const int max_x, const int max_y) {
+		std::unique_ptr<Tile> tile;
+		{
+			std::lock_guard<std::mutex> lck(m_mt);
+			for (size_t i = 0; i < m_residentTiles.size(); i++) {
+				if (m_residentTiles[i]->min_x == min_x && m_residentTiles[i]->min_y == min_y) {
+					tile = std::move(m_residentTiles[i]);
+					m_residentTiles[i] = std::move(m_residentTiles.back());
+					m_residentTiles.pop_back();
+					break;
+				}
+			}
+		}
+		assert(tile);
+		if (!tile)
+			return;
+
+		mergeBand(*tile);
+		MemoryTracker::add(MemoryCategory::Film, -int64_t(tileBytes(*tile)));
+	}
+
+	void FilmTiled::mergeBand(const Tile &tile) {
+		// Read-add-write of the band rows, neighbouring tiles overlap so the whole band is locked
+		const int width = tile.band_max_x - tile.band_min_x;
+		std::vector<Pixel> row(width);
+
+		std::lock_guard<std::mutex> lck(m_fileLock);
+		for (int y = tile.band_min_y; y < tile.band_max_y; y++) {
+			if (!readPixels(tile.band_min_x, y, width, row.data())) {
+				printf("Failed to merge tile (%d, %d) into %s\n", tile.min_x, tile.min_y, m_accumPath.c_str());
+				return;
+			}
+			for (int x = 0; x < width; x++) {
+				const Pixel &src = tile.pixels(x, y - tile.band_min_y);
+				row[x].color += src.color;
+				row[x].weight += src.weight;
+			}
+			writePixels(tile.band_min_x, y, width, row.data());
+		}
+	}
+
+	void FilmTiled::resolve() {
+		// Resolve to linear RGB row by row, pixels of tiles that never finished stay black
+		std::vector<Pixel> row(m_width);
+		std::vector<float> rgb(3 * m_width);
+		for (int y = 0; y < m_height; y++) {
+			if (!readPixels(0, y, m_width, row.data()))
+				break;
+			for (int x = 0; x < m_width; x++) {
+				const Pixel &pixel = row[x];
+				RGBSpectrum L = StoredSpectrum(pixel.color / (pixel.weight + float(AYA_EPSILON))).toRGBSpectrum();
+				rgb[3 * x + 0] = L[0];
+				rgb[3 * x + 1] = L[1];
+				rgb[3 * x + 2] = L[2];
+			}
+			if (!writeRow(0, y, m_width, rgb.data())) {
+				printf("Failed to write row %d to %s\n", y, m_path.c_str());
+				break;
+			}
+		}
+		closeAccumulation();
+	}
+
+	void FilmTiled::addSample(float x, float y, const StoredSpectrum &L) {
+		const int px = (int)std::floor(x);
+		const int py = (int)std::floor(y);
+
+		// Only the lookup is locked, a resident tile is written by its owner thread alone
+		Tile *tile = nullptr;
+		{
+			std::lock_guard<std::mutex> lck(m_mt);
+			for (auto &resident : m_residentTiles) {
+				if (px >= resident->min_x && px < resident->max_x &&
+					py >= resident->min_y && py < resident->max_y) {
+					tile = resident.get();
+					break;
+				}
+			}
+		}
+		if (!tile)
+			return;
+
+		// The guard band holds the whole footprint, only the image border clips it
+		x -= .5f;
+		y -= .5f;
+		int min_x = Clamp((int)std::ceil(x - mp_filter->getRadius()), tile->band_min_x, tile->band_max_x - 1);
+		int max_x = Clamp((int)std::floor(x + mp_filter->getRadius()), tile->band_min_x, tile->band_max_x - 1);
+		int min_y = Clamp((int)std::ceil(y - mp_filter->getRadius()), tile->band_min_y, tile->band_max_y - 1);
+		int max_y = Clamp((int)std::floor(y + mp_filter->getRadius()), tile->band_min_y, tile->band_max_y - 1);
+
+		for (auto i = min_y; i <= max_y; i++) {
+			for (auto j = min_x; j <= max_x; j++) {
+				Pixel &pixel = tile->pixels(j - tile->band_min_x, i - tile->band_min_y);
+				float weight = mp_filter->evaluate(j - x, i - y);
+				pixel.weight += weight;
+				pixel.color += weight * L;
+			}
+		}
+	}
+
+	void FilmTiled::addFilm(const Film *film, float weight) {
+		printf("FilmTiled does not support merging films\n");
+	}
+
+	void FilmTiled::splat(float x, float y, const StoredSpectrum &L) {
+		const int xx = Clamp((int)std::floor(x), 0, m_width - 1);
+		const int yy = Clamp((int)std::floor(y), 0, m_height - 1);
+
+		const int blocks_x = (m_width + SPLAT_BLOCK_SIZE - 1) / SPLAT_BLOCK_SIZE;
+		const uint32_t key = uint32_t(yy / SPLAT_BLOCK_SIZE) * blocks_x + uint32_t(xx / SPLAT_BLOCK_SIZE);
+
+		std::lock_guard<std::mutex> lck(m_splatLock);
+		std::unique_ptr<SplatBlock> &block = m_splatBlocks[key];
+		if (!block) {
+			block = std::make_unique<SplatBlock>();
+			for (auto &splat : block->L)
+				splat = StoredSpectrum(0.f);
+		}
+		block->L[(yy % SPLAT_BLOCK_SIZE) * SPLAT_BLOCK_SIZE + xx % SPLAT_BLOCK_SIZE] += L;
+	}
+
+	void FilmTiled::finish(const float ss) {
+		const float splat_scale = ss > 0.f ? ss : float(Max(m_sampleCount, 1u));
+		const int blocks_x = (m_width + SPLAT_BLOCK_SIZE - 1) / SPLAT_BLOCK_SIZE;
+
+		std::lock_guard<std::mutex> splat_lck(m_splatLock);
+		std::lock_guard<std::mutex> file_lck(m_fileLock);
+		if (!mp_file)
+			return;
+		resolve();
+
+		// Read-modify-write only the rows covered by splat blocks
+		std::vector<float> rgb(3 * SPLAT_BLOCK_SIZE);
+		for (auto &it : m_splatBlocks) {
+			const int min_x = int(it.first % blocks_x) * SPLAT_BLOCK_SIZE;
+			const int min_y = int(it.first / blocks_x) * SPLAT_BLOCK_SIZE;
+			const int max_x = Min(min_x + SPLAT_BLOCK_SIZE, m_width);
+			const int max_y = Min(min_y + SPLAT_BLOCK_SIZE, m_height);
+			const SplatBlock *block = it.second.get();
+
+			for (int y = min_y; y < max_y; y++) {
+				if (!readRow(min_x, y, max_x - min_x, rgb.data()))
+					continue;
+				for (int x = min_x; x < max_x; x++) {
+					RGBSpectrum L = StoredSpectrum(block->L[(y - min_y) * SPLAT_BLOCK_SIZE + x - min_x] / splat_scale).toRGBSpectrum();
+					rgb[3 * (x - min_x) + 0] += L[0];
+					rgb[3 * (x - min_x) + 1] += L[1];
+					rgb[3 * (x - min_x) + 2] += L[2];
+				}
+				writeRow(min_x, y, max_x - min_x, rgb.data());
+			}
+		}
+
+		fflush(mp_file);
+		printf("Tiled film written to %s, peak %d resident tile(s), %d splat block(s)\n",
+			m_path.c_str(), m_peakResidentTiles, int(m_splatBlocks.size()));
+	}
+}
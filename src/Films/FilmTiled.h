@@ -0,0 +1,91 @@
+#ifndef AYA_FILMS_FILMTILED_H
+#define AYA_FILMS_FILMTILED_H
+
+#include <Core/Film.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace Aya {
+	// Out-of-core film, only the tiles currently being rendered are resident.
+	// A resident tile keeps a guard band of one filter radius around it, a finished
+	// tile adds its band to an accumulation file next to the output, so the memory
+	// held does not grow with the image. Finish resolves the accumulators to linear
+	// RGB into a PFM file and adds the splats kept in a sparse block store
+	class FilmTiled : public Film {
+	protected:
+		struct Tile {
+			int min_x, min_y, max_x, max_y;
+			// Tile grown by the guard band, clipped to the image
+			int band_min_x, band_min_y, band_max_x, band_max_y;
+			BlockedArray<Pixel> pixels;
+		};
+		static size_t tileBytes(const Tile &tile) {
+			return size_t(tile.pixels.u()) * size_t(tile.pixels.v()) * sizeof(Pixel);
+		}
+
+		static const int SPLAT_BLOCK_SIZE = 16;
+		struct SplatBlock {
+			StoredSpectrum L[SPLAT_BLOCK_SIZE * SPLAT_BLOCK_SIZE];
+		};
+
+		std::string m_path;
+		FILE *mp_file;
+		int64_t m_dataOffset;
+		// Unresolved pixels of the whole image, removed once finish resolved them
+		std::string m_accumPath;
+		FILE *mp_accumFile;
+
+		// Grid the integrator renders, RenderTile::TILE_SIZE
+		int m_tileSize;
+		int m_guardBand;
+
+		std::vector<std::unique_ptr<Tile>> m_residentTiles;
+		int m_peakResidentTiles;
+		std::unordered_map<uint32_t, std::unique_ptr<SplatBlock>> m_splatBlocks;
+
+		mutable std::mutex m_splatLock;
+		mutable std::mutex m_fileLock;
+
+	public:
+		FilmTiled(int width, int height, Filter *filter, const char *path, const int tile_size)
+			: m_path(path), mp_file(nullptr), m_dataOffset(0), m_accumPath(std::string(path) + ".accum"), mp_accumFile(nullptr),
+			m_tileSize(tile_size), m_guardBand(0), m_peakResidentTiles(0) {
+			init(width, height, filter);
+		}
+		~FilmTiled() {
+			free();
+		}
+
+		void init(int width, int height, Filter *filter) override;
+		void resize(int width, int height) override;
+		void free() override;
+		void clear() override;
+
+		void addSample(float x, float y, const StoredSpectrum &L) override;
+		void addFilm(const Film *film, float weight = 1.f) override;
+		void splat(float x, float y, const StoredSpectrum &L) override;
+		void updateDisplay(const float splat_scale = 0.f) override {}
+
+		bool isTiled() const override {
+			return true;
+		}
+		void beginTile(const int min_x, const int min_y, const int max_x, const int max_y) override;
+		void endTile(const int min_x, const int min_y, const int max_x, const int max_y) override;
+		void finish(const float splat_scale = 0.f) override;
+
+	private:
+		bool openOutput();
+		void closeAccumulation();
+		void mergeBand(const Tile &tile);
+		void resolve();
+		bool writeRow(const int x, const int y, const int count, const float *rgb);
+		bool readRow(const int x, const int y, const int count, float *rgb);
+		bool writePixels(const int x, const int y, const int count, const Pixel *pixels);
+		bool readPixels(const int x, const int y, const int count, Pixel *pixels);
+	};
+}
+
+#endif
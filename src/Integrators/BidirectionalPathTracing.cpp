@@ -13,13 +13,13 @@ namespace Aya {
 	// Faculty of Information Technology. Brno University of Technology. Brno / Czech Republic
 	// Algorithm framework consistent with this paper
 	Spectrum BidirectionalPathTracingIntegrator::li(const RayDifferential &ray, 
-		const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const {
+		const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory, SampledWavelengths &wavelengths) const {
 		// Randomly select a light source, and generate the light path
 		PathVertex *light_path = memory.alloc<PathVertex>(m_maxDepth);
 		int light_vertex_cnt;
 		int light_path_len = generateLightPath(scene, sampler, rng,
 			mp_cam, mp_film, m_maxDepth + 1,
-			light_path, &light_vertex_cnt);
+			light_path, &light_vertex_cnt, wavelengths);
 
 		// Initialize camera path with eye ray
 		PathState cam_path;
@@ -29,6 +29,7 @@ namespace Aya {
 		Spectrum L(0.f);
 		while (true) {
 			RayDifferential path_ray(cam_path.ori, cam_path.dir);
+			path_ray.m_cone = cam_path.cone;
 			SurfaceIntersection local_isect;
 
 			if (!scene->intersect(path_ray, &local_isect)) {
@@ -40,7 +41,11 @@ namespace Aya {
 				}
 				break;
 			}
-			scene->postIntersect(ray, &local_isect);
+			// Only the eye ray has differentials
+			scene->postIntersect(cam_path.path_len == 1 ? ray : path_ray, &local_isect);
+			// Both sub-paths share the wavelengths, either one may terminate them
+			if (local_isect.bsdf->isDispersive())
+				wavelengths.terminateSecondary();
 
 			// Update MIS quantities from iteration (34) (35)
 			// Divide by g_i-> factor, Forward pdf conversion factor from solid angle measure to area measure (4) (8)
@@ -78,7 +83,7 @@ namespace Aya {
 			}
 
 			// Extend camera path with importance sampling on BSDF
-			if (!sampleScattering(scene, rng, path_ray, local_isect, sampler->getSample(), cam_path))
+			if (!sampleScattering(scene, rng, path_ray, local_isect, sampler->getSample(), cam_path, wavelengths))
 				break;
 		}
 
@@ -114,6 +119,10 @@ namespace Aya {
 		float emit_cos = emit_dir.dot(light_ray.m_dir);
 		path.dvcm = MIS(direct_pdf / emit_pdf);
 
+		// The ratio is the density of directions leaving a finite light, of positions otherwise
+		const float emit_density = direct_pdf > 0.f ? emit_pdf / direct_pdf : 0.f;
+		path.cone = light->isFinite() ? RayCone(0.f, RayCone::footprint(emit_density)) : RayCone(RayCone::footprint(emit_density));
+
 		// Such light sources cannot be hit by random rays, as their emission is defined via a delta distribution, 
 		// i.e. we have pVC,0 = 0. (48) (49)
 		if (light->isDelta())
@@ -131,7 +140,7 @@ namespace Aya {
 
 	int BidirectionalPathTracingIntegrator::generateLightPath(const Scene *scene, Sampler *sampler, RNG &rng,
 		const Camera *camera, Film *film, const uint32_t max_depth,
-		PathVertex *path, int *vertex_count,
+		PathVertex *path, int *vertex_count, SampledWavelengths &wavelengths,
 		const bool connect_to_cam, const int RR_depth) {
 		if (max_depth == 0) {
 			*vertex_count = 0;
@@ -150,11 +159,15 @@ namespace Aya {
 		// Light Tracing
 		*vertex_count = 0;
 		while (true) {
-			Ray path_ray(light_path.ori, light_path.dir);
+			RayDifferential path_ray(light_path.ori, light_path.dir);
+			path_ray.m_cone = light_path.cone;
 			SurfaceIntersection intersection;
 			if (!scene->intersect(path_ray, &intersection))
 				break;
 			scene->postIntersect(path_ray, &intersection);
+			// Before the splat below, which is converted at the wavelengths right away
+			if (intersection.bsdf->isDispersive())
+				wavelengths.terminateSecondary();
 			
 			// Update MIS quantities from iteration (34) (35)
 			// Divide by g_i-> factor, Forward pdf conversion factor from solid angle measure to area measure (4) (8)
@@ -183,7 +196,7 @@ namespace Aya {
 					Point3 raster;
 					Spectrum L = 
 						connectToCamera(scene, sampler, rng, camera, film, intersection, light_vertex, &raster);
-					film->splat(raster.x, raster.y, L);
+					film->splat(raster.x, raster.y, ToStored(L, wavelengths));
 				}
 			}
 
@@ -192,7 +205,7 @@ namespace Aya {
 				break;
 
 			// Extend light path with importance sampling on BSDF
-			if (!sampleScattering(scene, rng, path_ray, intersection, sampler->getSample(), light_path, RR_depth))
+			if (!sampleScattering(scene, rng, path_ray, intersection, sampler->getSample(), light_path, wavelengths, RR_depth))
 				break;
 		}
 
@@ -287,6 +300,7 @@ namespace Aya {
 		init_path.ori = ray.m_ori;
 		init_path.dir = ray.m_dir;
 		init_path.throughput = Spectrum(1.f);
+		init_path.cone = ray.m_cone;
 		init_path.path_len = 1;
 		init_path.specular_path = true;
 
@@ -416,7 +430,7 @@ namespace Aya {
 
 	bool BidirectionalPathTracingIntegrator::sampleScattering(const Scene *scene, RNG &rng,
 		const RayDifferential &ray, const SurfaceIntersection &intersection, const Sample& bsdf_sample, PathState &path_state,
-		const int RR_depth) {
+		const SampledWavelengths &wavelengths, const int RR_depth) {
 		// Sample the scattered direction
 		const BSDF *bsdf = intersection.bsdf;
 		Vector3 v_in;
@@ -429,13 +443,14 @@ namespace Aya {
 			return false;
 
 		bool non_specular = (sampled_type & BSDF_SPECULAR) == 0;
+		const RayCone cone = intersection.scatterCone(path_state.cone, !non_specular, pdf);
 
 		// For specular bounce, reverse pdf equals to forward pdf
 		float rev_pdf = non_specular ? bsdf->pdf(v_in, -ray.m_dir, intersection) : pdf;
 
 		// Apply Russian Roulette if non-specular surface was hit
 		if (non_specular && RR_depth != -1 && int(path_state.path_len) > RR_depth) {
-			float RR_prob = Min(1.f, path_state.throughput.luminance());
+			float RR_prob = Min(1.f, Luminance(path_state.throughput, wavelengths));
 			if (rng.drand48() < RR_prob) {
 				pdf *= RR_prob;
 				rev_pdf *= RR_prob;
@@ -447,6 +462,7 @@ namespace Aya {
 
 		path_state.ori = intersection.p;
 		path_state.dir = v_in;
+		path_state.cone = cone;
 
 		float cos_out = Abs(intersection.n.dot(v_in));
 		if (non_specular) {
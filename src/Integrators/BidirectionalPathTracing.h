@@ -10,6 +10,8 @@ namespace Aya {
 			Point3 ori;
 			Vector3 dir;
 			Spectrum throughput;
+			// Footprint for texture lookups along the path
+			RayCone cone;
 
 			// Shared a 32-bit field
 			uint32_t path_len		: 30;
@@ -46,12 +48,17 @@ namespace Aya {
 		~BidirectionalPathTracingIntegrator() {
 		}
 
-		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const override;
+		// Light subpaths connected to the camera splat to the film
+		bool usesSplats() const override {
+			return true;
+		}
+		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+			SampledWavelengths &wavelengths) const override;
 
 		static PathState sampleLightSource(const Scene *scene, Sampler *sampler, RNG &rng);
 		static int generateLightPath(const Scene *scene, Sampler *sampler, RNG &rng,
 			const Camera *camera, Film *film, const uint32_t max_depth,
-			PathVertex *path, int *vertex_count,
+			PathVertex *path, int *vertex_count, SampledWavelengths &wavelengths,
 			const bool connect_to_cam = true, const int RR_depth = 3);
 		static Spectrum connectToCamera(const Scene *scene, Sampler *sampler, RNG &rng,
 			const Camera *camera, Film *film,
@@ -68,7 +75,7 @@ namespace Aya {
 			const SurfaceIntersection &intersection, const PathVertex &light_vertex, const PathState &cam_path);
 		static bool sampleScattering(const Scene *scene, RNG &rng,
 			const RayDifferential &ray, const SurfaceIntersection &intersection, const Sample& bsdf_sample, PathState &path_state,
-			const int RR_depth = -1);
+			const SampledWavelengths &wavelengths, const int RR_depth = -1);
 
 		inline static float MIS(const float val) {
 			// Power Heuristic Method
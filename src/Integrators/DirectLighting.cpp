@@ -1,11 +1,14 @@
 #include <Integrators/DirectLighting.h>
 
 namespace Aya {
-	Spectrum DirectLightingIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const {
+	Spectrum DirectLightingIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+		SampledWavelengths &wavelengths) const {
 		SurfaceIntersection intersection;
 		Spectrum L;
 		if (scene->intersect(ray, &intersection)) {
 			scene->postIntersect(ray, &intersection);
+			if (intersection.bsdf->isDispersive())
+				wavelengths.terminateSecondary();
 
 			for (int i = 0; i < (int)scene->getLights().size(); i++) {
 				auto light = scene->getLights()[i].get();
@@ -13,8 +16,8 @@ namespace Aya {
 			}
 
 			if (ray.m_depth < m_maxDepth) {
-				L += specularReflect(this, scene, sampler, ray, intersection, rng, memory);
-				L += specularTransmit(this, scene, sampler, ray, intersection, rng, memory);
+				L += specularReflect(this, scene, sampler, ray, intersection, rng, memory, wavelengths);
+				L += specularTransmit(this, scene, sampler, ray, intersection, rng, memory, wavelengths);
 			}
 		}
 		else {
@@ -3,13 +3,15 @@
 
 namespace Aya {
 	void GuidedPathTracerIntegrator::resetSDTree() {
-		m_sdTree->refine((size_t)(std::sqrtf(std::powf(2, m_iter) * m_sppPerPass / 4) * m_sTreeThreshold), m_sdTreeMaxMemory);
+		m_sdTree->refine((size_t)(std::sqrt(std::pow(2, m_iter) * m_sppPerPass / 4) * m_sTreeThreshold), m_sdTreeMaxMemory);
 		m_sdTree->forEachDTreeWrapperParallel([this](DTreeWrapper *dTree) { dTree->reset(20, m_dTreeThreshold); });
+		m_sdTreeMemory.set(m_sdTree->approxMemoryFootprint());
 	}
 
 	void GuidedPathTracerIntegrator::buildSDTree() {
 		// Build distributions
 		m_sdTree->forEachDTreeWrapperParallel([](DTreeWrapper* dTree) { dTree->build(); });
+		m_sdTreeMemory.set(m_sdTree->approxMemoryFootprint());
 
 		// Gather statistics
 		// no info system, ignored temporarily
@@ -29,6 +31,13 @@ namespace Aya {
 	}
 
 	void GuidedPathTracerIntegrator::render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
+		m_task.beginRender();
+		// Passes are reweighted by their variance over the whole image, a film cannot be streamed tile by tile
+		if (film->isTiled()) {
+			printf("Guided Path Tracer does not support tiled films\n");
+			return;
+		}
+
 		m_sdTree = std::unique_ptr<STree>(new STree(scene->worldBound()));
 		m_iter = 0;
 		m_isFinalIter = false;
@@ -45,7 +54,7 @@ namespace Aya {
 
 			size_t sample_count = static_cast<size_t>(m_spp);
 
-			int n_passes = (int)std::ceilf(sample_count / (float)m_sppPerPass);
+			int n_passes = (int)std::ceil(sample_count / (float)m_sppPerPass);
 			sample_count = n_passes * m_sppPerPass;
 
 			float currentVarAtEnd = std::numeric_limits<float>::infinity();
@@ -121,6 +130,9 @@ namespace Aya {
 
 			film->updateDisplay();
 		}
+
+		TextureCache::get().printStatistics();
+		MemoryTracker::printStatistics();
 	}
 
 	bool GuidedPathTracerIntegrator::renderPasses(float &variance, int num_passes, const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
@@ -129,6 +141,7 @@ namespace Aya {
 
 		int passesRenderedLocal = { 0 };
 		int tiles_count = m_task.getTilesCount();
+		SamplerPool samplers(sampler);
 
 		for (int pass = 0; pass < num_passes; ++pass) {
 			++m_passesRendered;
@@ -144,31 +157,44 @@ namespace Aya {
 					//for (int i = 0; i < tiles_count; i++) {
 					const RenderTile& tile = m_task.getTile(i);
 
-					std::unique_ptr<Sampler> tile_sampler(sampler->clone(((m_passesRendered - 1) * m_sppPerPass + spp) * tiles_count + i));
+					// Past the deadline the film keeps the samples of the iteration in progress
+					if (m_task.checkDeadline())
+						return;
+
+					const uint64_t sample_idx = uint64_t(m_passesRendered - 1) * m_sppPerPass + spp;
+					Sampler *tile_sampler = samplers.acquire(int(sample_idx) * tiles_count + i);
 
 					RNG rng;
-					MemoryPool memory;
+					MemoryPool::Lease memory_lease;
+					MemoryPool &memory = memory_lease.pool();
 
 					for (int y = tile.min_y; y < tile.max_y; ++y) {
 						for (int x = tile.min_x; x < tile.max_x; ++x) {
 							if (m_task.aborted())
 								return;
 
+							rng.srand(HashSeed(x, y, sample_idx, SeedPurpose::Integrator));
 							tile_sampler->startPixel(x, y);
 							CameraSample cam_sample;
 							tile_sampler->generateSamples(x, y, &cam_sample, rng);
+							SampledWavelengths wavelengths;
+#if defined(AYA_HERO_SPECTRUM)
+							wavelengths = SampledWavelengths::sampleUniform(tile_sampler->get1D());
+							SampledWavelengths::current() = wavelengths;
+#endif
 							cam_sample.image_x += x;
 							cam_sample.image_y += y;
 
 							RayDifferential ray;
 							Spectrum L(0.f);
 							if (camera->generateRayDifferential(cam_sample, &ray)) {
-								L = li(ray, scene, tile_sampler.get(), rng, memory);
+								L = li(ray, scene, tile_sampler, rng, memory, wavelengths);
 							}
 
-							film->addSample(cam_sample.image_x, cam_sample.image_y, L);
-							m_image->addSample(cam_sample.image_x, cam_sample.image_y, L);
-							m_squaredImage->addSample(cam_sample.image_x, cam_sample.image_y, L * L);
+							const StoredSpectrum stored = ToStored(L, wavelengths);
+							film->addSample(cam_sample.image_x, cam_sample.image_y, stored);
+							m_image->addSample(cam_sample.image_x, cam_sample.image_y, stored);
+							m_squaredImage->addSample(cam_sample.image_x, cam_sample.image_y, stored * stored);
 							memory.freeAll();
 						}
 					}
@@ -179,6 +205,7 @@ namespace Aya {
 					return false;
 				}
 
+				sampler->advanceSampleIndex();
 				film->addSampleCount();
 				film->updateDisplay();
 			}
@@ -201,8 +228,8 @@ namespace Aya {
 		Vector2i size = m_squaredImage->getSize();
 		for (int x = 0; x < size.x; ++x)
 			for (int y = 0; y < size.y; ++y) {
-				Spectrum pixel = m_image->getPixel(x, y);
-				Spectrum local_var = m_squaredImage->getPixel(x, y) - pixel * pixel / (float)N;
+				StoredSpectrum pixel = m_image->getPixel(x, y);
+				StoredSpectrum local_var = m_squaredImage->getPixel(x, y) - pixel * pixel / (float)N;
 				m_varianceBuffer->setPixel(x, y, local_var);
 				// The local variance is clamped such that fireflies don't cause crazily unstable estimates.
 				variance += Min(local_var.luminance(), 10000.0f);
@@ -218,7 +245,8 @@ namespace Aya {
 		return true;
 	}
 
-	Spectrum GuidedPathTracerIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const {
+	Spectrum GuidedPathTracerIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+		SampledWavelengths &wavelengths) const {
 		return Spectrum(1.f);
 
 		struct Vertex {
@@ -337,6 +365,8 @@ namespace Aya {
 					break;
 
 				const BSDF *bsdf = intersection.bsdf;
+				if (bsdf->isDispersive())
+					wavelengths.terminateSecondary();
 
 				Vector3 voxel_size;
 				DTreeWrapper *dTree = nullptr;
@@ -434,7 +464,9 @@ namespace Aya {
 					break;
 
 				// Trace a ray in this direction
+				const RayCone cone = intersection.scatterCone(path_ray.m_cone, bsdf->isSpecular(), wo_pdf);
 				path_ray = Ray(intersection.p, in, intersection.m_mediumInterface.getMedium(in, intersection.n));
+				path_ray.m_cone = cone;
 				
 				// Keep track of the throughput, medium, and relative
 				//	refractive index along the path
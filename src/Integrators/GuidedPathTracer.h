@@ -42,7 +42,7 @@ namespace Aya {
 	}
 
 	inline float logistic(float x) {
-		return 1.f / (1.f + std::expf(-x));
+		return 1.f / (1.f + std::exp(-x));
 	}
 
 	// Implements the stochastic-gradient-based Adam optimizer [Kingma and Ba 2014]
@@ -98,10 +98,10 @@ namespace Aya {
 			++m_state.iter;
 
 			float actual_learning_rate = m_hparams.learning_rate * 
-				std::sqrtf(1.f - std::powf(m_hparams.beta2, m_state.iter)) / (1.f - std::powf(m_hparams.beta1, m_state.iter));
+				std::sqrt(1.f - std::pow(m_hparams.beta2, m_state.iter)) / (1.f - std::pow(m_hparams.beta1, m_state.iter));
 			m_state.first_moment = m_hparams.beta1 * m_state.first_moment + (1.f - m_hparams.beta1) * gradient;
 			m_state.second_moment = m_hparams.beta2 * m_state.second_moment + (1.f - m_hparams.beta2) * gradient * gradient;
-			m_state.variable -= actual_learning_rate * m_state.first_moment / (std::sqrtf(m_state.second_moment) + m_hparams.epsilon);
+			m_state.variable -= actual_learning_rate * m_state.first_moment / (std::sqrt(m_state.second_moment) + m_hparams.epsilon);
 
 			// Clamp the variable to the range [-20, 20] as a safeguard to avoid numerical instability:
 			// since the sigmoid involves the exponential of the variable, value of -20 or 20 already yield
@@ -394,7 +394,7 @@ namespace Aya {
 					}
 					else {
 						int depth = depthAt(p);
-						float size = std::powf(.5f, depth);
+						float size = std::pow(.5f, depth);
 
 						Point2f origin = p;
 						origin.x -= size / 2.f;
@@ -474,7 +474,7 @@ namespace Aya {
 
 				for (int i = 0; i < 4; i++) {
 					const QuadTreeNode &other_node = node.other_DTree->m_nodes[node.other_index];
-					const float fraction = total > 0.f ? (other_node.sum(i) / total) : std::powf(.25f, node.depth);
+					const float fraction = total > 0.f ? (other_node.sum(i) / total) : std::pow(.25f, node.depth);
 					assert(fraction <= 1.f + float(AYA_EPSILON));
 
 					if (node.depth < maxdepth && fraction > subdivision_threshold) {
@@ -580,9 +580,9 @@ namespace Aya {
 			const float cos_theta = 2.f * p.x - 1.f;
 			const float phi = 2.f * float(M_PI) * p.y;
 
-			const float sin_theta = std::sqrtf(1.f - cos_theta * cos_theta);
-			const float sin_phi = std::sinf(phi);
-			const float cos_phi = std::cosf(phi);
+			const float sin_theta = std::sqrt(1.f - cos_theta * cos_theta);
+			const float sin_phi = std::sin(phi);
+			const float cos_phi = std::cos(phi);
 			
 			return Vector3(sin_theta * cos_phi, sin_theta * sin_phi, cos_theta);
 		}
@@ -593,7 +593,7 @@ namespace Aya {
 			}
 
 			const float cos_theta = Clamp(d.z, -1.f, 1.f);
-			float phi = std::atan2f(d.y, d.x);
+			float phi = std::atan2(d.y, d.x);
 			while (phi < 0.f)
 				phi += 2.f * float(M_PI);
 
@@ -667,7 +667,7 @@ namespace Aya {
 
 			// Loss gradient w.r.t. sampling fraction
 			float mix_pdf = sampling_fraction * rec.bsdf_pdf + (1.f - sampling_fraction) * rec.DTree_pdf;
-			float ratio = std::powf(rec.product / mix_pdf, ratio_power);
+			float ratio = std::pow(rec.product / mix_pdf, ratio_power);
 			float dLoss_dSamplingFraction = -ratio / rec.wo_pdf * (rec.bsdf_pdf - rec.DTree_pdf);
 
 			// Chain rule to get loss gradient w.r.t. trainable variable
@@ -901,14 +901,23 @@ namespace Aya {
 			return m_nodes.size() < (std::numeric_limits<uint32_t>::max)() - 1 && node.dTree.statisticalWeightBuilding() > samples_required;
 		}
 
+		size_t approxMemoryFootprint() const {
+			size_t footprint = m_nodes.capacity() * sizeof(STreeNode);
+			for (const auto &node : m_nodes) {
+				footprint += node.dTreeWrapper()->approxMemoryFootprint();
+			}
+			return footprint;
+		}
+
 		void refine(size_t sTree_threshold, int maxMB) {
-			if (maxMB >= 0) {
-				size_t approxMemoryFootprint = { 0 };
-				for (const auto &node : m_nodes) {
-					approxMemoryFootprint += node.dTreeWrapper()->approxMemoryFootprint();
+			if (maxMB >= 0 || MemoryTracker::getBudget() > 0) {
+				const size_t footprint = approxMemoryFootprint();
+				if (maxMB >= 0 && footprint / 1000000 >= static_cast<size_t>(maxMB)) {
+					return;
 				}
 
-				if (approxMemoryFootprint / 1000000 >= static_cast<size_t>(maxMB)) {
+				// Keep the current subdivision once the global memory budget is exhausted
+				if (!MemoryTracker::fitsBudget(0)) {
 					return;
 				}
 			}
@@ -953,6 +962,7 @@ namespace Aya {
 	private:
 		// The datastructure for guiding paths.
 		std::unique_ptr<STree> m_sdTree;
+		MemoryTracker::Entry m_sdTreeMemory{ MemoryCategory::Integrator };
 
 		// The squared values of our currently rendered image. Used to estimate variance.
 		mutable std::shared_ptr<Film> m_squaredImage;
@@ -1097,7 +1107,8 @@ namespace Aya {
 
 		void render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) override;
 		bool renderPasses(float &variance, int num_passes, const Scene *scene, const Camera *camera, Sampler *sampler, Film *film);
-		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const;
+		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+			SampledWavelengths &wavelengths) const;
 
 	private:
 		void resetSDTree();
@@ -34,10 +34,34 @@ namespace Aya {
 			m_largeStepTime, m_time, m_largeStep, m_rng, 
 			m_samples);
 	}
+	void MetropolisSampler::reset(const Sampler *source, const int seed) {
+		m_samples.clear();
+		m_sampleIdx = 0;
+		m_streamIdx = 0;
+		m_largeStepTime = 0u;
+		m_time = 0u;
+		m_largeStep = true;
+		m_largeStepFilled = 0u;
+		m_rng.srand(HashSeed(0, 0, seed, SeedPurpose::SamplerStream));
+	}
 
 	void MetropolisSampler::startIteration() {
 		m_largeStep = m_rng.drand48() < m_largeStepProb;
 		m_time++;
+
+		// A large step replaces every sample, the ones the path does not reach again are
+		// uniform either way. mutate() skips the samples already moved in this iteration
+		m_largeStepFilled = m_largeStep ? m_samples.size() : 0;
+		if (m_largeStepFilled > 0) {
+			m_largeStepValues.resize(m_samples.size());
+			m_rng.fill(m_largeStepValues.data(), int(m_largeStepValues.size()));
+			for (size_t i = 0; i < m_samples.size(); i++) {
+				PrimarySample &sample = m_samples[i];
+				sample.backup();
+				sample.value = m_largeStepValues[i];
+				sample.modify = m_time;
+			}
+		}
 	}
 
 	void MetropolisSampler::accept() {
@@ -56,6 +80,9 @@ namespace Aya {
 		if (idx >= m_samples.size())
 			m_samples.resize(idx + 1);
 		
+		if (size_t(idx) < m_largeStepFilled)
+			return;
+
 		PrimarySample &sample = m_samples[idx];
 		if (sample.modify < m_largeStepTime) {
 			sample.modify = m_largeStepTime;
@@ -83,24 +110,27 @@ namespace Aya {
 	}
 
 	void MultiplexMLTIntegrator::render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
+		m_task.beginRender();
 		// Generate bootstrap samples and compute normalization constant b
 		int num_bootstrap_samples = m_numBootstrap * (int(m_maxDepth) + 1);
 		std::vector<float> bootstrap_weights(num_bootstrap_samples, 0.f);
 
 		concurrency::parallel_for(0, m_numBootstrap, [&](int i) {
 		//for (int i = 0; i < m_numBootstrap; i++) {
-			RNG rng(i);
-			MemoryPool memory;
+			RNG rng(HashSeed(0, 0, i, SeedPurpose::Bootstrap));
+			MemoryPool::Lease memory_lease;
+			MemoryPool &memory = memory_lease.pool();
 
 			for (int depth = 0; depth <= int(m_maxDepth); ++depth) {
-				if (m_task.aborted())
+				if (m_task.checkDeadline())
 					return;
 
 				int seed = depth + i * (m_maxDepth + 1);
 				MetropolisSampler sampler(m_sigma, m_largeStepProb, seed);
 
 				Vector2f raster_pos;
-				bootstrap_weights[seed] = evalSample(scene, &sampler, depth, &raster_pos, rng, memory).luminance();
+				SampledWavelengths wavelengths;
+				bootstrap_weights[seed] = Luminance(evalSample(scene, &sampler, depth, &raster_pos, &wavelengths, rng, memory), wavelengths);
 
 				memory.freeAll();
 			}
@@ -111,10 +141,11 @@ namespace Aya {
 			return;
 
 		Distribution1D bootstrap_distribution(bootstrap_weights.data(), int(bootstrap_weights.size()));
+		MemoryTracker::Entry bootstrap_memory(MemoryCategory::Integrator);
+		bootstrap_memory.set(bootstrap_weights.capacity() * sizeof(float) + (2 * bootstrap_weights.size() + 1) * sizeof(float));
 		float b = bootstrap_distribution.getIntegral() * (m_maxDepth + 1);
 
 		// Mutations per chain roughly equals to samples per pixel
-		float mutations_per_pixel = m_spp;
 		uint64_t total_mutations = m_spp * mp_film->getPixelCount();
 		uint64_t total_samples	 = 0u;
 
@@ -127,8 +158,9 @@ namespace Aya {
 				Min((i + 1) * total_mutations / m_numChains, total_mutations) -
 				i * total_mutations / m_numChains;
 
-			RNG rng(i);
-			MemoryPool memory;
+			RNG rng(HashSeed(0, 0, i, SeedPurpose::Chain));
+			MemoryPool::Lease memory_lease;
+			MemoryPool &memory = memory_lease.pool();
 
 			int bootstrap_idx = bootstrap_distribution.sampleDiscrete(rng.drand48(), nullptr);
 			int depth = bootstrap_idx % (m_maxDepth + 1);	// Target the bootstrap corresponding depth
@@ -136,32 +168,40 @@ namespace Aya {
 			// Initialize local variables for selected state
 			MetropolisSampler sampler(m_sigma, m_largeStepProb, bootstrap_idx); // bootstrap_idx equals to the seed
 
+			// Each state keeps the wavelengths its radiance was evaluated at
 			Vector2f current_raster;
-			Spectrum current_Li = evalSample(scene, &sampler, depth, &current_raster, rng, memory);
+			SampledWavelengths current_wavelengths;
+			Spectrum current_Li = evalSample(scene, &sampler, depth, &current_raster, &current_wavelengths, rng, memory);
+			float current_lum = Luminance(current_Li, current_wavelengths);
 
-			// Run the Markov chain for numChainMutations steps
+			// Run the Markov chain for numChainMutations steps,
+			// the clock is read every few hundred mutations only
 			for (uint64_t j = 0; j < chain_mutations; j++) {
-				if (m_task.aborted())
+				if (m_task.aborted() || ((j & 255) == 0 && m_task.checkDeadline()))
 					return;
 
 				sampler.startIteration();
 
 				Vector2f proposed_raster;
-				Spectrum proposed_Li = evalSample(scene, &sampler, depth, &proposed_raster, rng, memory);
+				SampledWavelengths proposed_wavelengths;
+				Spectrum proposed_Li = evalSample(scene, &sampler, depth, &proposed_raster, &proposed_wavelengths, rng, memory);
+				const float proposed_lum = Luminance(proposed_Li, proposed_wavelengths);
 
 				// Compute acceptance probability for proposed sample
-				float accept_prob = Min(1.f, proposed_Li.luminance() / (current_Li.luminance() + 1e-4f));
+				float accept_prob = Min(1.f, proposed_lum / (current_lum + 1e-4f));
 				if (accept_prob > 0.f)
 					mp_film->splat(proposed_raster.x, proposed_raster.y,
-						proposed_Li * accept_prob / (proposed_Li.luminance() + 1e-4f));
+						ToStored(proposed_Li * accept_prob / (proposed_lum + 1e-4f), proposed_wavelengths));
 
 				mp_film->splat(current_raster.x, current_raster.y, 
-					current_Li * (1.f - accept_prob) / (current_Li.luminance() + 1e-4f));
+					ToStored(current_Li * (1.f - accept_prob) / (current_lum + 1e-4f), current_wavelengths));
 
 				// Accept or reject the proposal
 				if (rng.drand48() < accept_prob) {
 					current_raster = proposed_raster;
 					current_Li = proposed_Li;
+					current_lum = proposed_lum;
+					current_wavelengths = proposed_wavelengths;
 					sampler.accept();
 				}
 				else {
@@ -187,13 +227,23 @@ namespace Aya {
 		//}
 		});
 
-		mp_film->updateDisplay(mutations_per_pixel / b);
+		// Chains cut short by abort or the time budget ran fewer mutations than planned
+		const float done_mutations_per_pixel = total_samples / float(mp_film->getPixelCount());
+		mp_film->updateDisplay(done_mutations_per_pixel / b);
+		mp_film->finish(done_mutations_per_pixel / b);
+
+		TextureCache::get().printStatistics();
+		MemoryTracker::printStatistics();
 	}
 
 	Spectrum MultiplexMLTIntegrator::evalSample(const Scene *scene, MetropolisSampler *sampler,
-		const int connect_depth, Vector2f *raster_pos,
+		const int connect_depth, Vector2f *raster_pos, SampledWavelengths *wavelengths,
 		RNG &rng, MemoryPool &memory) const {
 		sampler->startStream(0);
+#if defined(AYA_HERO_SPECTRUM)
+		*wavelengths = SampledWavelengths::sampleUniform(sampler->get1D());
+		SampledWavelengths::current() = *wavelengths;
+#endif
 
 		int light_length, eye_length, num_strategies;
 		if (connect_depth == 0) {
@@ -212,7 +262,7 @@ namespace Aya {
 			memory.alloc<BidirectionalPathTracingIntegrator::PathVertex>(light_length);
 		int num_light_vertex;
 		if (BidirectionalPathTracingIntegrator::generateLightPath(scene, sampler, rng,
-			mp_camera, mp_film, light_length, light_path, &num_light_vertex, false, -1) != light_length)
+			mp_camera, mp_film, light_length, light_path, &num_light_vertex, *wavelengths, false, -1) != light_length)
 			return Spectrum(0.f);
 
 		// Generate primary ray
@@ -241,6 +291,7 @@ namespace Aya {
 		bool last_hitting = false;
 		while (eye_length > 1) {
 			RayDifferential path_ray(cam_path.ori, cam_path.dir);
+			path_ray.m_cone = cam_path.cone;
 
 			if (!scene->intersect(path_ray, &cam_isect)) {
 				last_hitting = false;
@@ -251,8 +302,11 @@ namespace Aya {
 				break;
 			}
 
-			scene->postIntersect(path_ray, &cam_isect);
+			// Only the eye ray has differentials
+			scene->postIntersect(cam_path.path_len == 1 ? ray : path_ray, &cam_isect);
 			last_hitting = true;
+			if (cam_isect.bsdf->isDispersive())
+				wavelengths->terminateSecondary();
 
 			// Update MIS quantities from iteration (34) (35)
 			// Divide by g_i-> factor, Forward pdf conversion factor from solid angle measure to area measure (4) (8)
@@ -264,7 +318,7 @@ namespace Aya {
 			if (++cam_path.path_len >= uint32_t(eye_length))
 				break;
 
-			if (!BidirectionalPathTracingIntegrator::sampleScattering(scene, rng, path_ray, cam_isect, sampler->getSample(), cam_path))
+			if (!BidirectionalPathTracingIntegrator::sampleScattering(scene, rng, path_ray, cam_isect, sampler->getSample(), cam_path, *wavelengths))
 				break;
 		}
 
@@ -41,13 +41,16 @@ namespace Aya {
 		uint64_t m_time				= 0u;		// Current number of accepted mutations
 		bool m_largeStep			= true;
 
-		RNG m_rng;
+		// Eight lane generator on every build, large steps draw all primary samples in one fill
+		BufferedRNG m_rng;
+		std::vector<float> m_largeStepValues;
+		size_t m_largeStepFilled		= 0u;	// Samples below it already moved in this iteration
 
 	public:
 		MetropolisSampler(const float sigma,
 			const float large_step_prob,
 			int sample_idx, int stream_idx,
-			uint64_t large_step_time, uint64_t time, bool large_step, RNG rng,
+			uint64_t large_step_time, uint64_t time, bool large_step, const BufferedRNG &rng,
 			std::vector<PrimarySample> samples) 
 			: m_sigma(sigma), m_largeStepProb(large_step_prob), m_rng(rng),
 			m_sampleIdx(sample_idx), m_streamIdx(stream_idx), 
@@ -56,7 +59,8 @@ namespace Aya {
 		}
 		MetropolisSampler(const float sigma,
 			const float large_step_prob,
-			const int seed) : m_sigma(sigma), m_largeStepProb(large_step_prob), m_rng(seed) {
+			const int seed) : m_sigma(sigma), m_largeStepProb(large_step_prob),
+			m_rng(HashSeed(0, 0, seed, SeedPurpose::SamplerStream)) {
 		}
 
 		float get1D() override;
@@ -66,13 +70,14 @@ namespace Aya {
 
 		std::unique_ptr<Sampler> clone(const int seed) const override;
 		std::unique_ptr<Sampler> deepClone() const override;
+		void reset(const Sampler *source, const int seed) override;
 
 		void startIteration();
 		void accept();
 		void reject();
 		void mutate(const int idx);
 
-		void startStream(const int idx) {
+		void startStream(const int idx) override {
 			assert(idx < stream_count);
 			m_streamIdx = idx;
 			m_sampleIdx = 0;
@@ -112,7 +117,7 @@ namespace Aya {
 
 	public:
 		Spectrum evalSample(const Scene *scene, MetropolisSampler *sampler,
-			const int connect_depth, Vector2f *raster_pos,
+			const int connect_depth, Vector2f *raster_pos, SampledWavelengths *wavelengths,
 			RNG &rng, MemoryPool &memory) const;
 	};
 }
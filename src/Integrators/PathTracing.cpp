@@ -1,7 +1,8 @@
 #include <Integrators/PathTracing.h>
 
 namespace Aya {
-	Spectrum PathTracingIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const {
+	Spectrum PathTracingIntegrator::li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+		SampledWavelengths &wavelengths) const {
 		Spectrum L(0.f);
 		Spectrum tp = Spectrum(1.f);
 
@@ -34,6 +35,8 @@ namespace Aya {
 					break;
 
 				auto bsdf = intersection.bsdf;
+				if (bsdf->isDispersive())
+					wavelengths.terminateSecondary();
 				if (!bsdf->isSpecular()) {
 					float sample1d = sampler->get1D();
 					int light_idx = Min(int(sample1d * scene->getLightCount()), int(scene->getLightCount() - 1));
@@ -57,7 +60,9 @@ namespace Aya {
 				bool sample_subsurface = false;
 				if (!sample_subsurface) {
 					spec_bounce = (sample_types & BSDF_SPECULAR) != 0;
+					const RayCone cone = intersection.scatterCone(path_ray.m_cone, spec_bounce, pdf);
 					path_ray = Ray(pos, in, intersection.m_mediumInterface.getMedium(in, normal));
+					path_ray.m_cone = cone;
 				}
 				else {
 					// There will be a BSSRDF integrator ...
@@ -78,15 +83,18 @@ namespace Aya {
 
 				Vector3 out = -path_ray.m_dir;
 				Vector3 in;
-				func->sample_f(out, &in, sampler->get2D());
+				float phase_pdf = func->sample_f(out, &in, sampler->get2D());
 
 				spec_bounce = false;
+				const RayCone cone(path_ray.m_cone.widthAt((medium.p - path_ray.m_ori).length()),
+					path_ray.m_cone.m_spread + RayCone::footprint(phase_pdf));
 				path_ray = Ray(medium.p, in, path_ray.mp_medium);
+				path_ray.m_cone = cone;
 			}
 
 			// Russian Roulette
 			if (bounce > 3) {
-				float RR = Min(1.f, tp.luminance());
+				float RR = Min(1.f, Luminance(tp, wavelengths));
 				if (rng.drand48() > RR)
 					break;
 
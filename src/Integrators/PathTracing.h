@@ -15,7 +15,8 @@ namespace Aya {
 		~PathTracingIntegrator() {
 		}
 
-		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory) const override;
+		Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG &rng, MemoryPool &memory,
+			SampledWavelengths &wavelengths) const override;
 	};
 }
 
@@ -45,33 +45,46 @@ namespace Aya {
 	}
 
 	void VertexCMIntegrator::render(const Scene *scene, const Camera *camera, Sampler *sampler, Film *film) {
+		m_task.beginRender();
+		// Light paths of a pass are shared by every pixel, a film cannot be streamed tile by tile
+		if (film->isTiled()) {
+			printf("Vertex Connection and Merging does not support tiled films\n");
+			return;
+		}
+
 		Point3 scene_center;
 		float scene_radius;
 		scene->worldBound().boundingSphere(&scene_center, &scene_radius);
 
-		// global Lock
-		std::mutex mutex;
-
 		std::vector<PathVertex> light_vertices;	// Stored light vertices
+		// Light vertices of every tile, concatenated in tile order so the
+		// vertex order does not depend on scheduling
+		std::vector<std::vector<PathVertex>> tile_vertices;
 
 		// For light path belonging to pixel index [x] it stores
 		// where it's light vertices end (begin is at [x-1])
 		BlockedArray<Vector2i> ranges;
-		BlockedArray<std::unique_ptr<Sampler>> pixel_samplers;
+
+		// Camera paths regenerate their pixel's sampler with a second stream of the same pixel sample
+		SamplerPool samplers(sampler);
 
 		HashGrid grid;
 
+		MemoryTracker::Entry tracked_memory(MemoryCategory::Integrator);
+
 		ranges.init(m_task.getX(), m_task.getY());
-		pixel_samplers.init(m_task.getX(), m_task.getY());
 
 		for (uint32_t spp = 0; spp < m_spp; spp++) {
+			if (m_task.checkDeadline())
+				break;
+
 			int tiles_count = m_task.getTilesCount();
 			int height = m_task.getX();
 			int width = m_task.getY();
 
 			// Setup our radius, 1st iteration has aIteration == 0, thus offset
 			float radius = m_baseRadius * scene_radius;
-			radius /= std::powf(float(spp + 1), .5f * (1.f - m_radiusAlpha));
+			radius /= std::pow(float(spp + 1), .5f * (1.f - m_radiusAlpha));
 			// Purely for numeric stability
 			radius = Max(radius, 1e-7f);
 			const float radius_sqr = radius * radius;
@@ -88,66 +101,101 @@ namespace Aya {
 			// Remove all light vertices and reserve space for some
 			light_vertices.reserve(m_task.getX() * m_task.getY());
 			light_vertices.clear();
+			tile_vertices.resize(tiles_count);
+
+#if defined(AYA_HERO_SPECTRUM)
+			// Merging mixes light and camera paths of different pixels, so a pass shares its wavelengths
+			RNG wavelength_rng(HashSeed(0, 0, spp, SeedPurpose::Integrator, 1));
+			const SampledWavelengths pass_wavelengths = SampledWavelengths::sampleUniform(wavelength_rng.drand48());
+#endif
 
 			concurrency::parallel_for(0, tiles_count, [&](int i) {
 				//for (int i = 0; i < tiles_count; i++) {
 				const RenderTile& tile = m_task.getTile(i);
 
-				std::unique_ptr<Sampler> tile_sampler = sampler->clone(spp * tiles_count + i);
+				Sampler *tile_sampler = samplers.acquire(spp * tiles_count + i);
+				std::vector<PathVertex> &vertices = tile_vertices[i];
+				vertices.clear();
 
 				RNG rng;
-				MemoryPool memory;
+				MemoryPool::Lease memory_lease;
+				MemoryPool &memory = memory_lease.pool();
 
 				for (int y = tile.min_y; y < tile.max_y; ++y) {
 					for (int x = tile.min_x; x < tile.max_x; ++x) {
 						if (m_task.aborted())
 							return;
 
-						Sampler *sampler = tile_sampler.get();
+						rng.srand(HashSeed(x, y, spp, SeedPurpose::LightPath));
+						Sampler *sampler = tile_sampler;
 						sampler->startPixel(x, y);
+						sampler->startStream(0);
+						SampledWavelengths wavelengths;
+#if defined(AYA_HERO_SPECTRUM)
+						wavelengths = pass_wavelengths;
+						SampledWavelengths::current() = pass_wavelengths;
+#endif
 
 						// Randomly select a light source, and generate the light path
 						PathVertex *light_path = memory.alloc<PathVertex>(m_maxDepth);
 						int light_vertex_cnt;
 						int light_path_len = generateLightPath(scene, sampler, rng,
 							mp_cam, mp_film, m_maxDepth + 1,
-							light_path, &light_vertex_cnt);
-						{
-							std::lock_guard<std::mutex> lck(mutex);
-							int vertex_start = int(light_vertices.size());
-							for (int i = 0; i < light_vertex_cnt; i++) {
-								const PathVertex &vert = light_path[i];
-								light_vertices.push_back(vert);
-							}
-							int vertex_end = int(light_vertices.size());
-
-							ranges(x, y) = Vector2i(vertex_start, vertex_end);
-							pixel_samplers(x, y) = sampler->deepClone();
-						}
+							light_path, &light_vertex_cnt, wavelengths);
+						// Ranges are tile local until the tiles are concatenated
+						int vertex_start = int(vertices.size());
+						vertices.insert(vertices.end(), light_path, light_path + light_vertex_cnt);
+						ranges(x, y) = Vector2i(vertex_start, int(vertices.size()));
 					}
 				}
 				//}
 			});
 
+			size_t tile_bytes = 0;
+			for (int i = 0; i < tiles_count; i++) {
+				const RenderTile& tile = m_task.getTile(i);
+				const int offset = int(light_vertices.size());
+				tile_bytes += tile_vertices[i].capacity() * sizeof(PathVertex);
+				light_vertices.insert(light_vertices.end(), tile_vertices[i].begin(), tile_vertices[i].end());
+
+				for (int y = tile.min_y; y < tile.max_y; ++y)
+					for (int x = tile.min_x; x < tile.max_x; ++x)
+						ranges(x, y) += Vector2i(offset, offset);
+			}
+
 			// Only build grid when merging (VCM, BPM, and PPM)
 			if (m_useVM) {
 				grid.reserve(m_task.getX() * m_task.getY());
 				grid.build(light_vertices, radius);
 			}
+			tracked_memory.set(light_vertices.capacity() * sizeof(PathVertex) + tile_bytes + grid.approxMemoryFootprint() +
+				size_t(m_task.getX()) * size_t(m_task.getY()) * sizeof(Vector2i));
 
 			concurrency::parallel_for(0, tiles_count, [&](int i) {
 				//for (int i = 0; i < tiles_count; i++) {
 				const RenderTile& tile = m_task.getTile(i);
 
+				Sampler *tile_sampler = samplers.acquire(spp * tiles_count + i);
+
 				RNG rng;
-				MemoryPool memory;
+				MemoryPool::Lease memory_lease;
+				MemoryPool &memory = memory_lease.pool();
 
 				for (int y = tile.min_y; y < tile.max_y; ++y) {
 					for (int x = tile.min_x; x < tile.max_x; ++x) {
 						if (m_task.aborted())
 							return;
 
-						Sampler *sampler = pixel_samplers(x, y).get();
+						rng.srand(HashSeed(x, y, spp, SeedPurpose::Integrator));
+						Sampler *sampler = tile_sampler;
+						sampler->startPixel(x, y);
+						sampler->startStream(1);
+						// Terminated by dispersive hits of the camera path or of the light vertices it uses
+						SampledWavelengths wavelengths;
+#if defined(AYA_HERO_SPECTRUM)
+						wavelengths = pass_wavelengths;
+						SampledWavelengths::current() = pass_wavelengths;
+#endif
 
 						CameraSample cam_sample;
 						sampler->generateSamples(x, y, &cam_sample, rng);
@@ -164,6 +212,7 @@ namespace Aya {
 							// Iterate camera path with Path Tracing, and connect it with the light path
 							while (true) {
 								RayDifferential path_ray(cam_path.ori, cam_path.dir);
+								path_ray.m_cone = cam_path.cone;
 								SurfaceIntersection local_isect;
 
 								if (!scene->intersect(path_ray, &local_isect)) {
@@ -175,7 +224,10 @@ namespace Aya {
 									}
 									break;
 								}
-								scene->postIntersect(ray, &local_isect);
+								// Only the eye ray has differentials
+								scene->postIntersect(cam_path.path_len == 1 ? ray : path_ray, &local_isect);
+								if (local_isect.bsdf->isDispersive())
+									wavelengths.terminateSecondary();
 
 								// Update the MIS quantities, following the initialization in
 								// GenerateLightSample() or SampleScattering(). Implement equations
@@ -221,6 +273,8 @@ namespace Aya {
 										if (light_vertex.path_len + cam_path.path_len > m_maxDepth)
 											break;
 
+										if (light_vertex.dispersed)
+											wavelengths.terminateSecondary();
 										L += cam_path.throughput * light_vertex.throughput *
 											connectVertex(scene, rng, local_isect, light_vertex, cam_path);
 									}
@@ -230,6 +284,8 @@ namespace Aya {
 								if (!bsdf->isSpecular() && m_useVM) {
 									RangeQuery query(*this, local_isect, bsdf, cam_path);
 									grid.process(light_vertices, query);
+									if (query.isDispersed())
+										wavelengths.terminateSecondary();
 									L += cam_path.throughput * m_VM_normalization * query.getContrib();
 
 									// PPM merges only at the first non-specular surface from camera
@@ -238,12 +294,12 @@ namespace Aya {
 								}
 
 								// Extend camera path with importance sampling on BSDF
-								if (!sampleScattering(scene, rng, path_ray, local_isect, sampler->getSample(), cam_path))
+								if (!sampleScattering(scene, rng, path_ray, local_isect, sampler->getSample(), cam_path, wavelengths))
 									break;
 							}
 						}
 
-						film->addSample(cam_sample.image_x, cam_sample.image_y, L);
+						film->addSample(cam_sample.image_x, cam_sample.image_y, ToStored(L, wavelengths));
 						memory.freeAll();
 					}
 				}
@@ -258,6 +314,9 @@ namespace Aya {
 			if (m_task.aborted())
 				break;
 		}
+
+		TextureCache::get().printStatistics();
+		MemoryTracker::printStatistics();
 	}
 
 	VertexCMIntegrator::PathState
@@ -293,6 +352,10 @@ namespace Aya {
 		// Delta lights are handled as well [tech. rep. (48)-(50)].
 		path.dvcm = MIS(direct_pdf / emit_pdf);
 
+		// The ratio is the density of directions leaving a finite light, of positions otherwise
+		const float emit_density = direct_pdf > 0.f ? emit_pdf / direct_pdf : 0.f;
+		path.cone = light->isFinite() ? RayCone(0.f, RayCone::footprint(emit_density)) : RayCone(RayCone::footprint(emit_density));
+
 		if (light->isDelta())
 			path.dvc = 0.f;
 		else if (light->isFinite())
@@ -306,7 +369,7 @@ namespace Aya {
 	}
 	int VertexCMIntegrator::generateLightPath(const Scene *scene, Sampler *sampler, RNG &rng,
 		const Camera *camera, Film *film, const uint32_t max_depth,
-		PathVertex *path, int *vertex_count,
+		PathVertex *path, int *vertex_count, SampledWavelengths &wavelengths,
 		const bool connect_to_cam, const int RR_depth) const {
 		if (max_depth == 0) {
 			*vertex_count = 0;
@@ -324,12 +387,18 @@ namespace Aya {
 
 		// Light Tracing
 		*vertex_count = 0;
+		bool dispersed = false;
 		while (true) {
-			Ray path_ray(light_path.ori, light_path.dir);
+			RayDifferential path_ray(light_path.ori, light_path.dir);
+			path_ray.m_cone = light_path.cone;
 			SurfaceIntersection intersection;
 			if (!scene->intersect(path_ray, &intersection))
 				break;
 			scene->postIntersect(path_ray, &intersection);
+			if (intersection.bsdf->isDispersive()) {
+				wavelengths.terminateSecondary();
+				dispersed = true;
+			}
 
 			// Update the MIS quantities before storing them at the vertex.
 			// These updates follow the initialization in GenerateLightSample() or
@@ -351,6 +420,7 @@ namespace Aya {
 				PathVertex &light_vertex = path[(*vertex_count)++];
 				light_vertex.throughput = light_path.throughput;
 				light_vertex.path_len = light_path.path_len;
+				light_vertex.dispersed = dispersed;
 				light_vertex.isect = intersection;
 				light_vertex.v_in = -light_path.dir;
 				
@@ -364,7 +434,7 @@ namespace Aya {
 						Point3 raster;
 						Spectrum L =
 							connectToCamera(scene, sampler, rng, camera, film, intersection, light_vertex, &raster);
-						film->splat(raster.x, raster.y, L);
+						film->splat(raster.x, raster.y, ToStored(L, wavelengths));
 					}
 				}
 			}
@@ -374,7 +444,7 @@ namespace Aya {
 				break;
 
 			// Extend light path with importance sampling on BSDF
-			if (!sampleScattering(scene, rng, path_ray, intersection, sampler->getSample(), light_path, RR_depth))
+			if (!sampleScattering(scene, rng, path_ray, intersection, sampler->getSample(), light_path, wavelengths, RR_depth))
 				break;
 		}
 
@@ -497,6 +567,7 @@ namespace Aya {
 		init_path.ori = ray.m_ori;
 		init_path.dir = ray.m_dir;
 		init_path.throughput = Spectrum(1.f);
+		init_path.cone = ray.m_cone;
 		init_path.path_len = 1;
 		init_path.specular_path = true;
 
@@ -679,7 +750,7 @@ namespace Aya {
 
 	bool VertexCMIntegrator::sampleScattering(const Scene *scene, RNG &rng,
 		const RayDifferential &ray, const SurfaceIntersection &intersection, const Sample& bsdf_sample, PathState &path_state,
-		const int RR_depth) const {
+		const SampledWavelengths &wavelengths, const int RR_depth) const {
 		// Sample the scattered direction
 		const BSDF *bsdf = intersection.bsdf;
 		Vector3 v_in;
@@ -692,13 +763,14 @@ namespace Aya {
 			return false;
 
 		bool non_specular = (sampled_type & BSDF_SPECULAR) == 0;
+		const RayCone cone = intersection.scatterCone(path_state.cone, !non_specular, pdf);
 
 		// For specular bounce, reverse pdf equals to forward pdf
 		float rev_pdf = non_specular ? bsdf->pdf(v_in, -ray.m_dir, intersection) : pdf;
 
 		// Apply Russian Roulette if non-specular surface was hit
 		if (non_specular && RR_depth != -1 && int(path_state.path_len) > RR_depth) {
-			float RR_prob = Min(1.f, path_state.throughput.luminance());
+			float RR_prob = Min(1.f, Luminance(path_state.throughput, wavelengths));
 			if (rng.drand48() < RR_prob) {
 				pdf *= RR_prob;
 				rev_pdf *= RR_prob;
@@ -710,6 +782,7 @@ namespace Aya {
 
 		path_state.ori = intersection.p;
 		path_state.dir = v_in;
+		path_state.cone = cone;
 
 		float cos_out = Abs(intersection.n.dot(v_in));
 		if (non_specular) {
@@ -14,6 +14,7 @@ namespace Aya {
 			Point3 ori;					// Path origin
 			Vector3 dir;					// Where to go next
 			Spectrum throughput;			// Path throughput
+			RayCone cone;					// Footprint for texture lookups
 
 			// Shared a 32-bit field
 			uint32_t path_len	 : 30;	// Number of path segments, including this
@@ -29,6 +30,7 @@ namespace Aya {
 		struct PathVertex {
 			Spectrum throughput;			// Path throughput (including emission)
 			uint32_t path_len;			// Number of segments between source and vertex
+			bool dispersed;				// Passed a dispersive BSDF, paths using it keep the hero wavelength only
 
 			// Stores all required local information, including incoming direction.
 			SurfaceIntersection isect;
@@ -52,6 +54,7 @@ namespace Aya {
 			const PathState &m_cam_state;
 
 			Spectrum m_contrib;
+			bool m_dispersed;
 
 		public:
 			RangeQuery(
@@ -64,7 +67,8 @@ namespace Aya {
 				m_cam_isect(intersection),
 				m_cam_bsdf(cam_bsdf),
 				m_cam_state(cam_state),
-				m_contrib(0.f) {
+				m_contrib(0.f),
+				m_dispersed(false) {
 			}
 
 			const Point3& getPostion() const {
@@ -73,6 +77,10 @@ namespace Aya {
 			const Spectrum& getContrib() const {
 				return m_contrib;
 			}
+			// A merged light vertex was dispersed, the camera path has to terminate its wavelengths
+			bool isDispersed() const {
+				return m_dispersed;
+			}
 
 			void process(const PathVertex &light_vertex) {
 				// Reject if full path length below/above min/max path length
@@ -104,6 +112,7 @@ namespace Aya {
 					1.f / (weight_light + 1.f + weight_camera);
 
 				m_contrib += MIS_weight * cam_bsdf_fac * light_vertex.throughput;
+				m_dispersed |= light_vertex.dispersed;
 			}
 		};
 
@@ -122,6 +131,9 @@ namespace Aya {
 			void reserve(int num) {
 				m_cell_ends.resize(num);
 			}
+			size_t approxMemoryFootprint() const {
+				return (m_indices.capacity() + m_cell_ends.capacity()) * sizeof(int);
+			}
 			void build(const std::vector<PathVertex> &particles, float radius) {
 				m_radius = radius;
 				m_radius_sqr = radius * radius;
@@ -169,9 +181,9 @@ namespace Aya {
 
 				const Vector3 cell_pt = m_cell_size_inv * dist_min;
 				const Vector3 coord_f(
-					std::floorf(cell_pt.x),
-					std::floorf(cell_pt.y),
-					std::floorf(cell_pt.z));
+					std::floor(cell_pt.x),
+					std::floor(cell_pt.y),
+					std::floor(cell_pt.z));
 
 				const int px = int(coord_f.x);
 				const int py = int(coord_f.y);
@@ -272,7 +284,7 @@ namespace Aya {
 		PathState sampleLightSource(const Scene *scene, Sampler *sampler, RNG &rng) const;
 		int generateLightPath(const Scene *scene, Sampler *sampler, RNG &rng,
 			const Camera *camera, Film *film, const uint32_t max_depth,
-			PathVertex *path, int *vertex_count,
+			PathVertex *path, int *vertex_count, SampledWavelengths &wavelengths,
 			const bool connect_to_cam = true, const int RR_depth = 3) const;
 		Spectrum connectToCamera(const Scene *scene, Sampler *sampler, RNG &rng,
 			const Camera *camera, Film *film,
@@ -289,7 +301,7 @@ namespace Aya {
 			const SurfaceIntersection &intersection, const PathVertex &light_vertex, const PathState &cam_path) const;
 		bool sampleScattering(const Scene *scene, RNG &rng,
 			const RayDifferential &ray, const SurfaceIntersection &intersection, const Sample& bsdf_sample, PathState &path_state,
-			const int RR_depth = -1) const;
+			const SampledWavelengths &wavelengths, const int RR_depth = -1) const;
 
 
 	private:
@@ -10,14 +10,14 @@ namespace Aya {
 	class AreaLight : public Light {
 	private:
 		Primitive *mp_prim;
-		Spectrum m_intensity;
+		StoredSpectrum m_intensity;
 		uint32_t m_triangleCount;
 		float m_area, m_areaInv;
 		std::unique_ptr<BVHAccel> m_BVH;
 
 	public:
 		AreaLight(Primitive *prim,
-			const Spectrum &intens,
+			const StoredSpectrum &intens,
 			const uint32_t sample_count = 1) :
 			Light(sample_count), mp_prim(prim), m_intensity(intens) {
 			m_triangleCount = mp_prim->getMesh()->getTriangleCount();
@@ -69,7 +69,7 @@ namespace Aya {
 			if (emit_pdf_w)
 				*emit_pdf_w = CosineHemispherePDF(cos) * m_areaInv;
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		Spectrum sample(const Sample &light_sample0,
@@ -101,7 +101,7 @@ namespace Aya {
 			if (direct_pdf)
 				*direct_pdf = m_areaInv;
 
-			return m_intensity * CosTheta(local_dir_out);
+			return FromStored(m_intensity, SpectrumType::Illuminant) * CosTheta(local_dir_out);
 		}
 
 		Spectrum emit(const Vector3 &dir,
@@ -116,7 +116,7 @@ namespace Aya {
 			if (pdf)
 				*pdf = m_areaInv * CosineHemispherePDF(normal, dir);
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		float pdf(const Point3 &pos, const Vector3 &dir) const override {
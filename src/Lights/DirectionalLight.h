@@ -8,7 +8,7 @@
 namespace Aya {
 	class DirectionalLight : public Light {
 	private:
-		Spectrum m_intensity;
+		StoredSpectrum m_intensity;
 		Vector3 m_dir;
 		Frame m_dirFrame;
 		float m_coneCos;
@@ -16,7 +16,7 @@ namespace Aya {
 
 	public:
 		DirectionalLight(const Vector3 &dir,
-			const Spectrum &intens,
+			const StoredSpectrum &intens,
 			const Scene *scene,
 			const float cone_deg = 0.f,
 			const uint32_t sample_count = 1) :
@@ -51,7 +51,7 @@ namespace Aya {
 			if (emit_pdf_w)
 				*emit_pdf_w = ConcentricDiscPdf() / (radius * radius) * (*pdf);
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		Spectrum sample(const Sample &light_sample0,
@@ -83,7 +83,7 @@ namespace Aya {
 			if (direct_pdf)
 				*direct_pdf = dir_pdf;
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		Spectrum emit(const Vector3 &dir,
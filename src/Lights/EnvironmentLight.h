@@ -9,7 +9,7 @@
 namespace Aya {
 	class EnvironmentLight : public Light {
 	private:
-		std::unique_ptr<Texture2D<Spectrum>> mp_map;
+		std::unique_ptr<Texture2D<RGBSpectrum>> mp_map;
 		std::unique_ptr<Distribution2D> mp_distribution;
 		BlockedArray<float> m_luminance;
 		const Scene *mp_scene;
@@ -19,14 +19,14 @@ namespace Aya {
 		mutable float m_rotation;
 
 	public:
-		EnvironmentLight(const Spectrum &intens,
+		EnvironmentLight(const StoredSpectrum &intens,
 			const Scene* scene,
 			const uint32_t sample_count = 1) :
 			Light(sample_count) {
 			mp_scene = scene;
 			is_texture = false;
 			m_scale = 1.f;
-			mp_map = std::make_unique<ConstantTexture2D<Spectrum>>(intens);
+			mp_map = std::make_unique<ConstantTexture2D<RGBSpectrum>>(intens.toRGBSpectrum());
 		}
 		EnvironmentLight(const char *path,
 			const Scene *scene,
@@ -38,7 +38,8 @@ namespace Aya {
 			is_texture = true;
 			m_scale = scale;
 			m_rotation = Radian(rotate);
-			mp_map = std::make_unique<ImageTexture2D<Spectrum, Spectrum>>(path, 1.f);
+			// Half float texels, upsampled to Spectrum per lookup
+			mp_map = std::make_unique<ImageTexture2D<RGBSpectrum, halfSpectrum>>(path, 1.f);
 			calcLuminanceDistribution();
 		}
 
@@ -59,9 +60,9 @@ namespace Aya {
 				float phi = u * float(M_PI) * 2.f;
 				phi = applyRotation(phi, -1.f);
 				float theta = v * float(M_PI);
-				float sin_theta = std::sinf(theta);
+				float sin_theta = std::sin(theta);
 				*pdf = sin_theta != 0.f ? *pdf * float(M_1_PI) * float(M_1_PI) * .5f / sin_theta : 0.f;
-				*dir = BaseVector3::sphericalDirection(sin_theta, std::cosf(theta), phi);
+				*dir = BaseVector3::sphericalDirection(sin_theta, std::cos(theta), phi);
 			}
 			else {
 				u = light_sample.u;
@@ -85,7 +86,7 @@ namespace Aya {
 			tester->setMedium(scatter.m_mediumInterface.getMedium(*dir, scatter.n));
 
 			Vector2f diff[2] = {Vector2f(), Vector2f()};
-			return mp_map->sample(Vector2f(u, v), diff, TextureFilter::Linear) * m_scale;
+			return Spectrum(mp_map->sample(Vector2f(u, v), diff, TextureFilter::Linear), SpectrumType::Illuminant) * m_scale;
 		}
 
 		Spectrum sample(const Sample &light_sample0,
@@ -109,8 +110,8 @@ namespace Aya {
 				float phi = u * float(M_PI) * 2.f;
 				phi = applyRotation(phi, -1.f);
 				float theta = v * float(M_PI);
-				sin_theta = std::sinf(theta);
-				*normal = -BaseVector3::sphericalDirection(sin_theta, std::cosf(theta), phi);
+				sin_theta = std::sin(theta);
+				*normal = -BaseVector3::sphericalDirection(sin_theta, std::cos(theta), phi);
 			}
 			else {
 				u = light_sample0.u;
@@ -119,7 +120,7 @@ namespace Aya {
 				map_pdf = UniformSpherePDF();
 
 				float theta = v * float(M_PI);
-				sin_theta = std::sinf(theta);
+				sin_theta = std::sin(theta);
 			}
 
 			Point3 center;
@@ -141,7 +142,7 @@ namespace Aya {
 				*direct_pdf = pdfW;
 
 			Vector2f diff[2] = { Vector2f(), Vector2f() };
-			return mp_map->sample(Vector2f(u, v), diff, TextureFilter::Linear) * m_scale;
+			return Spectrum(mp_map->sample(Vector2f(u, v), diff, TextureFilter::Linear), SpectrumType::Illuminant) * m_scale;
 		}
 
 		Spectrum emit(const Vector3 &dir,
@@ -158,7 +159,7 @@ namespace Aya {
 				float pdfW = 0.f;
 				if (is_texture) {
 					float map_pdf = mp_distribution->pdf(s, t);
-					float sin_theta = std::sinf(theta);
+					float sin_theta = std::sin(theta);
 					float pdfW = sin_theta != 0.f ? map_pdf * float(M_1_PI) * float(M_1_PI) * .5f / sin_theta : 0.f;
 				}
 				else {
@@ -177,7 +178,7 @@ namespace Aya {
 			}
 
 			Vector2f diff[2] = { Vector2f(), Vector2f() };
-			return mp_map->sample(Vector2f(s, t), diff, TextureFilter::Linear) * m_scale;
+			return Spectrum(mp_map->sample(Vector2f(s, t), diff, TextureFilter::Linear), SpectrumType::Illuminant) * m_scale;
 		}
 		float pdf(const Point3 &pos, const Vector3 &dir) const override {
 			if (is_texture) {
@@ -185,7 +186,7 @@ namespace Aya {
 				float theta = BaseVector3::sphericalTheta(normalized_dir);
 				float phi = BaseVector3::sphericalPhi(normalized_dir);
 				phi = applyRotation(phi);
-				float sin_theta = std::sinf(theta);
+				float sin_theta = std::sin(theta);
 				return mp_distribution->pdf(phi * float(M_1_PI) * .5f, theta * float(M_1_PI)) /
 					(2.f * float(M_PI) * float(M_PI) * sin_theta);
 			}
@@ -203,7 +204,7 @@ namespace Aya {
 			return false;
 		}
 
-		Texture2D<Spectrum>* getTexture() const {
+		Texture2D<RGBSpectrum>* getTexture() const {
 			return mp_map.get();
 		}
 		bool isTexture() const {
@@ -230,7 +231,7 @@ namespace Aya {
 			m_luminance.init(height, width);
 			for (auto y = 0; y < height; ++y) {
 				float v = (y + .5f) / float(height);
-				float sin_theta = std::sinf(float(M_PI) * v);
+				float sin_theta = std::sin(float(M_PI) * v);
 				for (auto x = 0; x < width; ++x) {
 					float u = (x + .5f) / float(width);
 					Vector2f diff[2] = {
@@ -242,7 +243,7 @@ namespace Aya {
 				}
 			}
 
-			mp_distribution = std::make_unique<Distribution2D>(m_luminance.data(), width, height);
+			mp_distribution = std::make_unique<Distribution2D>(m_luminance.data(), width, height, &BulkAllocator::scene());
 		}
 
 		inline float applyRotation(const float phi, const float scl = 1.f) const {
@@ -8,11 +8,11 @@ namespace Aya {
 	class PointLight : public Light {
 	private:
 		Point3 m_pos;
-		Spectrum m_intensity;
+		StoredSpectrum m_intensity;
 
 	public:
 		PointLight(const Point3 &pos,
-			const Spectrum &intens,
+			const StoredSpectrum &intens,
 			const uint32_t sample_count = 1) :
 			Light(sample_count), m_pos(pos), m_intensity(intens) {
 		}
@@ -35,7 +35,7 @@ namespace Aya {
 			if (emit_pdf_w)
 				*emit_pdf_w = UniformSpherePDF();
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		Spectrum sample(const Sample &light_sample0,
@@ -51,7 +51,7 @@ namespace Aya {
 			if (direct_pdf)
 				*direct_pdf = 1.f;
 
-			return m_intensity;
+			return FromStored(m_intensity, SpectrumType::Illuminant);
 		}
 
 		Spectrum emit(const Vector3 &dir,
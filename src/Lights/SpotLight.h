@@ -7,13 +7,13 @@ namespace Aya {
 	class SpotLight : public Light {
 	private:
 		Point3 m_pos;
-		Spectrum m_intensity;
+		StoredSpectrum m_intensity;
 		Frame m_dirFrame;
 		float m_cosTotal, m_cosFalloff;
 
 	public:
 		SpotLight(const Point3 &pos,
-			const Spectrum &intens,
+			const StoredSpectrum &intens,
 			const Vector3 &dir,
 			const float total,
 			const float falloff,
@@ -40,7 +40,7 @@ namespace Aya {
 			if (emit_pdf_w)
 				*emit_pdf_w = UniformConePDF(m_cosTotal);
 
-			return m_intensity * falloff(-*dir);
+			return FromStored(m_intensity, SpectrumType::Illuminant) * falloff(-*dir);
 		}
 
 		Spectrum sample(const Sample &light_sample0,
@@ -58,7 +58,7 @@ namespace Aya {
 			if (direct_pdf)
 				*direct_pdf = 1.f;
 
-			return m_intensity * falloff(ray->m_dir);
+			return FromStored(m_intensity, SpectrumType::Illuminant) * falloff(ray->m_dir);
 		}
 
 		Spectrum emit(const Vector3 &dir,
@@ -1,12 +1,97 @@
 #include <Loaders/Bitmap.h>
 
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace Aya {
+	// 64-bit file positions, long is 32 bits on Windows and large EXR files pass 2GB
+	static int SeekFile(FILE *fp, const int64_t offset) {
+#if defined(_WIN32)
+		return _fseeki64(fp, offset, SEEK_SET);
+#else
+		return fseeko(fp, offset, SEEK_SET);
+#endif
+	}
+	static int64_t TellFile(FILE *fp) {
+#if defined(_WIN32)
+		return _ftelli64(fp);
+#else
+		return ftello(fp);
+#endif
+	}
+
+#pragma pack(push, 2)
+	struct BmpFileHeader {
+		uint16_t type;
+		uint32_t size;
+		uint16_t reserved1;
+		uint16_t reserved2;
+		uint32_t off_bits;
+	};
+	struct BmpInfoHeader {
+		uint32_t size;
+		int32_t width;
+		int32_t height;
+		uint16_t planes;
+		uint16_t bit_count;
+		uint32_t compression;
+		uint32_t size_image;
+		int32_t x_pels_per_meter;
+		int32_t y_pels_per_meter;
+		uint32_t clr_used;
+		uint32_t clr_important;
+	};
+#pragma pack(pop)
+
+	static void WriteBMP(const char *name, const void *pixels, int size, int width, int height, int pixel_bytes) {
+		// bmp first part, file information
+		BmpFileHeader bmp_header;
+		bmp_header.type = 0x4d42; //Bmp
+		bmp_header.size = size // data size
+			+ sizeof(BmpFileHeader) // first section size
+			+ sizeof(BmpInfoHeader); // second section size
+
+		bmp_header.reserved1 = 0; // reserved 
+		bmp_header.reserved2 = 0; // reserved
+		bmp_header.off_bits = bmp_header.size - size;
+
+		// bmp second part, data information
+		BmpInfoHeader bmp_info;
+		bmp_info.size = sizeof(BmpInfoHeader);
+		bmp_info.width = width;
+		bmp_info.height = height;
+		bmp_info.planes = 1;
+		bmp_info.bit_count = 8 * pixel_bytes;
+		bmp_info.compression = 0;
+		bmp_info.size_image = size;
+		bmp_info.x_pels_per_meter = 0;
+		bmp_info.y_pels_per_meter = 0;
+		bmp_info.clr_used = 0;
+		bmp_info.clr_important = 0;
+
+		FILE* fp = fopen(name, "wb");
+		assert(fp);
+		if (!fp) {
+			printf("Cannot open image file: %s\n", name);
+			return;
+		}
+
+		fwrite(&bmp_header, 1, sizeof(BmpFileHeader), fp);
+		fwrite(&bmp_info, 1, sizeof(BmpInfoHeader), fp);
+		fwrite(pixels, 1, size, fp);
+		fclose(fp);
+	}
+
 	void Bitmap::save(const char *name, const float *data, int width, int height, ImageFormat format) {
 		int pixel_bytes = int(format);
 		int size = width * height * pixel_bytes;
 
-		const float inv_gamma = 1.f / 2.2f; // Gamma
-
 		unsigned char *pixels = new unsigned char[size];
 		for (int i = 0; i < height; i++) {
 			for (int j = 0; j < width; j++) {
@@ -18,54 +103,18 @@ namespace Aya {
 
 				// set alpha
 				if (format == RGBA_32)
-					pixels[idx + 3] = 255;
+					pixels[idx1 + 3] = 255;
 			}
 		}
 
-		// bmp first part, file information
-		BITMAPFILEHEADER bmp_header;
-		bmp_header.bfType = 0x4d42; //Bmp
-		bmp_header.bfSize = size // data size
-			+ sizeof(BITMAPFILEHEADER) // first section size
-			+ sizeof(BITMAPINFOHEADER); // second section size
-
-		bmp_header.bfReserved1 = 0; // reserved 
-		bmp_header.bfReserved2 = 0; // reserved
-		bmp_header.bfOffBits = bmp_header.bfSize - size;
-
-		// bmp second part, data information
-		BITMAPINFOHEADER bmp_info;
-		bmp_info.biSize = sizeof(BITMAPINFOHEADER);
-		bmp_info.biWidth = width;
-		bmp_info.biHeight = height;
-		bmp_info.biPlanes = 1;
-		bmp_info.biBitCount = 8 * pixel_bytes;
-		bmp_info.biCompression = 0;
-		bmp_info.biSizeImage = size;
-		bmp_info.biXPelsPerMeter = 0;
-		bmp_info.biYPelsPerMeter = 0;
-		bmp_info.biClrUsed = 0;
-		bmp_info.biClrImportant = 0;
-
-		FILE* fp = NULL;
-		fopen_s(&fp, name, "wb");
-		assert(fp);
-
-		fwrite(&bmp_header, 1, sizeof(BITMAPFILEHEADER), fp);
-		fwrite(&bmp_info, 1, sizeof(BITMAPINFOHEADER), fp);
-		fwrite(pixels, 1, size, fp);
-		fclose(fp);
-
-		delete pixels;
-		pixels = nullptr;
+		WriteBMP(name, pixels, size, width, height, pixel_bytes);
+		SafeDeleteArray(pixels);
 	}
 
 	void Bitmap::save(const char *name, const Byte *data, int width, int height) {
 		int pixel_bytes = 4;
 		int size = width * height * pixel_bytes;
 
-		const float inv_gamma = 1.f / 2.2f; // Gamma
-
 		short *pixels = new short[size];
 		for (int i = 0; i < height; i++) {
 			for (int j = 0; j < width; j++) {
@@ -78,42 +127,338 @@ namespace Aya {
 			}
 		}
 
-		// bmp first part, file information
-		BITMAPFILEHEADER bmp_header;
-		bmp_header.bfType = 0x4d42; //Bmp
-		bmp_header.bfSize = size // data size
-			+ sizeof(BITMAPFILEHEADER) // first section size
-			+ sizeof(BITMAPINFOHEADER); // second section size
+		WriteBMP(name, pixels, size, width, height, pixel_bytes);
+		SafeDeleteArray(pixels);
+	}
 
-		bmp_header.bfReserved1 = 0; // reserved 
-		bmp_header.bfReserved2 = 0; // reserved
-		bmp_header.bfOffBits = bmp_header.bfSize - size;
+	bool Bitmap::savePFM(const char *name, const float *data, int width, int height, ImageFormat format) {
+		FILE *fp = fopen(name, "wb");
+		if (!fp) {
+			printf("Cannot open image file: %s\n", name);
+			return false;
+		}
 
-		// bmp second part, data information
-		BITMAPINFOHEADER bmp_info;
-		bmp_info.biSize = sizeof(BITMAPINFOHEADER);
-		bmp_info.biWidth = width;
-		bmp_info.biHeight = height;
-		bmp_info.biPlanes = 1;
-		bmp_info.biBitCount = 8 * pixel_bytes;
-		bmp_info.biCompression = 0;
-		bmp_info.biSizeImage = size;
-		bmp_info.biXPelsPerMeter = 0;
-		bmp_info.biYPelsPerMeter = 0;
-		bmp_info.biClrUsed = 0;
-		bmp_info.biClrImportant = 0;
-
-		FILE* fp = NULL;
-		fopen_s(&fp, name, "wb");
-		assert(fp);
+		// Negative scale marks little endian, scanlines go from bottom to top
+		fprintf(fp, "PF\n%d %d\n-1.0\n", width, height);
 
-		fwrite(&bmp_header, 1, sizeof(BITMAPFILEHEADER), fp);
-		fwrite(&bmp_info, 1, sizeof(BITMAPINFOHEADER), fp);
-		fwrite(pixels, 1, size, fp);
+		const int channels = int(format);
+		std::vector<float> row(3 * width);
+		bool ok = true;
+		for (int i = height - 1; i >= 0 && ok; i--) {
+			for (int j = 0; j < width; j++) {
+				const float *pixel = data + size_t(channels) * (size_t(i) * width + j);
+				row[3 * j + 0] = pixel[0];
+				row[3 * j + 1] = pixel[1];
+				row[3 * j + 2] = pixel[2];
+			}
+			ok = fwrite(row.data(), sizeof(float), row.size(), fp) == row.size();
+		}
+		fclose(fp);
+
+		if (!ok)
+			printf("Failed to write image file: %s\n", name);
+		return ok;
+	}
+
+	// OpenEXR RLE scheme: split even and odd bytes, delta predict, then run length encode
+	static size_t CompressEXRRLE(const uint8_t *src, const size_t size, std::vector<uint8_t> &tmp, uint8_t *dst) {
+		tmp.resize(size);
+
+		uint8_t *t1 = tmp.data();
+		uint8_t *t2 = tmp.data() + (size + 1) / 2;
+		for (size_t i = 0; i < size; i++) {
+			if (i & 1)
+				*(t2++) = src[i];
+			else
+				*(t1++) = src[i];
+		}
+
+		int p = tmp[0];
+		for (size_t i = 1; i < size; i++) {
+			int d = int(tmp[i]) - p + (128 + 256);
+			p = tmp[i];
+			tmp[i] = uint8_t(d);
+		}
+
+		const int MIN_RUN_LENGTH = 3;
+		const int MAX_RUN_LENGTH = 127;
+
+		const uint8_t *in = tmp.data();
+		const uint8_t *in_end = tmp.data() + size;
+		const uint8_t *run_start = in;
+		const uint8_t *run_end = in + 1;
+		uint8_t *out = dst;
+
+		while (run_start < in_end) {
+			while (run_end < in_end && *run_start == *run_end && run_end - run_start - 1 < MAX_RUN_LENGTH)
+				++run_end;
+
+			if (run_end - run_start >= MIN_RUN_LENGTH) {
+				// Compressible run
+				*out++ = uint8_t((run_end - run_start) - 1);
+				*out++ = *run_start;
+				run_start = run_end;
+			}
+			else {
+				// Uncompressible run
+				while (run_end < in_end &&
+					((run_end + 1 >= in_end || *run_end != *(run_end + 1)) ||
+					(run_end + 2 >= in_end || *(run_end + 1) != *(run_end + 2))) &&
+					run_end - run_start < MAX_RUN_LENGTH)
+					++run_end;
+
+				*out++ = uint8_t(run_start - run_end);
+				while (run_start < run_end)
+					*out++ = *(run_start++);
+			}
+
+			++run_end;
+		}
+
+		return size_t(out - dst);
+	}
+
+	bool Bitmap::saveEXR(const char *name, const float *data, int width, int height, ImageFormat format,
+		EXRPixelType pixel_type, int tile_size) {
+		FILE *fp = fopen(name, "wb");
+		if (!fp) {
+			printf("Cannot open image file: %s\n", name);
+			return false;
+		}
+
+		std::vector<uint8_t> header;
+		auto putBytes = [&header](const void *p, const size_t n) {
+			header.insert(header.end(), (const uint8_t*)p, (const uint8_t*)p + n);
+		};
+		auto putInt = [&putBytes](const int32_t v) { putBytes(&v, sizeof(v)); };
+		auto putFloat = [&putBytes](const float v) { putBytes(&v, sizeof(v)); };
+		auto putString = [&putBytes](const char *str) { putBytes(str, strlen(str) + 1); };
+		auto putAttrib = [&](const char *attrib, const char *type, const int32_t size) {
+			putString(attrib);
+			putString(type);
+			putInt(size);
+		};
+
+		// Channels are sorted by name in EXR, each maps to its offset in the input pixel
+		const int channels = int(format);
+		const char *channel_names[] = { "A", "B", "G", "R" };
+		const int channel_offsets[] = { 3, 2, 1, 0 };
+		const int first_channel = channels == 4 ? 0 : 1;
+		const int channel_count = 4 - first_channel;
+		const int value_bytes = pixel_type == EXR_HALF ? 2 : 4;
+
+		const int32_t magic = 20000630;
+		const int32_t version = 2 | (tile_size > 0 ? 0x200 : 0);
+		putInt(magic);
+		putInt(version);
+
+		putAttrib("channels", "chlist", channel_count * 18 + 1);
+		for (int c = first_channel; c < 4; c++) {
+			putString(channel_names[c]);
+			putInt(int32_t(pixel_type));
+			const uint8_t linear_reserved[4] = { 0, 0, 0, 0 };
+			putBytes(linear_reserved, 4);
+			putInt(1);
+			putInt(1);
+		}
+		header.push_back(0);
+
+		putAttrib("compression", "compression", 1);
+		header.push_back(1); // RLE_COMPRESSION
+
+		putAttrib("dataWindow", "box2i", 16);
+		putInt(0); putInt(0); putInt(width - 1); putInt(height - 1);
+		putAttrib("displayWindow", "box2i", 16);
+		putInt(0); putInt(0); putInt(width - 1); putInt(height - 1);
+
+		putAttrib("lineOrder", "lineOrder", 1);
+		header.push_back(0); // INCREASING_Y
+
+		putAttrib("pixelAspectRatio", "float", 4);
+		putFloat(1.f);
+		putAttrib("screenWindowCenter", "v2f", 8);
+		putFloat(0.f); putFloat(0.f);
+		putAttrib("screenWindowWidth", "float", 4);
+		putFloat(1.f);
+
+		if (tile_size > 0) {
+			putAttrib("tiles", "tiledesc", 9);
+			putInt(tile_size);
+			putInt(tile_size);
+			header.push_back(0); // ONE_LEVEL, ROUND_DOWN
+		}
+		header.push_back(0);
+
+		// One chunk per scanline (RLE) or per tile, tiles are ordered row by row
+		const int chunk_w = tile_size > 0 ? tile_size : width;
+		const int chunk_h = tile_size > 0 ? tile_size : 1;
+		const int chunks_x = (width + chunk_w - 1) / chunk_w;
+		const int chunks_y = (height + chunk_h - 1) / chunk_h;
+		std::vector<uint64_t> offsets(size_t(chunks_x) * chunks_y);
+
+		fwrite(header.data(), 1, header.size(), fp);
+		fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp);
+
+		std::vector<uint8_t> raw(size_t(chunk_w) * chunk_h * channel_count * value_bytes);
+		std::vector<uint8_t> packed(raw.size() + raw.size() / 2 + 16);
+		std::vector<uint8_t> tmp;
+		bool ok = true;
+
+		for (int cy = 0; cy < chunks_y && ok; cy++) {
+			for (int cx = 0; cx < chunks_x && ok; cx++) {
+				const int min_x = cx * chunk_w, max_x = Min(min_x + chunk_w, width);
+				const int min_y = cy * chunk_h, max_y = Min(min_y + chunk_h, height);
+
+				// Chunk layout: for each line, for each channel, all pixels of the line
+				uint8_t *dst = raw.data();
+				for (int y = min_y; y < max_y; y++) {
+					for (int c = first_channel; c < 4; c++) {
+						for (int x = min_x; x < max_x; x++) {
+							const float val = data[size_t(channels) * (size_t(y) * width + x) + channel_offsets[c]];
+							if (pixel_type == EXR_HALF) {
+								const uint16_t h = FloatToHalf(val);
+								memcpy(dst, &h, 2);
+							}
+							else {
+								memcpy(dst, &val, 4);
+							}
+							dst += value_bytes;
+						}
+					}
+				}
+				const size_t raw_size = size_t(dst - raw.data());
+				size_t packed_size = CompressEXRRLE(raw.data(), raw_size, tmp, packed.data());
+
+				// Chunks that do not shrink are stored uncompressed
+				const uint8_t *payload = packed.data();
+				if (packed_size >= raw_size) {
+					payload = raw.data();
+					packed_size = raw_size;
+				}
+
+				const int64_t position = TellFile(fp);
+				ok = position >= 0;
+				offsets[size_t(cy) * chunks_x + cx] = uint64_t(position);
+				if (tile_size > 0) {
+					const int32_t tile_header[4] = { cx, cy, 0, 0 };
+					fwrite(tile_header, sizeof(int32_t), 4, fp);
+				}
+				else {
+					const int32_t line = min_y;
+					fwrite(&line, sizeof(int32_t), 1, fp);
+				}
+				const int32_t data_size = int32_t(packed_size);
+				fwrite(&data_size, sizeof(int32_t), 1, fp);
+				ok = fwrite(payload, 1, packed_size, fp) == packed_size && ok;
+			}
+		}
+
+		// Patch the offset table now that every chunk position is known
+		if (ok) {
+			ok = SeekFile(fp, int64_t(header.size())) == 0 &&
+				fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp) == offsets.size();
+		}
 		fclose(fp);
 
-		delete pixels;
-		pixels = nullptr;
+		if (!ok)
+			printf("Failed to write image file: %s\n", name);
+		return ok;
+	}
+
+	class AsyncImageWriter {
+	private:
+		struct Job {
+			std::string name;
+			std::vector<float> data;
+			int width, height;
+			ImageFormat format;
+		};
+
+		std::thread m_thread;
+		std::mutex m_mt;
+		std::condition_variable m_wake, m_idle;
+		std::deque<Job> m_jobs;
+		bool m_busy, m_exit;
+
+	public:
+		AsyncImageWriter() : m_busy(false), m_exit(false) {
+			m_thread = std::thread([this]() { run(); });
+		}
+		~AsyncImageWriter() {
+			{
+				std::lock_guard<std::mutex> lck(m_mt);
+				m_exit = true;
+			}
+			m_wake.notify_one();
+			m_thread.join();
+		}
+
+		static AsyncImageWriter& instance() {
+			static AsyncImageWriter writer;
+			return writer;
+		}
+
+		void push(Job &&job) {
+			{
+				std::lock_guard<std::mutex> lck(m_mt);
+				m_jobs.emplace_back(std::move(job));
+			}
+			m_wake.notify_one();
+		}
+		void wait() {
+			std::unique_lock<std::mutex> lck(m_mt);
+			m_idle.wait(lck, [this]() { return m_jobs.empty() && !m_busy; });
+		}
+
+		friend class Bitmap;
+
+	private:
+		void run() {
+			while (true) {
+				Job job;
+				{
+					std::unique_lock<std::mutex> lck(m_mt);
+					m_wake.wait(lck, [this]() { return m_exit || !m_jobs.empty(); });
+					// Pending jobs are drained before exiting
+					if (m_jobs.empty())
+						return;
+					job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+					m_busy = true;
+				}
+
+				const char *ext = strrchr(job.name.c_str(), '.');
+				if (ext && (strcmp(ext, ".pfm") == 0 || strcmp(ext, ".PFM") == 0))
+					Bitmap::savePFM(job.name.c_str(), job.data.data(), job.width, job.height, job.format);
+				else if (ext && (strcmp(ext, ".exr") == 0 || strcmp(ext, ".EXR") == 0))
+					Bitmap::saveEXR(job.name.c_str(), job.data.data(), job.width, job.height, job.format);
+				else
+					Bitmap::save(job.name.c_str(), job.data.data(), job.width, job.height, job.format);
+
+				{
+					std::lock_guard<std::mutex> lck(m_mt);
+					m_busy = false;
+				}
+				m_idle.notify_all();
+			}
+		}
+	};
+
+	void Bitmap::saveAsync(const char *name, const float *data, int width, int height, ImageFormat format) {
+		AsyncImageWriter::Job job;
+		job.name = name;
+		job.data.assign(data, data + size_t(width) * height * int(format));
+		job.width = width;
+		job.height = height;
+		job.format = format;
+		AsyncImageWriter::instance().push(std::move(job));
+	}
+	void Bitmap::waitAsync() {
+		AsyncImageWriter::instance().wait();
+	}
+
+	bool Bitmap::info(const char *name, int *width, int *height, int *channel) {
+		return stbi_info(name, width, height, channel) != 0;
 	}
 
 	template<>
@@ -173,6 +518,52 @@ namespace Aya {
 		return pixels;
 	}
 
+	template<class T>
+	static T* ReadCompact(const char *name, int *width, int *height, int *channel) {
+		printf("Reading texture: %s\n", name);
+		float *rgbs = (float*)stbi_loadf(name, width, height, channel, 4);
+
+		int size = (*width) * (*height);
+		T *pixels = new T[size];
+
+		for (int i = 0; i < size; i++) {
+			RGBSpectrum c = RGBSpectrum(rgbs[i * 4 + 0], rgbs[i * 4 + 1], rgbs[i * 4 + 2]);
+			c[3] = rgbs[i * 4 + 3];
+			pixels[i] = T(c);
+		}
+
+		SafeDeleteArray(rgbs);
+		return pixels;
+	}
+	template<>
+	halfSpectrum* Bitmap::read(const char *name, int *width, int *height, int *channel) {
+		return ReadCompact<halfSpectrum>(name, width, height, channel);
+	}
+	template<>
+	rgb9e5Spectrum* Bitmap::read(const char *name, int *width, int *height, int *channel) {
+		return ReadCompact<rgb9e5Spectrum>(name, width, height, channel);
+	}
+	template<>
+	sRGB8Spectrum* Bitmap::read(const char *name, int *width, int *height, int *channel) {
+		if (stbi_is_hdr(name))
+			return ReadCompact<sRGB8Spectrum>(name, width, height, channel);
+
+		// 8 bit images are already sRGB encoded, keep their codes as they are
+		printf("Reading texture: %s\n", name);
+		stbi_uc *data_stream = stbi_load(name, width, height, channel, 4);
+
+		int size = (*width) * (*height);
+		sRGB8Spectrum *pixels = new sRGB8Spectrum[size];
+
+		for (int i = 0; i < size; i++) {
+			pixels[i] = sRGB8Spectrum(data_stream[i * 4 + 0], data_stream[i * 4 + 1],
+				data_stream[i * 4 + 2], data_stream[i * 4 + 3]);
+		}
+
+		stbi_image_free(data_stream);
+		return pixels;
+	}
+
 	template<>
 	float* Bitmap::read(const char *name, int *width, int *height, int *channel, int required_channel) {
 		return (float*)stbi_loadf(name, width, height, channel, required_channel);
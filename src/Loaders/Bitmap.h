@@ -5,20 +5,35 @@
 #include <Core/Spectrum.h>
 #include <Core/Memory.h>
 
-#include <Windows.h>
-#include <winGDI.h>
-
 namespace Aya {
 	enum ImageFormat {
 		RGB_24 = 3,
 		RGBA_32 = 4
 	};
 
+	enum EXRPixelType {
+		EXR_HALF = 1,
+		EXR_FLOAT = 2
+	};
+
 	class Bitmap {
 	public:
 		static void save(const char *name, const float *data, int width, int height, ImageFormat format = RGBA_32);
 		static void save(const char *name, const Byte *data, int width, int height);
 
+		// Linear HDR output, rows of data are stored top to bottom like the BMP writer expects.
+		// The EXR writer uses RLE compression, tile_size = 0 writes scanlines instead of tiles
+		static bool savePFM(const char *name, const float *data, int width, int height, ImageFormat format = RGBA_32);
+		static bool saveEXR(const char *name, const float *data, int width, int height, ImageFormat format = RGBA_32,
+			EXRPixelType pixel_type = EXR_HALF, int tile_size = 0);
+
+		// Queues the image on a background I/O thread, the data is copied before returning.
+		// The encoder is picked by extension (.pfm, .exr, otherwise BMP)
+		static void saveAsync(const char *name, const float *data, int width, int height, ImageFormat format = RGBA_32);
+		static void waitAsync();
+
+		// Dimensions and channel count from the header, the pixels are not decoded
+		static bool info(const char *name, int *width, int *height, int *channel);
 		template<typename T>
 		static T* read(const char *name, int *width, int *height, int *channel);
 		template<typename T>
@@ -26,4 +41,4 @@ namespace Aya {
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
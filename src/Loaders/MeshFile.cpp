@@ -0,0 +1,166 @@
+#include <Loaders/MeshFile.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace Aya {
+	const uint32_t MeshFile::VERSION;
+	const int MeshFile::SECTION_ALIGNMENT;
+
+	static std::atomic<bool> MeshCacheEnabled(true);
+
+	static inline uint64_t AlignSection(const uint64_t offset) {
+		return (offset + MeshFile::SECTION_ALIGNMENT - 1) & ~uint64_t(MeshFile::SECTION_ALIGNMENT - 1);
+	}
+
+	std::string MeshFile::cachePath(const char *source) {
+		return std::string(source) + ".mesh";
+	}
+
+	std::shared_ptr<MeshFile> MeshFile::open(const char *source, const uint32_t options) {
+		if (!isEnabled())
+			return nullptr;
+
+		// Next to the source, or in the user cache directory when that one was read only
+		const std::string path = cachePath(source);
+		for (const std::string &candidate : { path, FallbackCachePath(path) }) {
+			std::shared_ptr<MeshFile> file = std::make_shared<MeshFile>();
+			if (candidate.empty() || !file->map(candidate.c_str(), options))
+				continue;
+
+			const Header &header = file->header();
+			uint64_t mtime, size, hash;
+			if (!FileStat(source, &mtime, &size))
+				return file;
+			if (mtime == header.source_mtime && size == header.source_size)
+				return file;
+			// Touched but possibly unchanged, e.g. by a checkout
+			if (size == header.source_size && FileHash(source, &hash) && hash == header.source_hash)
+				return file;
+		}
+
+		return nullptr;
+	}
+
+	bool MeshFile::map(const char *path, const uint32_t options) {
+		if (!m_file.open(path) || m_file.size() < sizeof(Header))
+			return false;
+
+		const size_t size = m_file.size();
+		mp_header = (const Header*)m_file.data();
+		if (memcmp(mp_header->magic, "AYMS", 4) != 0 ||
+			mp_header->version != VERSION ||
+			mp_header->vertex_bytes != sizeof(MeshVertex) ||
+			mp_header->options != options ||
+			mp_header->subset_count < 1 ||
+			mp_header->material_count < 1)
+			return false;
+
+		// Truncated files are rejected before any vertex is read
+		auto section_fits = [size](const uint64_t offset, const uint64_t bytes) {
+			return offset % SECTION_ALIGNMENT == 0 && offset <= size && bytes <= size - offset;
+		};
+		if (!section_fits(mp_header->vertex_offset, uint64_t(mp_header->vertex_count) * sizeof(MeshVertex)) ||
+			!section_fits(mp_header->index_offset, uint64_t(mp_header->triangle_count) * 3 * sizeof(uint32_t)) ||
+			!section_fits(mp_header->material_idx_offset, uint64_t(mp_header->triangle_count) * sizeof(uint32_t)) ||
+			!section_fits(mp_header->subset_offset, (2 * uint64_t(mp_header->subset_count) + 1) * sizeof(uint32_t)) ||
+			!section_fits(mp_header->name_offset, mp_header->name_bytes) ||
+			mp_header->name_bytes == 0 || names()[mp_header->name_bytes - 1] != 0)
+			return false;
+
+		// Library and material names
+		uint32_t name_count = 0;
+		for (uint64_t i = 0; i < mp_header->name_bytes; i++)
+			name_count += names()[i] == 0;
+
+		return name_count == mp_header->material_count + 1;
+	}
+
+	bool MeshFile::write(const char *source, const uint32_t options, const ObjMesh &mesh) {
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		memcpy(header.magic, "AYMS", 4);
+		header.version = VERSION;
+		header.vertex_bytes = sizeof(MeshVertex);
+		header.options = options;
+		header.vertex_count = mesh.getVertexCount();
+		header.triangle_count = mesh.getTriangleCount();
+		header.subset_count = mesh.getSubsetCount();
+		header.material_count = uint32_t(mesh.getMaterialBuff().size());
+		header.textured = mesh.isTextured();
+		if (!FileStat(source, &header.source_mtime, &header.source_size) ||
+			!FileHash(source, &header.source_hash))
+			return false;
+
+		std::string names = mesh.getMaterialLibrary();
+		names.push_back(0);
+		for (auto &mtl : mesh.getMaterialBuff()) {
+			names += mtl.name;
+			names.push_back(0);
+		}
+
+		std::vector<uint32_t> subsets(2 * header.subset_count + 1);
+		for (uint32_t i = 0; i <= header.subset_count; i++)
+			subsets[i] = mesh.getSubsetStartIdx(i);
+		for (uint32_t i = 0; i < header.subset_count; i++)
+			subsets[header.subset_count + 1 + i] = mesh.getSubsetMtlIdx(i);
+
+		const void *sections[5] = {
+			mesh.getVertexBuffer(),
+			mesh.getIndexBuffer(),
+			mesh.getMaterialIdxBuff().data(),
+			subsets.data(),
+			names.data()
+		};
+		const uint64_t bytes[5] = {
+			uint64_t(header.vertex_count) * sizeof(MeshVertex),
+			uint64_t(header.triangle_count) * 3 * sizeof(uint32_t),
+			uint64_t(header.triangle_count) * sizeof(uint32_t),
+			subsets.size() * sizeof(uint32_t),
+			names.size()
+		};
+		uint64_t *offsets[5] = {
+			&header.vertex_offset,
+			&header.index_offset,
+			&header.material_idx_offset,
+			&header.subset_offset,
+			&header.name_offset
+		};
+		uint64_t cursor = sizeof(Header);
+		for (auto i = 0; i < 5; i++) {
+			cursor = AlignSection(cursor);
+			*offsets[i] = cursor;
+			cursor += bytes[i];
+		}
+		header.name_bytes = names.size();
+
+		const std::string path = cachePath(source);
+		const std::string written_path = WriteCacheFile(path, [&](FILE *fp) {
+			bool ok = fwrite(&header, sizeof(Header), 1, fp) == 1;
+			const uint8_t zeros[SECTION_ALIGNMENT] = {};
+			uint64_t written = sizeof(Header);
+			for (auto i = 0; i < 5 && ok; i++) {
+				const size_t padding = size_t(*offsets[i] - written);
+				ok = fwrite(zeros, 1, padding, fp) == padding &&
+					fwrite(sections[i], 1, size_t(bytes[i]), fp) == size_t(bytes[i]);
+				written = *offsets[i] + bytes[i];
+			}
+			return ok;
+		});
+
+		if (written_path.empty()) {
+			printf("Cannot write mesh cache: %s\n", path.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void MeshFile::setEnabled(const bool enabled) {
+		MeshCacheEnabled = enabled;
+	}
+	bool MeshFile::isEnabled() {
+		return MeshCacheEnabled;
+	}
+}
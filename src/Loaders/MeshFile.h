@@ -0,0 +1,98 @@
+#ifndef AYA_LOADERS_MESHFILE_H
+#define AYA_LOADERS_MESHFILE_H
+
+#include <Core/Config.h>
+#include <Core/FileUtil.h>
+#include <Loaders/ObjMesh.h>
+
+#include <memory>
+#include <string>
+
+namespace Aya {
+	// Welded mesh of an OBJ file kept next to it as <source>.mesh, written on its first load.
+	// Vertices and indices are stored as TriangleMesh and the accelerator use them, so a mapped
+	// file backs both without copies. Materials are kept by name, their library is read on load.
+	// Layout: header, vertices, indices, per triangle material indices, subset starts and
+	// materials, then the library and material names. Sections are aligned to cache lines
+	class MeshFile {
+	public:
+		static const uint32_t VERSION = 1;
+		static const int SECTION_ALIGNMENT = 64;
+
+		// Load options a mesh was welded with
+		enum Options {
+			LEFT_HANDED = 1,
+			FORCE_COMPUTE_NORMAL = 2
+		};
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint32_t vertex_bytes;
+			uint32_t options;
+			uint32_t vertex_count;
+			uint32_t triangle_count;
+			uint32_t subset_count;
+			uint32_t material_count;
+			uint32_t textured;
+			uint32_t reserved;
+			uint64_t vertex_offset;
+			uint64_t index_offset;
+			uint64_t material_idx_offset;
+			uint64_t subset_offset;
+			// Zero terminated, the library first
+			uint64_t name_offset;
+			uint64_t name_bytes;
+			// Source the mesh was parsed from
+			uint64_t source_mtime;
+			uint64_t source_size;
+			uint64_t source_hash;
+		};
+
+	private:
+		MappedFile m_file;
+		const Header *mp_header;
+
+	public:
+		MeshFile() : mp_header(nullptr) {}
+
+		static std::string cachePath(const char *source);
+		// Maps the cache of a source, nullptr if it is missing, was welded with other options
+		// or the source changed since. Validated against the source like TxFile
+		static std::shared_ptr<MeshFile> open(const char *source, const uint32_t options);
+		// Written aside like TxFile, into the user cache directory when the source one is read only
+		static bool write(const char *source, const uint32_t options, const ObjMesh &mesh);
+
+		inline const Header& header() const {
+			return *mp_header;
+		}
+		inline const MeshVertex* vertices() const {
+			return (const MeshVertex*)(m_file.data() + mp_header->vertex_offset);
+		}
+		inline const uint32_t* indices() const {
+			return (const uint32_t*)(m_file.data() + mp_header->index_offset);
+		}
+		inline const uint32_t* materialIdx() const {
+			return (const uint32_t*)(m_file.data() + mp_header->material_idx_offset);
+		}
+		// subset_count + 1 starts, the last one ends the final subset
+		inline const uint32_t* subsetStartIdx() const {
+			return (const uint32_t*)(m_file.data() + mp_header->subset_offset);
+		}
+		inline const uint32_t* subsetMtlIdx() const {
+			return subsetStartIdx() + mp_header->subset_count + 1;
+		}
+		inline const char* names() const {
+			return (const char*)(m_file.data() + mp_header->name_offset);
+		}
+
+		// Disabled, OBJ files are parsed on every run and no cache is written
+		static void setEnabled(const bool enabled);
+		static bool isEnabled();
+
+	private:
+		bool map(const char *path, const uint32_t options);
+	};
+}
+
+#endif
@@ -1,201 +1,395 @@
 #include <Loaders/ObjMesh.h>
+#include <Loaders/MeshFile.h>
+#include <Core/FileUtil.h>
+
+#include <ppl.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
 
 namespace Aya {
-	void ObjMesh::parserFramework(const char *filename, std::function<void(char*, char*)> callback) {
-		int cmd_len, header_len;
-		char command[AYA_MAX_PATH], cmd_header[AYA_MAX_PATH];
-
-		FILE *fp;
-		fopen_s(&fp, filename, "rt");
-		assert(fp);
-
-#define FREAD_BUF_SIZE 131072
-		char buf[FREAD_BUF_SIZE], *p1 = buf, *p2 = buf;
-		auto getChar = [&]() -> char {
-			if (p1 == p2) {
-				p2 = (p1 = buf) + fread(buf, 1, FREAD_BUF_SIZE, fp);
-				if (p1 == p2)
-					return EOF;
-			}
-			return *p1++;
-		};
-		auto fEOF = [&]() -> bool {
-			return feof(fp) && (p1 == p2);
-		};
+	// Text is scanned straight from the mapping, every token is bounded by the end of its line
+	static AYA_FORCE_INLINE bool IsBlank(const char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+	static AYA_FORCE_INLINE const char* SkipBlanks(const char *p, const char *end) {
+		while (p < end && IsBlank(*p))
+			p++;
+		return p;
+	}
+	static AYA_FORCE_INLINE const char* TokenEnd(const char *p, const char *end) {
+		while (p < end && !IsBlank(*p))
+			p++;
+		return p;
+	}
+	static AYA_FORCE_INLINE const char* LineEnd(const char *p, const char *end) {
+		const char *eol = (const char*)memchr(p, '\n', end - p);
+		return eol ? eol : end;
+	}
 
-		while (!fEOF()) {
-			cmd_len = 0;
-
-			char c;
-			do {
-				c = getChar();
-			} while (c == '\t' || c == '\n' || c == '\r' || c == ' ');
-			do {
-				command[cmd_len++] = c;
-				c = getChar();
-			} while (c != '\n' && c != '\r' && c != EOF);
-			//while (command[cmd_len] = getChar(),
-			//	command[cmd_len] != '\n' && command[cmd_len] != EOF)
-			//	++cmd_len;
-			command[cmd_len] = 0;
-
-			// Header Part
-			header_len = 0;
-			while (command[header_len] != ' ' && command[header_len] != '\t' && header_len < cmd_len) {
-				cmd_header[header_len] = command[header_len];
-				header_len++;
-			}
-			cmd_header[header_len] = 0;
+	// Returns the parameters of a line starting with the command, nullptr otherwise
+	static AYA_FORCE_INLINE const char* MatchCommand(const char *p, const char *end, const char *command) {
+		for (; *command; p++, command++) {
+			if (p == end || *p != *command)
+				return nullptr;
+		}
+		if (p < end && !IsBlank(*p))
+			return nullptr;
+		return SkipBlanks(p, end);
+	}
 
-			// Parameter Part
-			char *cmd_para = command + header_len + 1;
-			callback(cmd_header, cmd_para);
+	template<class Func>
+	static void ForEachLine(const char *begin, const char *end, Func &&func) {
+		for (const char *line = begin; line < end;) {
+			const char *eol = LineEnd(line, end);
+			const char *p = SkipBlanks(line, eol);
+			if (p < eol && *p != '#')
+				func(p, eol);
+			line = eol + 1;
 		}
+	}
 
-		fclose(fp);
+	static AYA_FORCE_INLINE const char* ParseInt(const char *p, const char *end, int *value) {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+		if (p == end || unsigned(*p - '0') >= 10)
+			return nullptr;
+
+		int ret = 0;
+		for (; p < end && unsigned(*p - '0') < 10; p++)
+			ret = ret * 10 + (*p - '0');
+		*value = negative ? -ret : ret;
+		return p;
+	}
+
+	// Narrows a correctly rounded double to the float nearest the exact value. Rounding twice
+	// only goes wrong when the double landed on a float halfway point, the exact value may lie
+	// on either side of it. Doubles from the parser are always in the normal float range
+	static AYA_FORCE_INLINE bool DoubleToFloatExact(const double val, float *ret) {
+		uint64_t bits;
+		memcpy(&bits, &val, sizeof(double));
+		if ((bits & ((1ULL << 29) - 1)) == (1ULL << 28))
+			return false;
+		*ret = float(val);
+		return true;
 	}
-	bool ObjMesh::loadObj(const char *path, const bool force_compute_normal, const bool left_handed) {
-		std::vector<Point3> position_buff;
-		std::vector<Normal3> normal_buff;
-		std::vector<Vector2f> uv_buff;
-		int smoothing_group = force_compute_normal ? 1 : 0;
-		bool has_smooth_group = false;
-		int current_mtl = 0;
-		char mtl_filename[AYA_MAX_PATH] = { 0 };
 
-		parserFramework(path, [&](char *cmd_header, char *cmd_para) {
-			if (0 == std::strcmp(cmd_header, "#")) {
-				// Comment
+	// Decimal floats without a locale or a terminating zero. Mantissas that fit the float or
+	// double significand are scaled by an exact power of ten in one correctly rounded operation,
+	// the rest and double halfway cases go through from_chars, which rounds once to float
+	static const char* ParseFloat(const char *p, const char *end, float *value) {
+		static const float POW10F[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+		static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		const char *start = p;
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0;
+		bool truncated = false;
+		for (; p < end && unsigned(*p - '0') < 10; p++, digits++) {
+			if (mantissa < 100000000000000000ULL)
+				mantissa = mantissa * 10 + (*p - '0');
+			else {
+				exponent++;
+				truncated = true;
 			}
-			else if (0 == std::strcmp(cmd_header, "v")) {
-				// Vertex Position
-				float x, y, z;
-				sscanf_s(cmd_para, "%f %f %f", &x, &y, &z);
-				if (left_handed)
-					position_buff.emplace_back(-x, y, z);
+		}
+		if (p < end && *p == '.') {
+			for (p++; p < end && unsigned(*p - '0') < 10; p++, digits++) {
+				if (mantissa < 100000000000000000ULL) {
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
 				else
-					position_buff.emplace_back(x, y, z);
+					truncated = true;
+			}
+		}
+		if (digits == 0)
+			return nullptr;
+
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			int exp;
+			const char *exp_end = ParseInt(p + 1, end, &exp);
+			if (exp_end) {
+				exponent += Clamp(exp, -1000, 1000);
+				p = exp_end;
+			}
+		}
+
+		float ret;
+		if (mantissa == 0)
+			ret = 0.f;
+		else if (!truncated && mantissa <= (1ULL << 24) && exponent >= -10 && exponent <= 10)
+			ret = exponent < 0 ? float(mantissa) / POW10F[-exponent] : float(mantissa) * POW10F[exponent];
+		else if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22 &&
+			DoubleToFloatExact(exponent < 0 ? double(mantissa) / POW10[-exponent] : double(mantissa) * POW10[exponent], &ret)) {
+		}
+		else {
+			const std::from_chars_result result = std::from_chars(start, p, ret);
+			if (result.ec == std::errc::result_out_of_range)
+				ret = exponent > 0 ? std::numeric_limits<float>::infinity() : 0.f;
+			else if (result.ec != std::errc() || result.ptr != p)
+				return nullptr;
+		}
+
+		*value = negative ? -ret : ret;
+		return p;
+	}
+	static AYA_FORCE_INLINE const char* ParseFloats(const char *p, const char *end, float *values, const int count) {
+		for (auto i = 0; i < count; i++) {
+			p = SkipBlanks(p, end);
+			const char *next = ParseFloat(p, end, &values[i]);
+			if (next)
+				p = next;
+			else
+				values[i] = 0.f;
+		}
+		return p;
+	}
+
+	// Bounded copy of directory and file name into a fixed size path
+	static void CopyPath(char *dest, const std::string &dir, const char *name, const char *name_end) {
+		const std::string path = dir + std::string(name, name_end);
+		const size_t len = Min(path.size(), size_t(AYA_MAX_PATH - 1));
+		memcpy(dest, path.data(), len);
+		dest[len] = 0;
+	}
+	static std::string Directory(const char *path) {
+		const char *slash = strrchr(path, '/');
+		const char *back_slash = strrchr(path, '\\');
+		const char *sep = Max(slash, back_slash);
+		return sep ? std::string(path, sep + 1) : std::string();
+	}
+	static const char* TrimEnd(const char *p, const char *end) {
+		while (end > p && IsBlank(end[-1]))
+			end--;
+		return end;
+	}
+
+	// Corner of a face, 0 based indices of position, uv and normal. Negative indices in the
+	// file count back from the vertices parsed so far, they are kept against the chunk's own
+	// counts and marked relative since chunks are not aware of their bases while parsing
+	struct ObjCorner {
+		int idx[3];
+		uint8_t present;
+		uint8_t relative;
+	};
+	struct ObjFace {
+		uint32_t first_corner;
+		int corner_count;
+		// -1 until the chunk's first s line, the group of the previous chunk continues
+		int smoothing_group;
+	};
+	struct ObjChunk {
+		const char *begin, *end;
+		std::vector<Point3> positions;
+		std::vector<Normal3> normals;
+		std::vector<Vector2f> uvs;
+		std::vector<ObjCorner> corners;
+		std::vector<ObjFace> faces;
+		// usemtl lines by the face they precede
+		std::vector<std::pair<uint32_t, std::string>> materials;
+		std::string mtllib;
+		int smoothing_group;
+		bool has_smooth_group;
+		bool textured;
+
+		ObjChunk() : begin(nullptr), end(nullptr), smoothing_group(-1), has_smooth_group(false), textured(false) {}
+	};
+
+	static void ParseChunk(ObjChunk *chunk, const bool left_handed) {
+		ForEachLine(chunk->begin, chunk->end, [&](const char *p, const char *eol) {
+			const char *para;
+			float v[3];
+			if ((para = MatchCommand(p, eol, "v"))) {
+				// Vertex Position
+				ParseFloats(para, eol, v, 3);
+				chunk->positions.emplace_back(left_handed ? -v[0] : v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "vt")) {
+			else if ((para = MatchCommand(p, eol, "vt"))) {
 				// Vertex TexCoord
-				float u, v;
-				sscanf_s(cmd_para, "%f %f", &u, &v);
-				uv_buff.emplace_back(u, 1.f - v);
-				m_textured = true;
+				ParseFloats(para, eol, v, 2);
+				chunk->uvs.emplace_back(v[0], 1.f - v[1]);
+				chunk->textured = true;
 			}
-			else if (0 == std::strcmp(cmd_header, "vn")) {
+			else if ((para = MatchCommand(p, eol, "vn"))) {
 				// Vertex Normal
-				float x, y, z;
-				sscanf_s(cmd_para, "%f %f %f", &x, &y, &z);
-				if (left_handed)
-					normal_buff.emplace_back(-x, y, z);
-				else
-					normal_buff.emplace_back(x, y, z);
+				ParseFloats(para, eol, v, 3);
+				chunk->normals.emplace_back(left_handed ? -v[0] : v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "s")) {
+			else if ((para = MatchCommand(p, eol, "f"))) {
+				// Face, vertices past the fourth are dropped
+				ObjFace face;
+				face.first_corner = uint32_t(chunk->corners.size());
+				face.corner_count = 0;
+				face.smoothing_group = chunk->smoothing_group;
+
+				const int counts[3] = { int(chunk->positions.size()), int(chunk->uvs.size()), int(chunk->normals.size()) };
+				for (p = para; p < eol && face.corner_count < 4; p = SkipBlanks(p, eol)) {
+					ObjCorner corner = { { 0, 0, 0 }, 0, 0 };
+					for (auto i = 0; i < 3; i++) {
+						int idx;
+						const char *next = ParseInt(p, eol, &idx);
+						if (next) {
+							corner.idx[i] = idx < 0 ? counts[i] + idx : idx - 1;
+							corner.present |= 1 << i;
+							if (idx < 0)
+								corner.relative |= 1 << i;
+							p = next;
+						}
+						if (p == eol || *p != '/')
+							break;
+						p++;
+					}
+					p = TokenEnd(p, eol);
+
+					chunk->corners.push_back(corner);
+					face.corner_count++;
+				}
+				chunk->faces.push_back(face);
+			}
+			else if ((para = MatchCommand(p, eol, "s"))) {
 				// smoothing group for normal computation
-				if (cmd_para[0] >= '1' && cmd_para[0] <= '9') {
-					has_smooth_group = true;
-					sscanf_s(cmd_para, "%d", &smoothing_group);
+				if (para < eol && *para >= '1' && *para <= '9') {
+					chunk->has_smooth_group = true;
+					ParseInt(para, eol, &chunk->smoothing_group);
 				}
 				else
-					smoothing_group = 0;
+					chunk->smoothing_group = 0;
+			}
+			else if ((para = MatchCommand(p, eol, "usemtl"))) {
+				chunk->materials.emplace_back(uint32_t(chunk->faces.size()), std::string(para, TokenEnd(para, eol)));
 			}
-			else if (0 == std::strcmp(cmd_header, "mtllib")) {
+			else if ((para = MatchCommand(p, eol, "mtllib"))) {
 				// Material library
-				sscanf_s(cmd_para, "%s", mtl_filename, AYA_MAX_PATH);
+				chunk->mtllib.assign(para, TokenEnd(para, eol));
 			}
-			else if (0 == std::strcmp(cmd_header, "usemtl")) {
-				char name[AYA_MAX_PATH];
-				sscanf_s(cmd_para, "%s", name, AYA_MAX_PATH);
+		});
+	}
 
-				ObjMaterial mtl(name);
-				auto idx_iter = std::find(m_materials.begin(), m_materials.end(), mtl);
-				if (idx_iter == m_materials.end()) {
-					current_mtl = int(m_materials.size());
-					m_materials.push_back(mtl);
-				}
-				else {
-					current_mtl = int(idx_iter - m_materials.begin());
-				}
+	bool ObjMesh::loadObj(const char *path, const bool force_compute_normal, const bool left_handed) {
+		// Welded once, later runs map the vertices and indices and parse nothing
+		const uint32_t options = (left_handed ? MeshFile::LEFT_HANDED : 0) |
+			(force_compute_normal ? MeshFile::FORCE_COMPUTE_NORMAL : 0);
+		mp_file = MeshFile::open(path, options);
+		if (mp_file) {
+			loadCached(path);
+			return true;
+		}
 
-				m_subsetStartIdx.push_back(int(m_indices.size()));
-				m_subsetMtlIdx.push_back(current_mtl);
-				m_subsetCount++;
-			}
-			else if (0 == std::strcmp(cmd_header, "f")) {
-				// Face
-				int len = int(std::strlen(cmd_para));
+		MappedFile file;
+		if (!file.open(path)) {
+			printf("Cannot open mesh file: %s\n", path);
+			return false;
+		}
 
-				int pos_idx, uv_idx, normal_idx;
-				MeshVertex vertex;
-				MeshFace face, quad_face;
+		// Split at line starts into chunks parsed in parallel
+		const size_t CHUNK_BYTES = size_t(1) << 20;
+		const char *data = (const char*)file.data();
+		const char *data_end = data + file.size();
+		const size_t chunk_count = Max(file.size() / CHUNK_BYTES, size_t(1));
+		std::vector<ObjChunk> chunks(chunk_count);
+		const char *begin = data;
+		for (size_t i = 0; i < chunk_count; i++) {
+			const char *split = Max(data + file.size() * (i + 1) / chunk_count, begin);
+			chunks[i].begin = begin;
+			chunks[i].end = split == data_end ? data_end : Min(LineEnd(split, data_end) + 1, data_end);
+			begin = chunks[i].end;
+		}
+		concurrency::parallel_for(size_t(0), chunk_count, [&](size_t i) {
+			ParseChunk(&chunks[i], left_handed);
+		});
 
-				uint32_t face_idx[4] = { 0, 0, 0, 0 };
-				int vertex_count = 0;
-
-				int slash_count = -1;
-				bool double_slash = false;
-				auto start_idx = 0;
-				for (auto i = 0; i <= len; i++) {
-					char c = cmd_para[i];
-					if (c != ' ' && c != '\t' && c != '\n' && c != '\0')
-						continue;
-					// Move to data header
-					if (start_idx == i) {
-						start_idx++;
-						continue;
-					}
-					if (slash_count == -1) {
-						slash_count = 0;
-						for (auto cur = start_idx; cur < i; cur++) {
-							if (cmd_para[cur] == '/') {
-								if (cur - 1 >= 0 && cmd_para[cur - 1] == '/')
-									double_slash = true;
-								slash_count++;
-							}
-						}
-					}
+		// Merged in file order, which relative indices, smoothing groups and materials depend on
+		std::vector<Point3> position_buff;
+		std::vector<Normal3> normal_buff;
+		std::vector<Vector2f> uv_buff;
+		size_t position_count = 0, normal_count = 0, uv_count = 0;
+		for (auto &chunk : chunks) {
+			position_count += chunk.positions.size();
+			normal_count += chunk.normals.size();
+			uv_count += chunk.uvs.size();
+		}
+		position_buff.reserve(position_count);
+		normal_buff.reserve(normal_count);
+		uv_buff.reserve(uv_count);
+		m_vertices.reserve(position_count);
+		m_caches.resize(position_count, nullptr);
 
-					if (double_slash) {
-						sscanf_s(cmd_para + start_idx, "%d//%d", &pos_idx, &normal_idx);
-						if (pos_idx < 0) pos_idx = int(position_buff.size()) + pos_idx + 1;
-						if (normal_idx < 0) normal_idx = int(normal_buff.size()) + normal_idx + 1;
-						vertex.p = position_buff[pos_idx - 1];
-						vertex.n = normal_buff[normal_idx - 1];
+		int smoothing_group = force_compute_normal ? 1 : 0;
+		bool has_smooth_group = false;
+		int current_mtl = 0;
+		uint32_t invalid_faces = 0;
+
+		for (auto &chunk : chunks) {
+			const int bases[3] = { int(position_buff.size()), int(uv_buff.size()), int(normal_buff.size()) };
+			position_buff.insert(position_buff.end(), chunk.positions.begin(), chunk.positions.end());
+			uv_buff.insert(uv_buff.end(), chunk.uvs.begin(), chunk.uvs.end());
+			normal_buff.insert(normal_buff.end(), chunk.normals.begin(), chunk.normals.end());
+			const int counts[3] = { int(position_buff.size()), int(uv_buff.size()), int(normal_buff.size()) };
+			m_textured |= chunk.textured;
+			has_smooth_group |= chunk.has_smooth_group;
+			if (!chunk.mtllib.empty())
+				m_mtlLibrary = chunk.mtllib;
+
+			size_t next_mtl = 0;
+			for (uint32_t f = 0; f <= chunk.faces.size(); f++) {
+				for (; next_mtl < chunk.materials.size() && chunk.materials[next_mtl].first == f; next_mtl++) {
+					ObjMaterial mtl(chunk.materials[next_mtl].second.c_str());
+					auto idx_iter = std::find(m_materials.begin(), m_materials.end(), mtl);
+					if (idx_iter == m_materials.end()) {
+						current_mtl = int(m_materials.size());
+						m_materials.push_back(mtl);
 					}
 					else {
-						if (slash_count == 0) {
-							sscanf_s(cmd_para + start_idx, "%d", &pos_idx);
-							if (pos_idx < 0) pos_idx = int(position_buff.size()) + pos_idx + 1;
-							vertex.p = position_buff[pos_idx - 1];
-						}
-						else if (slash_count == 1) {
-							sscanf_s(cmd_para + start_idx, "%d/%d", &pos_idx, &uv_idx);
-							if (pos_idx < 0) pos_idx = int(position_buff.size()) + pos_idx + 1;
-							if (uv_idx < 0) uv_idx = int(uv_buff.size()) / 2 + uv_idx + 1;
-							vertex.p = position_buff[pos_idx - 1];
-							vertex.uv = uv_buff[uv_idx - 1];
-						}
-						else if (slash_count == 2) {
-							sscanf_s(cmd_para + start_idx, "%d/%d/%d", &pos_idx, &uv_idx, &normal_idx);
-							if (pos_idx < 0) pos_idx = int(position_buff.size()) + pos_idx + 1;
-							if (uv_idx < 0) uv_idx = int(uv_buff.size()) / 2 + uv_idx + 1;
-							if (normal_idx < 0) normal_idx = int(normal_buff.size()) + normal_idx + 1;
-							vertex.p = position_buff[pos_idx - 1];
-							vertex.uv = uv_buff[uv_idx - 1];
-							vertex.n = normal_buff[normal_idx - 1];
-						}
+						current_mtl = int(idx_iter - m_materials.begin());
 					}
 
-					if (vertex_count >= 4)
+					m_subsetStartIdx.push_back(int(m_indices.size()));
+					m_subsetMtlIdx.push_back(current_mtl);
+					m_subsetCount++;
+				}
+				if (f == chunk.faces.size())
+					break;
+
+				const ObjFace &obj_face = chunk.faces[f];
+				if (obj_face.smoothing_group != -1)
+					smoothing_group = obj_face.smoothing_group;
+
+				uint32_t face_idx[4] = { 0, 0, 0, 0 };
+				bool valid = obj_face.corner_count >= 3;
+				for (auto c = 0; c < obj_face.corner_count && valid; c++) {
+					const ObjCorner &corner = chunk.corners[obj_face.first_corner + c];
+					int idx[3];
+					valid = (corner.present & 1) != 0;
+					for (auto i = 0; i < 3; i++) {
+						idx[i] = corner.idx[i] + ((corner.relative >> i) & 1 ? bases[i] : 0);
+						if ((corner.present >> i) & 1)
+							valid &= idx[i] >= 0 && idx[i] < counts[i];
+					}
+					if (!valid)
 						break;
 
-					face_idx[vertex_count] = addVertex(pos_idx - 1, &vertex);
-					++vertex_count;
-					start_idx = i + 1;
+					MeshVertex vertex;
+					vertex.p = position_buff[idx[0]];
+					if (corner.present & 2)
+						vertex.uv = uv_buff[idx[1]];
+					if (corner.present & 4)
+						vertex.n = normal_buff[idx[2]];
+					face_idx[c] = addVertex(idx[0], &vertex);
+				}
+				if (!valid) {
+					invalid_faces++;
+					continue;
 				}
 
+				MeshFace face, quad_face;
 				if (left_handed) {
 					face.idx[0] = face_idx[0];
 					face.idx[1] = face_idx[2];
@@ -215,7 +409,7 @@ namespace Aya {
 				m_faces.push_back(face);
 				m_materialIdx.push_back(current_mtl);
 
-				if (vertex_count == 4) {
+				if (obj_face.corner_count == 4) {
 					// Trianglarize quad
 					if (left_handed) {
 						quad_face.idx[0] = face_idx[3];
@@ -237,10 +431,14 @@ namespace Aya {
 					m_materialIdx.push_back(current_mtl);
 				}
 			}
-			else {
-				// Ignore
-			}
-		});
+			if (chunk.smoothing_group != -1)
+				smoothing_group = chunk.smoothing_group;
+
+			// Released as soon as merged
+			chunk = ObjChunk();
+		}
+		if (invalid_faces)
+			printf("Skipped %u face(s) with out of range indices in %s\n", invalid_faces, path);
 
 		if (m_subsetCount == 0) {
 			m_subsetStartIdx.push_back(0);
@@ -265,130 +463,118 @@ namespace Aya {
 		}
 		m_caches.clear();
 
-		if (mtl_filename[0]) {
-			const char *path1 = strrchr(path, '/');
-			const char *path2 = strrchr(path, '\\');
-			if (path1 || path2) {
-				int idx = int((path1 ? path1 : path2) - path + 1);
-				char mtl_path[AYA_MAX_PATH] = { 0 };
-				strncpy_s(mtl_path, AYA_MAX_PATH, path, idx);
-				strcat(mtl_path, mtl_filename);
-				loadMtl(mtl_path);
-			}
-			else {
-				loadMtl(mtl_filename);
-			}
-		}
+		if (!m_mtlLibrary.empty())
+			loadMtl((Directory(path) + m_mtlLibrary).c_str());
 
 		if (!m_materials.size())
 			m_materials.push_back(ObjMaterial());
 
+		mp_vertexBuffer = m_vertices.data();
+		mp_indexBuffer = m_indices.data();
+		if (MeshFile::isEnabled())
+			MeshFile::write(path, options, *this);
+
 		return true;
 	}
+	void ObjMesh::loadCached(const char *path) {
+		const MeshFile::Header &header = mp_file->header();
+		m_vertexCount = header.vertex_count;
+		m_triangleCount = header.triangle_count;
+		m_subsetCount = header.subset_count;
+		m_normaled = true;
+		m_textured = header.textured != 0;
+		mp_vertexBuffer = mp_file->vertices();
+		mp_indexBuffer = mp_file->indices();
+
+		// Small tables are copied, the vertices and indices stay mapped
+		m_materialIdx.assign(mp_file->materialIdx(), mp_file->materialIdx() + m_triangleCount);
+		m_subsetStartIdx.assign(mp_file->subsetStartIdx(), mp_file->subsetStartIdx() + m_subsetCount + 1);
+		m_subsetMtlIdx.assign(mp_file->subsetMtlIdx(), mp_file->subsetMtlIdx() + m_subsetCount);
+
+		const char *name = mp_file->names();
+		m_mtlLibrary = name;
+		for (uint32_t i = 0; i < header.material_count; i++) {
+			name += strlen(name) + 1;
+			m_materials.emplace_back(name);
+		}
+
+		if (!m_mtlLibrary.empty())
+			loadMtl((Directory(path) + m_mtlLibrary).c_str());
+	}
 	void ObjMesh::loadMtl(const char *path) {
+		MappedFile file;
+		if (!file.open(path)) {
+			printf("Cannot open material library: %s\n", path);
+			return;
+		}
+
+		const std::string dir = Directory(path);
+		const char *data = (const char*)file.data();
 		int current_material = -1;
-		parserFramework(path, [this, &current_material, path](char *cmd_header, char *cmd_para) {
-			if (0 == std::strcmp(cmd_header, "#")) {
-				// Comment
-			}
-			else if (0 == std::strcmp(cmd_header, "newmtl")) {
-				// Switching active materials
-				char name[AYA_MAX_PATH];
-				sscanf_s(cmd_para, "%s", name, AYA_MAX_PATH);
-				ObjMaterial mtl(name);
-				current_material = int(std::find(m_materials.begin(), m_materials.end(), mtl) - m_materials.begin());
+		ForEachLine(data, data + file.size(), [&](const char *p, const char *eol) {
+			const char *para;
+			float v[3];
+			if ((para = MatchCommand(p, eol, "newmtl"))) {
+				// Switching active materials, ones no face uses are skipped
+				ObjMaterial mtl(std::string(para, TokenEnd(para, eol)).c_str());
+				auto idx_iter = std::find(m_materials.begin(), m_materials.end(), mtl);
+				current_material = idx_iter == m_materials.end() ? -1 : int(idx_iter - m_materials.begin());
+				return;
 			}
 
 			if (!~current_material)
 				return;
 
-			else if (0 == std::strcmp(cmd_header, "Ni")) {
+			ObjMaterial &mtl = m_materials[current_material];
+			if ((para = MatchCommand(p, eol, "Ni"))) {
 				// Refractive Index
-				float ni;
-				sscanf_s(cmd_para, "%f", &ni);
-				m_materials[current_material].Ni = ni;
+				ParseFloats(para, eol, &mtl.Ni, 1);
 			}
-			else if (0 == std::strcmp(cmd_header, "Ns")) {
+			else if ((para = MatchCommand(p, eol, "Ns"))) {
 				// Refractive Index
-				float ns;
-				sscanf_s(cmd_para, "%f", &ns);
-				m_materials[current_material].Ns = ns;
+				ParseFloats(para, eol, &mtl.Ns, 1);
 			}
-			else if (0 == std::strcmp(cmd_header, "illum")) {
-				int illum;
-				sscanf_s(cmd_para, "%d", &illum);
-				m_materials[current_material].illum = illum;
+			else if ((para = MatchCommand(p, eol, "illum"))) {
+				if (!ParseInt(para, eol, &mtl.illum))
+					mtl.illum = 0;
 			}
-			else if (0 == std::strcmp(cmd_header, "Ke")) {
+			else if ((para = MatchCommand(p, eol, "Ke"))) {
 				// Emissive color
-				float r, g, b;
-				sscanf_s(cmd_para, "%f %f %f", &r, &g, &b);
-				m_materials[current_material].Ke = RGBSpectrum(r, g, b);
+				ParseFloats(para, eol, v, 3);
+				mtl.Ke = RGBSpectrum(v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "Ka")) {
+			else if ((para = MatchCommand(p, eol, "Ka"))) {
 				// Ambient color
-				float r, g, b;
-				sscanf_s(cmd_para, "%f %f %f", &r, &g, &b);
-				m_materials[current_material].Ka = RGBSpectrum(r, g, b);
+				ParseFloats(para, eol, v, 3);
+				mtl.Ka = RGBSpectrum(v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "Kd")) {
+			else if ((para = MatchCommand(p, eol, "Kd"))) {
 				// Diffuse color
-				float r, g, b;
-				sscanf_s(cmd_para, "%f %f %f", &r, &g, &b);
-				m_materials[current_material].Kd = RGBSpectrum(r, g, b);
+				ParseFloats(para, eol, v, 3);
+				mtl.Kd = RGBSpectrum(v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "Ks")) {
+			else if ((para = MatchCommand(p, eol, "Ks"))) {
 				// Specular color
-				float r, g, b;
-				sscanf_s(cmd_para, "%f %f %f", &r, &g, &b);
-				m_materials[current_material].Ks = RGBSpectrum(r, g, b);
+				ParseFloats(para, eol, v, 3);
+				mtl.Ks = RGBSpectrum(v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "Tf")) {
+			else if ((para = MatchCommand(p, eol, "Tf"))) {
 				// Transmission color
-				float r, g, b;
-				sscanf_s(cmd_para, "%f %f %f", &r, &g, &b);
-				m_materials[current_material].Tf = RGBSpectrum(r, g, b);
+				ParseFloats(para, eol, v, 3);
+				mtl.Tf = RGBSpectrum(v[0], v[1], v[2]);
 			}
-			else if (0 == std::strcmp(cmd_header, "map_Kd")) {
+			else if ((para = MatchCommand(p, eol, "map_Kd"))) {
 				// Texture Map
-
-				const char *path1 = std::strrchr(path, '/');
-				const char *path2 = std::strrchr(path, '\\');
-
-				if (path1 || path2) {
-					int idx = int((path1 ? path1 : path2) - path + 1);
-					strncpy_s(m_materials[current_material].map_Kd, AYA_MAX_PATH, path, idx);
-				}
-				strcat_s(m_materials[current_material].map_Kd, AYA_MAX_PATH, cmd_para);
+				CopyPath(mtl.map_Kd, dir, para, TrimEnd(para, eol));
 			}
-			else if (0 == std::strcmp(cmd_header, "map_Ks")) {
+			else if ((para = MatchCommand(p, eol, "map_Ks"))) {
 				// Specular Map
-
-				const char *path1 = std::strrchr(path, '/');
-				const char *path2 = std::strrchr(path, '\\');
-
-				if (path1 || path2) {
-					int idx = int((path1 ? path1 : path2) - path + 1);
-					strncpy_s(m_materials[current_material].map_Ks, AYA_MAX_PATH, path, idx);
-				}
-				strcat_s(m_materials[current_material].map_Ks, AYA_MAX_PATH, cmd_para);
+				CopyPath(mtl.map_Ks, dir, para, TrimEnd(para, eol));
 			}
-			else if (0 == std::strcmp(cmd_header, "bump") ||
-				0 == std::strcmp(cmd_header, "map_Bump")) {
+			else if ((para = MatchCommand(p, eol, "bump")) || (para = MatchCommand(p, eol, "map_Bump"))) {
 				// Bump Map
-				if (!m_materials[current_material].map_Bump[0]) {
-					const char *path1 = std::strrchr(path, '/');
-					const char *path2 = std::strrchr(path, '\\');
-
-					if (path1 || path2) {
-						int idx = int((path1 ? path1 : path2) - path + 1);
-						strncpy_s(m_materials[current_material].map_Bump, AYA_MAX_PATH, path, idx);
-					}
-					strcat_s(m_materials[current_material].map_Bump, AYA_MAX_PATH, cmd_para);
-				}
-			}
-			else {
-				// Ignore
+				if (!mtl.map_Bump[0])
+					CopyPath(mtl.map_Bump, dir, para, TrimEnd(para, eol));
 			}
 		});
 	}
@@ -443,9 +629,9 @@ namespace Aya {
 		std::vector<Normal3> face_normal;
 		face_normal.resize(m_faces.size());
 		for (auto i = 0; i < m_faces.size(); ++i) {
-			const Point3 &p1 = getVertexAt(m_faces[i].idx[0]).p;
-			const Point3 &p2 = getVertexAt(m_faces[i].idx[1]).p;
-			const Point3 &p3 = getVertexAt(m_faces[i].idx[2]).p;
+			const Point3 &p1 = m_vertices[m_faces[i].idx[0]].p;
+			const Point3 &p2 = m_vertices[m_faces[i].idx[1]].p;
+			const Point3 &p3 = m_vertices[m_faces[i].idx[2]].p;
 
 			Vector3 v1 = p2 - p1;
 			Vector3 v2 = p3 - p1;
@@ -11,6 +11,7 @@
 #include <vector>
 #include <cstdio>
 #include <functional>
+#include <memory>
 
 #define AYA_MAX_PATH 1024
 
@@ -86,7 +87,8 @@ namespace Aya {
 			Ni(0.f),
 			Ns(0.f),
 			illum(0) {
-			strcpy_s(name, AYA_MAX_PATH, _name);
+			strncpy(name, _name, AYA_MAX_PATH - 1);
+			name[AYA_MAX_PATH - 1] = 0;
 			std::memset(map_Kd, 0, AYA_MAX_PATH);
 			std::memset(map_Bump, 0, AYA_MAX_PATH);
 			std::memset(map_Ks, 0, AYA_MAX_PATH);
@@ -97,6 +99,8 @@ namespace Aya {
 		}
 	};
 
+	class MeshFile;
+
 	class ObjMesh {
 	protected:
 		uint32_t m_vertexCount, m_triangleCount;
@@ -114,6 +118,12 @@ namespace Aya {
 
 		bool m_normaled;
 		bool m_textured;
+		std::string m_mtlLibrary;
+
+		// Welded vertices and indices, in the vectors above or in a mapped mesh cache
+		std::shared_ptr<MeshFile> mp_file;
+		const MeshVertex *mp_vertexBuffer;
+		const uint32_t *mp_indexBuffer;
 
 	public:
 		ObjMesh() :
@@ -121,7 +131,9 @@ namespace Aya {
 			m_triangleCount(0),
 			m_subsetCount(0),
 			m_normaled(false),
-			m_textured(false) {}
+			m_textured(false),
+			mp_vertexBuffer(nullptr),
+			mp_indexBuffer(nullptr) {}
 
 		bool loadObj(const char *path, const bool force_compute_normal = false, const bool left_handed = true);
 		void loadMtl(const char *path);
@@ -129,8 +141,9 @@ namespace Aya {
 		void computeVertexNormals();
 
 		inline const uint32_t* getIndexAt(int num) const {
-			return m_indices.data() + 3 * num;
+			return mp_indexBuffer + 3 * num;
 		}
+		// Faces and the vertex vector are empty when loaded from a mesh cache
 		inline const MeshFace& getFaceAt(int idx) const {
 			return m_faces[idx];
 		}
@@ -138,11 +151,21 @@ namespace Aya {
 			return m_faces;
 		}
 		inline const MeshVertex& getVertexAt(int idx) const {
-			return m_vertices[idx];
+			return mp_vertexBuffer[idx];
 		}
 		inline const std::vector<MeshVertex>& getVerticesBuff() const {
 			return m_vertices;
 		}
+		inline const MeshVertex* getVertexBuffer() const {
+			return mp_vertexBuffer;
+		}
+		inline const uint32_t* getIndexBuffer() const {
+			return mp_indexBuffer;
+		}
+		// Mesh cache the buffers are mapped from, nullptr when parsed
+		inline const std::shared_ptr<MeshFile>& getMeshFile() const {
+			return mp_file;
+		}
 		inline uint32_t getVertexCount() const {
 			return m_vertexCount;
 		}
@@ -159,6 +182,9 @@ namespace Aya {
 		inline const std::vector<ObjMaterial>& getMaterialBuff() const {
 			return m_materials;
 		}
+		inline const std::string& getMaterialLibrary() const {
+			return m_mtlLibrary;
+		}
 		inline const std::vector<uint32_t>& getMaterialIdxBuff() const {
 			return m_materialIdx;
 		}
@@ -177,7 +203,8 @@ namespace Aya {
 		}
 
 	private:
-		void parserFramework(const char *filename, std::function<void(char*, char *)> callback);
+		// Fills the mesh from the mapped cache and reads the material library again
+		void loadCached(const char *path);
 	};
 }
 
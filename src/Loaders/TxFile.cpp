@@ -0,0 +1,182 @@
+#include <Loaders/TxFile.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+namespace Aya {
+	const uint32_t TxFile::VERSION;
+	const int TxFile::TILE_ALIGNMENT;
+
+	static std::atomic<bool> TxCacheEnabled(true);
+
+	static inline uint64_t AlignTile(const uint64_t offset) {
+		return (offset + TxFile::TILE_ALIGNMENT - 1) & ~uint64_t(TxFile::TILE_ALIGNMENT - 1);
+	}
+
+	std::string TxFile::cachePath(const char *source, const char *texel) {
+		return std::string(source) + "." + texel + ".tx";
+	}
+
+	std::unique_ptr<TxFile> TxFile::open(const char *source, const char *texel, const uint32_t texel_bytes, const float gamma,
+		const uint32_t filter) {
+		if (!isEnabled())
+			return nullptr;
+
+		// Next to the source, or in the user cache directory when that one was read only
+		const std::string path = cachePath(source, texel);
+		for (const std::string &candidate : { path, FallbackCachePath(path) }) {
+			std::unique_ptr<TxFile> file = std::make_unique<TxFile>();
+			if (candidate.empty() || !file->map(candidate.c_str(), texel, texel_bytes, gamma, filter))
+				continue;
+
+			const Header &header = file->header();
+			uint64_t mtime, size, hash;
+			if (!FileStat(source, &mtime, &size))
+				return file;
+			if (mtime == header.source_mtime && size == header.source_size)
+				return file;
+			// Touched but possibly unchanged, e.g. by a checkout
+			if (size == header.source_size && FileHash(source, &hash) && hash == header.source_hash)
+				return file;
+		}
+
+		return nullptr;
+	}
+
+	bool TxFile::map(const char *path, const char *texel, const uint32_t texel_bytes, const float gamma, const uint32_t filter) {
+		if (!m_file.open(path) || m_file.size() < sizeof(Header))
+			return false;
+
+		const uint8_t *data = m_file.data();
+		const size_t size = m_file.size();
+		mp_header = (const Header*)data;
+		if (memcmp(mp_header->magic, "AYTX", 4) != 0 ||
+			mp_header->version != VERSION ||
+			strncmp(mp_header->texel, texel, sizeof(mp_header->texel)) != 0 ||
+			mp_header->texel_bytes != texel_bytes ||
+			mp_header->tile_size != uint32_t(TextureCache::TILE_SIZE) ||
+			mp_header->gamma != gamma ||
+			mp_header->filter != filter ||
+			mp_header->levels < 1 || mp_header->levels > 32)
+			return false;
+
+		const size_t table_offset = sizeof(Header) + 2 * sizeof(int32_t) * mp_header->levels;
+		if (size < table_offset + sizeof(uint64_t) * size_t(mp_header->tile_count))
+			return false;
+		mp_levelDims = (const int32_t*)(data + sizeof(Header));
+		mp_offsets = (const uint64_t*)(data + table_offset);
+
+		// Truncated files are rejected before any tile is sampled
+		const int tile_size = TextureCache::TILE_SIZE;
+		m_firstTile.resize(mp_header->levels);
+		m_tilesX.resize(mp_header->levels);
+		uint32_t tile = 0;
+		for (auto l = 0; l < mp_header->levels; l++) {
+			const Vector2i dims = levelDims(l);
+			if (dims.x < 1 || dims.y < 1)
+				return false;
+			const int tiles_x = (dims.x + tile_size - 1) / tile_size;
+			const int tiles_y = (dims.y + tile_size - 1) / tile_size;
+			m_firstTile[l] = tile;
+			m_tilesX[l] = tiles_x;
+
+			for (auto ty = 0; ty < tiles_y; ty++)
+				for (auto tx = 0; tx < tiles_x; tx++, tile++) {
+					if (tile >= mp_header->tile_count)
+						return false;
+					const uint64_t bytes = uint64_t(Min(tile_size, dims.x - tx * tile_size)) *
+						uint64_t(Min(tile_size, dims.y - ty * tile_size)) * texel_bytes;
+					if (mp_offsets[tile] % TILE_ALIGNMENT != 0 || mp_offsets[tile] + bytes > size)
+						return false;
+				}
+		}
+
+		return tile == mp_header->tile_count && levelDims(0) == Vector2i(mp_header->width, mp_header->height);
+	}
+
+	bool TxFile::write(const char *source, const char *texel, const uint32_t texel_bytes, const float gamma, const int channels,
+		const uint32_t filter, const std::vector<Vector2i> &level_dims, const std::vector<const void*> &levels) {
+		assert(level_dims.size() == levels.size() && !levels.empty());
+
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		memcpy(header.magic, "AYTX", 4);
+		header.version = VERSION;
+		strncpy(header.texel, texel, sizeof(header.texel) - 1);
+		header.texel_bytes = texel_bytes;
+		header.tile_size = TextureCache::TILE_SIZE;
+		header.width = level_dims[0].x;
+		header.height = level_dims[0].y;
+		header.levels = int32_t(levels.size());
+		header.channels = channels;
+		header.gamma = gamma;
+		header.filter = filter;
+		if (!FileStat(source, &header.source_mtime, &header.source_size) ||
+			!FileHash(source, &header.source_hash))
+			return false;
+
+		const int tile_size = TextureCache::TILE_SIZE;
+		std::vector<int32_t> dims;
+		std::vector<uint64_t> offsets;
+		uint64_t cursor = sizeof(Header) + 2 * sizeof(int32_t) * levels.size();
+		for (auto &level : level_dims) {
+			dims.push_back(level.x);
+			dims.push_back(level.y);
+			const int tiles_x = (level.x + tile_size - 1) / tile_size;
+			const int tiles_y = (level.y + tile_size - 1) / tile_size;
+			header.tile_count += tiles_x * tiles_y;
+		}
+		cursor += sizeof(uint64_t) * header.tile_count;
+		for (auto &level : level_dims) {
+			for (auto y0 = 0; y0 < level.y; y0 += tile_size)
+				for (auto x0 = 0; x0 < level.x; x0 += tile_size) {
+					cursor = AlignTile(cursor);
+					offsets.push_back(cursor);
+					cursor += uint64_t(Min(tile_size, level.x - x0)) * uint64_t(Min(tile_size, level.y - y0)) * texel_bytes;
+				}
+		}
+
+		const std::string path = cachePath(source, texel);
+		const std::string written_path = WriteCacheFile(path, [&](FILE *fp) {
+			bool ok = fwrite(&header, sizeof(Header), 1, fp) == 1 &&
+				fwrite(dims.data(), sizeof(int32_t), dims.size(), fp) == dims.size() &&
+				fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp) == offsets.size();
+
+			const uint8_t zeros[TILE_ALIGNMENT] = {};
+			uint64_t written = sizeof(Header) + sizeof(int32_t) * dims.size() + sizeof(uint64_t) * offsets.size();
+			size_t tile = 0;
+			for (size_t l = 0; l < levels.size() && ok; l++) {
+				const Vector2i &level = level_dims[l];
+				const uint8_t *texels = (const uint8_t*)levels[l];
+				for (auto y0 = 0; y0 < level.y && ok; y0 += tile_size)
+					for (auto x0 = 0; x0 < level.x && ok; x0 += tile_size, tile++) {
+						const size_t padding = size_t(offsets[tile] - written);
+						ok = fwrite(zeros, 1, padding, fp) == padding;
+
+						const int width = Min(tile_size, level.x - x0);
+						const int height = Min(tile_size, level.y - y0);
+						const size_t row_bytes = size_t(width) * texel_bytes;
+						for (auto y = 0; y < height && ok; y++)
+							ok = fwrite(texels + (size_t(y0 + y) * level.x + x0) * texel_bytes, 1, row_bytes, fp) == row_bytes;
+						written = offsets[tile] + row_bytes * height;
+					}
+			}
+			return ok;
+		});
+
+		if (written_path.empty()) {
+			printf("Cannot write texture cache: %s\n", path.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void TxFile::setEnabled(const bool enabled) {
+		TxCacheEnabled = enabled;
+	}
+	bool TxFile::isEnabled() {
+		return TxCacheEnabled;
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef AYA_LOADERS_TXFILE_H
+#define AYA_LOADERS_TXFILE_H
+
+#include <Core/Config.h>
+#include <Core/FileUtil.h>
+#include <Core/TextureCache.h>
+#include <Math/Vector2.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Aya {
+	// Pre-filtered mip chain of an image kept next to its source as <source>.<texel>.tx.
+	// Every level is cut into the tiles of the texture cache and stored in the texel
+	// format the renderer samples, so a mapped file is sampled without decoding.
+	// Layout: header, level dimensions, tile offsets, tiles aligned to cache lines
+	class TxFile {
+	public:
+		static const uint32_t VERSION = 2;
+		static const int TILE_ALIGNMENT = 64;
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			char texel[16];
+			uint32_t texel_bytes;
+			uint32_t tile_size;
+			int32_t width, height;
+			int32_t levels;
+			int32_t channels;
+			float gamma;
+			// Filter the coarser levels were reduced with
+			uint32_t filter;
+			uint32_t tile_count;
+			uint32_t reserved;
+			// Source the levels were filtered from
+			uint64_t source_mtime;
+			uint64_t source_size;
+			uint64_t source_hash;
+		};
+
+	private:
+		MappedFile m_file;
+		const Header *mp_header;
+		const int32_t *mp_levelDims;
+		const uint64_t *mp_offsets;
+		std::vector<uint32_t> m_firstTile, m_tilesX;
+
+	public:
+		TxFile() : mp_header(nullptr), mp_levelDims(nullptr), mp_offsets(nullptr) {}
+
+		static std::string cachePath(const char *source, const char *texel);
+		// Maps the cache of a source, nullptr if it is missing, was converted with other settings
+		// or the source changed since. Matching time stamp and size are trusted, otherwise the
+		// contents are hashed. Without a source the cache is used as is, it may be converted offline
+		static std::unique_ptr<TxFile> open(const char *source, const char *texel, const uint32_t texel_bytes, const float gamma,
+			const uint32_t filter);
+		// Tiles levels stored row by row and writes them as the cache of a source, into the user
+		// cache directory when the directory of the source is read only
+		static bool write(const char *source, const char *texel, const uint32_t texel_bytes, const float gamma, const int channels,
+			const uint32_t filter, const std::vector<Vector2i> &level_dims, const std::vector<const void*> &levels);
+
+		inline const Header& header() const {
+			return *mp_header;
+		}
+		inline Vector2i levelDims(const int level) const {
+			return Vector2i(mp_levelDims[2 * level], mp_levelDims[2 * level + 1]);
+		}
+		// Texels of a tile, rows are stored at the width of the tile
+		AYA_FORCE_INLINE const void* tile(const int level, const int tile_x, const int tile_y) const {
+			return m_file.data() + mp_offsets[m_firstTile[level] + tile_y * m_tilesX[level] + tile_x];
+		}
+
+		// Disabled, images are decoded on every run and no cache is written
+		static void setEnabled(const bool enabled);
+		static bool isEnabled();
+
+	private:
+		bool map(const char *path, const char *texel, const uint32_t texel_bytes, const float gamma, const uint32_t filter);
+	};
+}
+
+#endif
@@ -5,10 +5,7 @@
 #include <Core/Ray.h>
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class BBox {
+		class AYA_SIMD_ALIGN BBox {
 		public:
 			Point3 m_pmin, m_pmax;
 
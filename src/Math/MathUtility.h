@@ -6,6 +6,8 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <float.h>
+#include <stdint.h>
+#include <string.h>
 
 #if defined(AYA_DEBUG)
 #include <assert.h>
@@ -13,12 +15,10 @@
 #define assert
 #endif
 
-#ifdef _WIN32
-#if  defined(__GNUC__)
-#include <x86intrin.h> 
-#else
+#if defined(_MSC_VER)
 #include <intrin.h>
-#endif
+#else
+#include <x86intrin.h>
 #endif
 
 #define AYA_EPSILON FLT_EPSILON
@@ -122,23 +122,71 @@ namespace Aya {
 		val |= val >> 16;
 		return val + 1;
 	}
+	// 64 bit finalizer of splitmix64, scatters nearby keys over the whole range
+	AYA_FORCE_INLINE uint64_t MixBits(uint64_t v) {
+		v ^= v >> 31;
+		v *= 0x7fb5d329728ea185ULL;
+		v ^= v >> 27;
+		v *= 0x81dadef4bc2dd44dULL;
+		v ^= v >> 33;
+		return v;
+	}
+	AYA_FORCE_INLINE uint32_t PopCount(uint64_t v) {
+		v = v - ((v >> 1) & 0x5555555555555555ULL);
+		v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+		v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return uint32_t((v * 0x0101010101010101ULL) >> 56);
+	}
+	AYA_FORCE_INLINE uint32_t ReverseBits32(uint32_t v) {
+		v = (v << 16) | (v >> 16);
+		v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+		v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+		v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+		v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+		return v;
+	}
+	// Spreads the low 32 bits so that one zero bit separates each of them
+	AYA_FORCE_INLINE uint64_t LeftShift2(uint64_t v) {
+		v &= 0xffffffffULL;
+		v = (v ^ (v << 16)) & 0x0000ffff0000ffffULL;
+		v = (v ^ (v << 8)) & 0x00ff00ff00ff00ffULL;
+		v = (v ^ (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		v = (v ^ (v << 2)) & 0x3333333333333333ULL;
+		v = (v ^ (v << 1)) & 0x5555555555555555ULL;
+		return v;
+	}
+	AYA_FORCE_INLINE uint64_t EncodeMorton2(const uint32_t x, const uint32_t y) {
+		return (LeftShift2(y) << 1) | LeftShift2(x);
+	}
 	AYA_FORCE_INLINE uint32_t CountLeadingZeros(uint32_t value) {
+#if defined(_MSC_VER)
 		unsigned long log2;
 		if (_BitScanReverse(&log2, value)) return 31 - log2;
 		return 32;
+#else
+		return value ? uint32_t(__builtin_clz(value)) : 32;
+#endif
 	}
 	AYA_FORCE_INLINE uint32_t CountTrailingZeros(uint32_t value) {
 		if (value == 0) {
 			return 32;
 		}
+#if defined(_MSC_VER)
 		uint32_t bitidx; // 0-based, where the LSB is 0 and MSB is 31
 		_BitScanForward((unsigned long *)&bitidx, value);
 		return bitidx;
+#else
+		return uint32_t(__builtin_ctz(value));
+#endif
 	}
 	AYA_FORCE_INLINE uint32_t FloorLog2(uint32_t value) {
+#if defined(_MSC_VER)
 		unsigned long log2;
 		if (_BitScanReverse(&log2, value)) return log2;
 		return 0;
+#else
+		return value ? 31 - uint32_t(__builtin_clz(value)) : 0;
+#endif
 	}
 	AYA_FORCE_INLINE uint32_t CeilLog2(uint32_t value) {
 		int bitmask = ((int)(CountLeadingZeros(value) << 26)) >> 31;
@@ -158,6 +206,62 @@ namespace Aya {
 	AYA_FORCE_INLINE int RoundToInt(const float val) {
 		return _mm_cvt_ss2si(_mm_set_ss(val + val + .5f)) >> 1;
 	}
+
+	// IEEE 754 half precision conversion, round to nearest even
+	AYA_FORCE_INLINE uint16_t FloatToHalf(const float val) {
+		uint32_t bits;
+		memcpy(&bits, &val, sizeof(float));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const uint32_t abs_bits = bits & 0x7fffffff;
+
+		if (abs_bits >= 0x7f800000) // Inf or NaN, NaNs keep the top payload bits and become quiet like F16C
+			return uint16_t(sign | 0x7c00 | (abs_bits > 0x7f800000 ? 0x200 | ((abs_bits >> 13) & 0x3ff) : 0));
+		if (abs_bits >= 0x477ff000) // Overflow, rounds to Inf
+			return uint16_t(sign | 0x7c00);
+		if (abs_bits < 0x38800000) { // Subnormal or zero
+			if (abs_bits < 0x33000000)
+				return uint16_t(sign);
+			const uint32_t shift = 126 - (abs_bits >> 23);
+			const uint32_t mant = (abs_bits & 0x7fffff) | 0x800000;
+			const uint32_t rem = mant & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			uint32_t h = mant >> shift;
+			if (rem > halfway || (rem == halfway && (h & 1)))
+				h++;
+			return uint16_t(sign | h);
+		}
+
+		uint32_t h = (abs_bits - 0x38000000) >> 13;
+		const uint32_t rem = abs_bits & 0x1fff;
+		if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+			h++;
+		return uint16_t(sign | h);
+	}
+	AYA_FORCE_INLINE float HalfToFloat(const uint16_t val) {
+		const uint32_t sign = uint32_t(val & 0x8000) << 16;
+		uint32_t exp = (val >> 10) & 0x1f;
+		uint32_t mant = val & 0x3ff;
+
+		uint32_t bits;
+		if (exp == 0x1f) // Inf or NaN, NaNs become quiet like F16C
+			bits = sign | 0x7f800000 | (mant << 13) | (mant ? 0x400000 : 0);
+		else if (exp != 0)
+			bits = sign | ((exp + 112) << 23) | (mant << 13);
+		else if (mant == 0)
+			bits = sign;
+		else { // Subnormal, renormalize
+			exp = 113;
+			while (!(mant & 0x400)) {
+				mant <<= 1;
+				exp--;
+			}
+			bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+		}
+
+		float ret;
+		memcpy(&ret, &bits, sizeof(float));
+		return ret;
+	}
 }
 
 #endif
\ No newline at end of file
@@ -4,10 +4,7 @@
 #include <Math/Vector3.h>
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Matrix3x3 {
+		class AYA_SIMD_ALIGN Matrix3x3 {
 		public:
 			BaseVector3 m_el[3];
 
@@ -4,10 +4,7 @@
 #include <Math/Vector3.h>
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Matrix4x4 {
+		class AYA_SIMD_ALIGN Matrix4x4 {
 		public:
 			QuadWord m_el[4];
 
@@ -664,8 +661,9 @@ namespace Aya {
 
 				// tr((A#B)(D#C))
 				__m128 tr = _mm_mul_ps(A_B, _mm_swizzle(D_C, 0, 2, 1, 3));
-				tr = _mm_hadd_ps(tr, tr);
-				tr = _mm_hadd_ps(tr, tr);
+				// Horizontal sum with SSE2 shuffles, _mm_hadd_ps would require SSE3
+				tr = _mm_add_ps(tr, _mm_swizzle(tr, 2, 3, 0, 1));
+				tr = _mm_add_ps(tr, _mm_swizzle(tr, 1, 0, 3, 2));
 				// |M| = |A|*|D| + |B|*|C| - tr((A#B)(D#C)
 				detM = _mm_sub_ps(detM, tr);
 
@@ -11,10 +11,7 @@
 #endif
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Quaternion : public QuadWord {
+		class AYA_SIMD_ALIGN Quaternion : public QuadWord {
 #if defined(AYA_DEBUG)
 		private:
 			AYA_FORCE_INLINE void numericValid(int x) {
@@ -311,10 +308,10 @@ namespace Aya {
 				return Quaternion(A0);
 #else
 				return Quaternion(
-					w() * q.x + x() * q.w + y() * q.z - z() * q.y,
-					w() * q.y + y() * q.w + z() * q.x - x() * q.z,
-					w() * q.z + z() * q.w + x() * q.y - y() * q.x,
-					w() * q.w - x() * q.x - y() * q.y - z() * q.z);
+					w * q.x + x * q.w + y * q.z - z * q.y,
+					w * q.y + y * q.w + z * q.x - x * q.z,
+					w * q.z + z * q.w + x * q.y - y * q.x,
+					w * q.w - x * q.x - y * q.y - z * q.z);
 #endif
 			}
 			AYA_FORCE_INLINE Quaternion& operator *= (const Quaternion & q) {
@@ -380,10 +377,10 @@ namespace Aya {
 				return Quaternion(A1);
 #else
 				return Quaternion(
-					w() * v.x + y() * v.z - z() * v.y,
-					w() * v.y + z() * v.x - x() * v.z,
-					w() * v.z + x() * v.y - y() * v.x,
-					-x() * v.x - y() * v.y - z() * v.z);
+					w * v.x + y * v.z - z * v.y,
+					w * v.y + z * v.x - x * v.z,
+					w * v.z + x * v.y - y * v.x,
+					-x * v.x - y * v.y - z * v.z);
 #endif
 			}
 			friend AYA_FORCE_INLINE Quaternion operator * (const BaseVector3 &w, const Quaternion& q) {
@@ -2,17 +2,14 @@
 #define AYA_MATH_TRANSFORM_H
 
 #include <Math/BBox.h>
-#include <Math/Mathutility.h>
+#include <Math/MathUtility.h>
 #include <Math/Matrix4x4.h>
 #include <Math/Matrix3x3.h>
 #include <Math/Quaternion.h>
 #include <Core/Ray.h>
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class AffineTransform {
+		class AYA_SIMD_ALIGN AffineTransform {
 		public:
 			Matrix3x3 m_mat, m_inv;
 			Vector3 m_trans;
@@ -331,10 +328,7 @@ namespace Aya {
 			}
 	};
 
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Transform {
+		class AYA_SIMD_ALIGN Transform {
 		public:
 			Matrix4x4 m_mat, m_inv;
 
@@ -396,6 +390,9 @@ namespace Aya {
 			AYA_FORCE_INLINE Transform inverse() const {
 				return Transform(m_inv, m_mat);
 			}
+			AYA_FORCE_INLINE bool isIdentity() const {
+				return m_mat == Matrix4x4().getIdentity();
+			}
 
 			AYA_FORCE_INLINE Transform operator * (const Transform &t) const {
 				return Transform(m_mat * t.m_mat, t.m_inv * m_inv);
@@ -644,7 +641,7 @@ namespace Aya {
 								0, 0, 1, 0);
 				
 				// Scale canonical perspective view to specified field of vie
-				float invTanAng = 1.f / std::tanf(Radian(fFov) / 2.f);
+				float invTanAng = 1.f / std::tan(Radian(fFov) / 2.f);
 				return Transform().setScale(invTanAng / fRatio, invTanAng, 1.f)
 					* Transform(persp);
 			}
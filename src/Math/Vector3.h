@@ -45,10 +45,7 @@
 #endif
 
 namespace Aya {
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class QuadWord {
+		class AYA_SIMD_ALIGN QuadWord {
 #if defined(AYA_USE_SIMD)
 		public:
 			union {
@@ -67,8 +64,12 @@ namespace Aya {
 			}
 #else
 		public:
-
-			float m_val[4];
+			union {
+				struct {
+					float x, y, z, w;
+				};
+				float m_val[4];
+			};
 
 			AYA_FORCE_INLINE const __m128& get128() const {
 				return *((const __m128*)&m_val[0]);
@@ -78,10 +79,15 @@ namespace Aya {
 		public:
 			QuadWord() {}
 			AYA_FORCE_INLINE QuadWord(const float &x, const float &y, const float &z, const float &w) {
+#if defined(AYA_USE_SIMD)
+				// Built in a register, per lane stores followed by a vector load stall store forwarding
+				m_val128 = _mm_setr_ps(x, y, z, w);
+#else
 				m_val[0] = x;
 				m_val[1] = y;
 				m_val[2] = z;
 				m_val[3] = w;
+#endif
 			}
 
 #if defined(AYA_USE_SIMD)
@@ -126,10 +132,7 @@ namespace Aya {
 			}
 	};
 
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class BaseVector3 : public QuadWord {
+		class AYA_SIMD_ALIGN BaseVector3 : public QuadWord {
 #if defined(AYA_DEBUG)
 		private:
 			AYA_FORCE_INLINE void numericValid(int x) {
@@ -142,17 +145,25 @@ namespace Aya {
 		public:
 			BaseVector3() {}
 			AYA_FORCE_INLINE BaseVector3(const float &x, const float &y, const float &z) {
+#if defined(AYA_USE_SIMD)
+				m_val128 = _mm_setr_ps(x, y, z, 0.f);
+#else
 				m_val[0] = x;
 				m_val[1] = y;
 				m_val[2] = z;
 				m_val[3] = .0f;
+#endif
 				numericValid(1);
 			}
 			AYA_FORCE_INLINE BaseVector3(const float &val) {
+#if defined(AYA_USE_SIMD)
+				m_val128 = _mm_setr_ps(val, val, val, 0.f);
+#else
 				m_val[0] = val;
 				m_val[1] = val;
 				m_val[2] = val;
 				m_val[3] = .0f;
+#endif
 				numericValid(1);
 			}
 
@@ -434,23 +445,23 @@ namespace Aya {
 			}
 
 			static AYA_FORCE_INLINE BaseVector3 sphericalDirection(float sin_theta, float cos_theta, float phi) {
-				return BaseVector3(sin_theta * std::cosf(phi),
+				return BaseVector3(sin_theta * std::cos(phi),
 					cos_theta,
-					sin_theta * std::sinf(phi));
+					sin_theta * std::sin(phi));
 			}
 			static AYA_FORCE_INLINE BaseVector3 sphericalDirection(float sin_theta, float cos_theta,
 				float phi, const BaseVector3& vX,
 				const BaseVector3& vY, const BaseVector3& vZ)
 			{
-				return sin_theta * std::cosf(phi) * vX +
+				return sin_theta * std::cos(phi) * vX +
 					cos_theta * vY + 
-					sin_theta * std::sinf(phi) * vZ;
+					sin_theta * std::sin(phi) * vZ;
 			}
 			static AYA_FORCE_INLINE float sphericalTheta(const BaseVector3& v) {
-				return std::acosf(Clamp(v.y, -1.f, 1.f));
+				return std::acos(Clamp(v.y, -1.f, 1.f));
 			}
 			static AYA_FORCE_INLINE float sphericalPhi(const BaseVector3& v) {
-				float p = std::atan2f(v.z, v.x);
+				float p = std::atan2(v.z, v.x);
 				return (p < 0.f) ? p + float(M_PI) * 2.f : p;
 			}
 			static AYA_FORCE_INLINE void coordinateSystem(const BaseVector3 &x, BaseVector3 *y, BaseVector3 *z) {
@@ -474,10 +485,7 @@ namespace Aya {
 			}
 	};
 
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Vector3 : public BaseVector3 {
+		class AYA_SIMD_ALIGN Vector3 : public BaseVector3 {
 		public:
 			Vector3() {}
 			AYA_FORCE_INLINE Vector3(const float &x, const float &y, const float &z) {
@@ -522,10 +530,7 @@ namespace Aya {
 #endif
 	};
 
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Point3 : public BaseVector3 {
+		class AYA_SIMD_ALIGN Point3 : public BaseVector3 {
 		public:
 			Point3() {}
 			AYA_FORCE_INLINE Point3(const float &x, const float &y, const float &z) {
@@ -570,10 +575,7 @@ namespace Aya {
 #endif
 	};
 
-#if defined(AYA_USE_SIMD)
-	__declspec(align(16))
-#endif
-		class Normal3 : public BaseVector3 {
+		class AYA_SIMD_ALIGN Normal3 : public BaseVector3 {
 		public:
 			Normal3() {}
 			AYA_FORCE_INLINE Normal3(const float &x, const float &y, const float &z) {
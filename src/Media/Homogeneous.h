@@ -6,9 +6,9 @@
 namespace Aya {
 	class HomogeneousMedium : public Medium {
 	private:
-		const Spectrum m_sigmaA, m_sigmaS, m_sigmaT;
+		const StoredSpectrum m_sigmaA, m_sigmaS, m_sigmaT;
 	public:
-		HomogeneousMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, const float g)
+		HomogeneousMedium(const StoredSpectrum &sigma_a, const StoredSpectrum &sigma_s, const float g)
 			: m_sigmaA(sigma_a),
 			m_sigmaS(sigma_s),
 			m_sigmaT(sigma_s + sigma_a),
@@ -14,23 +14,56 @@ namespace Aya {
 		samples->lens_v = rng.drand48();
 		samples->time = rng.drand48();
 	}
-	void RandomSampler::startPixel(const int pixel_x, const int pixel_y) {}
+	void RandomSampler::advanceSampleIndex() {
+		m_sampleIdx++;
+	}
+	void RandomSampler::startPixel(const int pixel_x, const int pixel_y) {
+		m_pixelX = pixel_x;
+		m_pixelY = pixel_y;
+		startStream(0);
+	}
+	void RandomSampler::startStream(const int stream) {
+		rng.srand(m_seed ^ HashSeed(m_pixelX, m_pixelY, m_sampleIdx, SeedPurpose::SamplerStream, stream));
+	}
 	float RandomSampler::get1D() {
 		return rng.drand48();
 	}
 	Vector2f RandomSampler::get2D() {
-		return Vector2f(rng.drand48(), rng.drand48());
+		float values[2];
+		rng.fill(values, 2);
+		return Vector2f(values[0], values[1]);
 	}
 	Sample RandomSampler::getSample() {
-		return Sample(rng);
+		float values[3];
+		rng.fill(values, 3);
+
+		Sample ret;
+		ret.u = values[0];
+		ret.v = values[1];
+		ret.w = values[2];
+		return ret;
+	}
+	void RandomSampler::get1DArray(float *values, const int count) {
+		rng.fill(values, count);
 	}
 
 	std::unique_ptr<Sampler> RandomSampler::clone(const int seed) const {
-		return std::make_unique<RandomSampler>(seed);
+		std::unique_ptr<RandomSampler> copy = std::make_unique<RandomSampler>();
+		copy->reset(this, seed);
+		return std::move(copy);
 	}
 	std::unique_ptr<Sampler> RandomSampler::deepClone() const {
 		RandomSampler *copy = new RandomSampler();
 		memcpy_s(copy, sizeof(RandomSampler), this, sizeof(RandomSampler));
 		return std::unique_ptr<RandomSampler>(copy);
 	}
+	void RandomSampler::reset(const Sampler *source, const int seed) {
+		// Streams follow the seed and pass of the source, the clone seed only
+		// covers draws made before the first startPixel
+		const RandomSampler *random = static_cast<const RandomSampler*>(source);
+		rng.srand(seed);
+		m_seed = random->m_seed;
+		m_sampleIdx = random->m_sampleIdx;
+		m_pixelX = m_pixelY = 0;
+	}
 }
\ No newline at end of file
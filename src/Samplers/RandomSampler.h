@@ -6,11 +6,14 @@
 namespace Aya {
 	class RandomSampler : public Sampler {
 	private:
-		RNG rng;
+		BatchRNG rng;
+		uint64_t m_seed;
+		uint64_t m_sampleIdx;
+		int m_pixelX, m_pixelY;
 
 	public:
-		RandomSampler() = default;
-		RandomSampler(const uint64_t seed) : rng(seed) {}
+		RandomSampler() : m_seed(0), m_sampleIdx(0), m_pixelX(0), m_pixelY(0) {}
+		RandomSampler(const uint64_t seed) : rng(seed), m_seed(seed), m_sampleIdx(0), m_pixelX(0), m_pixelY(0) {}
 
 		void generateSamples(
 			const int pixel_x,
@@ -18,14 +21,18 @@ namespace Aya {
 			CameraSample *samples,
 			RNG &rng
 		) override;
+		void advanceSampleIndex() override;
 
 		void startPixel(const int pixel_x, const int pixel_y) override;
+		void startStream(const int stream) override;
 		float get1D() override;
 		Vector2f get2D() override;
 		Sample getSample() override;
+		void get1DArray(float *values, const int count) override;
 
 		std::unique_ptr<Sampler> clone(const int seed) const override;
 		std::unique_ptr<Sampler> deepClone() const override;
+		void reset(const Sampler *source, const int seed) override;
 	};
 }
 #endif
\ No newline at end of file
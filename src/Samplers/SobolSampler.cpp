@@ -1,6 +1,33 @@
 #include <Samplers/SobolSampler.h>
 
+#include <vector>
+
 namespace Aya {
+	// Generator matrix columns transposed, one index bit then XORs a contiguous run of dimensions
+	static const uint32_t* TransposedSobolMatrices() {
+		static const std::vector<uint32_t> transposed = []() {
+			std::vector<uint32_t> columns(size_t(sobol_matrix_size) * num_sobol_dimensions);
+			for (int c = 0; c < sobol_matrix_size; c++)
+				for (int dim = 0; dim < num_sobol_dimensions; dim++)
+					columns[c * num_sobol_dimensions + dim] = sobol_matrices32[dim * sobol_matrix_size + sobol_matrix_size - 1 - c];
+			return columns;
+		}();
+		return transposed.data();
+	}
+
+	static AYA_FORCE_INLINE void XorBatch(uint32_t *v, const uint32_t *column, const uint32_t count) {
+#if defined(AYA_USE_SIMD)
+		for (uint32_t i = 0; i < count; i += 4) {
+			__m128i lanes = _mm_loadu_si128((const __m128i*)(v + i));
+			lanes = _mm_xor_si128(lanes, _mm_loadu_si128((const __m128i*)(column + i)));
+			_mm_storeu_si128((__m128i*)(v + i), lanes);
+		}
+#else
+		for (uint32_t i = 0; i < count; i++)
+			v[i] ^= column[i];
+#endif
+	}
+
 	void SobolSampler::generateSamples(
 		const int pixel_x,
 		const int pixel_y,
@@ -17,11 +44,15 @@ namespace Aya {
 
 	void SobolSampler::advanceSampleIndex() {
 		m_sampleIdx++;
+		updateSampleDelta();
 	}
 	void SobolSampler::startPixel(const int px, const int py) {
 		m_sobolIdx = enumerateSampleIndex(px, py);
 		m_dim = 0;
 	}
+	void SobolSampler::startStream(const int stream) {
+		m_dim = stream * STREAM_DIMENSIONS;
+	}
 
 	float SobolSampler::get1D() {
 		return sobolSample(m_dim++);
@@ -55,24 +86,48 @@ namespace Aya {
 		memcpy_s(copy, sizeof(SobolSampler), this, sizeof(SobolSampler));
 		return std::unique_ptr<SobolSampler>(copy);
 	}
+	void SobolSampler::reset(const Sampler *source, const int seed) {
+		const SobolSampler *sobol = static_cast<const SobolSampler*>(source);
+		m_res = sobol->m_res;
+		m_log2Res = sobol->m_log2Res;
+		m_sampleIdx = sobol->m_sampleIdx;
+		m_sampleDelta = sobol->m_sampleDelta;
+		m_sobolIdx = 0;
+		m_dim = 0;
 
-	uint64_t SobolSampler::enumerateSampleIndex(const uint32_t px, const uint32_t py) const {
-		if (m_log2Res == 0) {
-			return 0;
+		// Cached batches are keyed by index and stay valid unless the scramble changes
+		if (m_scramble != sobol->m_scramble) {
+			m_scramble = sobol->m_scramble;
+			invalidateBatches();
 		}
+	}
 
-		const uint32_t m2 = m_log2Res << 1;
-		uint64_t idx = m_sampleIdx;
-		uint64_t idx2 = idx << m2;
+	void SobolSampler::updateSampleDelta() {
+		m_sampleDelta = 0;
+		if (m_log2Res == 0)
+			return;
 
-		uint64_t delta = 0;
+		uint64_t idx = m_sampleIdx;
 		for (int c = 0; idx; idx >>= 1, c++) {
 			if (idx & 1)  // Add flipped column m + c + 1.
-				delta ^= VdC_sobol_matrices[m_log2Res - 1][c];
+				m_sampleDelta ^= VdC_sobol_matrices[m_log2Res - 1][c];
 		}
+	}
+	void SobolSampler::invalidateBatches() {
+		for (auto &idx : m_batchIdx)
+			idx = INVALID_INDEX;
+	}
+
+	uint64_t SobolSampler::enumerateSampleIndex(const uint32_t px, const uint32_t py) const {
+		if (m_log2Res == 0) {
+			return 0;
+		}
+
+		const uint32_t m2 = m_log2Res << 1;
+		uint64_t idx2 = m_sampleIdx << m2;
 
 		// Flipped b
-		uint64_t b = (((uint64_t)px << m_log2Res) | py) ^ delta;
+		uint64_t b = (((uint64_t)px << m_log2Res) | py) ^ m_sampleDelta;
 
 		for (int c = 0; b; b >>= 1, c++) {
 			if (b & 1)  // Add column 2 * m - c.
@@ -82,19 +137,44 @@ namespace Aya {
 		return idx2;
 	}
 
-	float SobolSampler::sobolSample(const int dimension) const {
-		if (dimension < num_sobol_dimensions) {
-			uint64_t v = m_scramble;
-			uint64_t idx = m_sobolIdx;
-			for (int i = dimension * sobol_matrix_size + sobol_matrix_size - 1; idx != 0; idx >>= 1, i--) {
-				if (idx & 1)
-					v ^= sobol_matrices32[i];
-			}
+	void SobolSampler::generateBatch(const uint32_t batch) {
+		uint32_t *v = &m_batches[batch * BATCH_DIMENSIONS];
 
-			return v * 2.3283064365386963e-10f; /* 1 / 2^32 */
+		// Gray code style update, only the bits that differ from the cached index are applied
+		uint64_t bits = m_sobolIdx;
+		const uint64_t cached = m_batchIdx[batch];
+		if (cached != INVALID_INDEX && PopCount(cached ^ m_sobolIdx) < PopCount(m_sobolIdx)) {
+			bits = cached ^ m_sobolIdx;
 		}
 		else {
-			return rng.drand48();
+			for (uint32_t i = 0; i < BATCH_DIMENSIONS; i++)
+				v[i] = uint32_t(m_scramble);
+		}
+
+		const uint32_t *column = TransposedSobolMatrices() + batch * BATCH_DIMENSIONS;
+		for (int c = 0; bits && c < sobol_matrix_size; bits >>= 1, c++, column += num_sobol_dimensions) {
+			if (bits & 1)
+				XorBatch(v, column, BATCH_DIMENSIONS);
 		}
+
+		m_batchIdx[batch] = m_sobolIdx;
+	}
+
+	float SobolSampler::sobolSample(const uint32_t dimension) {
+		if (dimension >= num_sobol_dimensions)
+			return paddedSample(dimension);
+
+		const uint32_t batch = dimension / BATCH_DIMENSIONS;
+		if (m_batchIdx[batch] != m_sobolIdx)
+			generateBatch(batch);
+
+		return Min(FLOAT_ONE_MINUS_EPSILON, m_batches[dimension] * 2.3283064365386963e-10f); /* 1 / 2^32 */
+	}
+
+	float SobolSampler::paddedSample(const uint32_t dimension) const {
+		// Dimensions past the matrices are hashed from the sample index,
+		// deterministic for a (pixel, sample, dimension) unlike a shared generator
+		const uint64_t hash = MixBits(MixBits(m_sobolIdx ^ m_scramble) + dimension);
+		return Min(FLOAT_ONE_MINUS_EPSILON, uint32_t(hash >> 32) * 2.3283064365386963e-10f);
 	}
-}
\ No newline at end of file
+}
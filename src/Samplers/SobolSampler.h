@@ -7,12 +7,25 @@
 namespace Aya {
 	class SobolSampler : public Sampler {
 	private:
+		// Dimensions reserved for each stream of a pixel
+		static const uint32_t STREAM_DIMENSIONS = num_sobol_dimensions / 4;
+		// Dimensions generated together by one batch of vector XORs
+		static const uint32_t BATCH_DIMENSIONS = 16;
+		static const uint32_t BATCH_COUNT = num_sobol_dimensions / BATCH_DIMENSIONS;
+		static const uint64_t INVALID_INDEX = ~0ULL;
+
 		int m_res, m_log2Res;
 		uint64_t m_sampleIdx, m_sobolIdx;
 		uint32_t m_dim;
 		uint64_t m_scramble;
 
-		mutable RNG rng;
+		// Pixel independent part of the index enumeration, changes once per pass
+		uint64_t m_sampleDelta;
+
+		// Last generated batch of every dimension block and the index it was generated for,
+		// the next index is reached by XORing only the columns of the differing bits
+		ATTRIBUTE_ALIGNED64(uint32_t m_batches[num_sobol_dimensions]);
+		uint64_t m_batchIdx[BATCH_COUNT];
 
 	public:
 		SobolSampler() = default;
@@ -21,10 +34,15 @@ namespace Aya {
 			m_res = RoundUpToPowerOfTwo(Max(rx, ry));
 			m_log2Res = FloorLog2(m_res);
 			assert(m_res == 1 << m_log2Res);
+			updateSampleDelta();
+			invalidateBatches();
 		}
 		SobolSampler(const int res, const int log2_res, const uint64_t scramble, const uint64_t sample_idx) :
 			m_sampleIdx(sample_idx), m_res(res), m_log2Res(log2_res), m_scramble(scramble),
-			m_sobolIdx(0), m_dim(0) {}
+			m_sobolIdx(0), m_dim(0) {
+			updateSampleDelta();
+			invalidateBatches();
+		}
 
 		void generateSamples(
 			const int pixel_x,
@@ -35,16 +53,22 @@ namespace Aya {
 		void advanceSampleIndex() override;
 
 		void startPixel(const int pixel_x, const int pixel_y) override;
+		void startStream(const int stream) override;
 		float get1D() override;
 		Vector2f get2D() override;
 		Sample getSample() override;
 
 		std::unique_ptr<Sampler> clone(const int seed) const override;
 		std::unique_ptr<Sampler> deepClone() const override;
+		void reset(const Sampler *source, const int seed) override;
 
 	private:
+		void updateSampleDelta();
+		void invalidateBatches();
 		uint64_t enumerateSampleIndex(const uint32_t pixel_x, const uint32_t pixel_y) const;
-		float sobolSample(const int dim) const;
+		void generateBatch(const uint32_t batch);
+		float sobolSample(const uint32_t dim);
+		float paddedSample(const uint32_t dim) const;
 	};
 }
-#endif
\ No newline at end of file
+#endif
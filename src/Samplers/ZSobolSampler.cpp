@@ -0,0 +1,150 @@
+#include <Samplers/ZSobolSampler.h>
+
+namespace Aya {
+	// All 24 orderings of a base 4 digit
+	static const uint8_t DIGIT_PERMUTATIONS[24][4] = {
+		{0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 2, 1}, {0, 3, 1, 2},
+		{1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 2, 0}, {1, 3, 0, 2},
+		{2, 1, 0, 3}, {2, 1, 3, 0}, {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 3, 0, 1}, {2, 3, 1, 0},
+		{3, 1, 2, 0}, {3, 1, 0, 2}, {3, 2, 1, 0}, {3, 2, 0, 1}, {3, 0, 2, 1}, {3, 0, 1, 2}
+	};
+
+	// Hash based nested uniform scramble (Laine and Karras 2011), every bit is flipped
+	// by a function of the bits above it only, which keeps the point set stratified
+	static AYA_FORCE_INLINE uint32_t FastOwenScramble(uint32_t v, const uint32_t seed) {
+		v = ReverseBits32(v);
+		v ^= v * 0x3d20adea;
+		v += seed;
+		v *= (seed >> 16) | 1;
+		v ^= v * 0x05526c56;
+		v ^= v * 0x53a22864;
+		return ReverseBits32(v);
+	}
+
+	ZSobolSampler::ZSobolSampler(const int rx, const int ry, const int spp, const uint64_t seed) :
+		m_seed(seed), m_sampleIdx(0), m_mortonIdx(0), m_dim(0) {
+		m_log2Spp = CeilLog2(uint32_t(Max(spp, 1)));
+		const int log2_res = CeilLog2(uint32_t(Max(rx, ry)));
+		m_base4Digits = (2 * log2_res + m_log2Spp + 1) / 2;
+		assert(2 * m_base4Digits <= sobol_matrix_size);
+		updatePassSeed();
+	}
+
+	void ZSobolSampler::generateSamples(
+		const int pixel_x,
+		const int pixel_y,
+		CameraSample *samples,
+		RNG &rng) {
+		assert(samples);
+
+		const Vector2f image = get2D();
+		const Vector2f lens = get2D();
+		samples->image_x = image.x;
+		samples->image_y = image.y;
+		samples->lens_u = lens.x;
+		samples->lens_v = lens.y;
+		samples->time = get1D();
+	}
+
+	void ZSobolSampler::advanceSampleIndex() {
+		m_sampleIdx++;
+		updatePassSeed();
+	}
+	void ZSobolSampler::startPixel(const int px, const int py) {
+		const uint64_t sample = m_sampleIdx & ((1ULL << m_log2Spp) - 1);
+		m_mortonIdx = (EncodeMorton2(uint32_t(px), uint32_t(py)) << m_log2Spp) | sample;
+		m_dim = 0;
+	}
+	void ZSobolSampler::startStream(const int stream) {
+		m_dim = stream * STREAM_DIMENSIONS;
+	}
+
+	float ZSobolSampler::get1D() {
+		const uint64_t idx = permutedSampleIndex(m_dim);
+		const uint64_t hash = MixBits(m_passSeed ^ m_dim);
+		m_dim++;
+
+		return scrambledSample(idx, 0, uint32_t(hash));
+	}
+	Vector2f ZSobolSampler::get2D() {
+		const uint64_t idx = permutedSampleIndex(m_dim);
+		const uint64_t hash = MixBits(m_passSeed ^ m_dim);
+		m_dim += 2;
+
+		return Vector2f(
+			scrambledSample(idx, 0, uint32_t(hash)),
+			scrambledSample(idx, 1, uint32_t(hash >> 32))
+		);
+	}
+	Sample ZSobolSampler::getSample() {
+		const Vector2f uv = get2D();
+		Sample ret;
+		ret.u = uv.x;
+		ret.v = uv.y;
+		ret.w = get1D();
+
+		return ret;
+	}
+
+	std::unique_ptr<Sampler> ZSobolSampler::clone(const int seed) const {
+		ZSobolSampler *copy = new ZSobolSampler();
+		copy->reset(this, seed);
+		return std::unique_ptr<ZSobolSampler>(copy);
+	}
+	std::unique_ptr<Sampler> ZSobolSampler::deepClone() const {
+		return std::make_unique<ZSobolSampler>(*this);
+	}
+	void ZSobolSampler::reset(const Sampler *source, const int seed) {
+		// The sequence is a function of (pixel, sample, dimension), the clone seed is not needed
+		const ZSobolSampler *zsobol = static_cast<const ZSobolSampler*>(source);
+		m_seed = zsobol->m_seed;
+		m_log2Spp = zsobol->m_log2Spp;
+		m_base4Digits = zsobol->m_base4Digits;
+		m_sampleIdx = zsobol->m_sampleIdx;
+		m_passSeed = zsobol->m_passSeed;
+		m_mortonIdx = 0;
+		m_dim = 0;
+	}
+
+	void ZSobolSampler::updatePassSeed() {
+		// Only 2^log2Spp samples per pixel fit below the Morton code, further passes
+		// reuse the same indices under an independent scramble
+		m_passSeed = MixBits(m_seed + (m_sampleIdx >> m_log2Spp));
+	}
+
+	uint64_t ZSobolSampler::permutedSampleIndex(const uint32_t dim) const {
+		// Randomly permute every base 4 digit of the Morton index, the permutation
+		// depends on the digits above it so pixels sharing a prefix still differ
+		const uint64_t dim_hash = 0x55555555ULL * dim;
+		const bool pow2_samples = (m_log2Spp & 1) != 0;
+		const int last_digit = pow2_samples ? 1 : 0;
+
+		uint64_t idx = 0;
+		for (int i = m_base4Digits - 1; i >= last_digit; i--) {
+			const int digit_shift = 2 * i - (pow2_samples ? 1 : 0);
+			const int digit = (m_mortonIdx >> digit_shift) & 3;
+			const uint64_t higher_digits = m_mortonIdx >> (digit_shift + 2);
+			const int p = (MixBits(higher_digits ^ dim_hash ^ m_passSeed) >> 24) % 24;
+			idx |= uint64_t(DIGIT_PERMUTATIONS[p][digit]) << digit_shift;
+		}
+
+		// An odd power of two leaves a single base 2 digit
+		if (pow2_samples) {
+			const uint64_t digit = m_mortonIdx & 1;
+			idx |= digit ^ (MixBits((m_mortonIdx >> 1) ^ dim_hash ^ m_passSeed) & 1);
+		}
+
+		return idx;
+	}
+
+	float ZSobolSampler::scrambledSample(uint64_t idx, const int sobol_dim, const uint32_t seed) const {
+		uint32_t v = 0;
+		for (int i = sobol_dim * sobol_matrix_size + sobol_matrix_size - 1; idx; idx >>= 1, i--) {
+			if (idx & 1)
+				v ^= sobol_matrices32[i];
+		}
+
+		v = FastOwenScramble(v, seed);
+		return Min(FLOAT_ONE_MINUS_EPSILON, v * 2.3283064365386963e-10f); /* 1 / 2^32 */
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef AYA_SAMPLER_ZSOBOLSAMPLER_H
+#define AYA_SAMPLER_ZSOBOLSAMPLER_H
+
+#include <Samplers/SobolMatrices.h>
+#include <Core/Sampler.h>
+
+namespace Aya {
+	// Owen scrambled Sobol points enumerated in Morton order over the image (Ahmed and Wonka 2020),
+	// neighbouring pixels receive decorrelated parts of one well distributed global sequence
+	class ZSobolSampler : public Sampler {
+	private:
+		// Dimensions reserved for each stream of a pixel, every dimension is hashed so there is no table limit
+		static const uint32_t STREAM_DIMENSIONS = 1 << 12;
+
+		uint64_t m_seed;
+		int m_log2Spp, m_base4Digits;
+		uint64_t m_sampleIdx;
+		// Seed of the current generation, passes past the sample count start a new randomization
+		uint64_t m_passSeed;
+		uint64_t m_mortonIdx;
+		uint32_t m_dim;
+
+	public:
+		ZSobolSampler() = default;
+		ZSobolSampler(const int rx, const int ry, const int spp, const uint64_t seed = 0);
+
+		void generateSamples(
+			const int pixel_x,
+			const int pixel_y,
+			CameraSample *samples,
+			RNG &rng
+		) override;
+		void advanceSampleIndex() override;
+
+		void startPixel(const int pixel_x, const int pixel_y) override;
+		void startStream(const int stream) override;
+		float get1D() override;
+		Vector2f get2D() override;
+		Sample getSample() override;
+
+		std::unique_ptr<Sampler> clone(const int seed) const override;
+		std::unique_ptr<Sampler> deepClone() const override;
+		void reset(const Sampler *source, const int seed) override;
+
+	private:
+		void updatePassSeed();
+		uint64_t permutedSampleIndex(const uint32_t dim) const;
+		float scrambledSample(uint64_t idx, const int sobol_dim, const uint32_t seed) const;
+	};
+}
+#endif
@@ -0,0 +1,118 @@
+// Aborts a progressive render in the middle of a pass, resumes it from the checkpoint and
+// compares the result bit for bit with an uninterrupted render. Also checks that a truncated
+// or padded checkpoint is refused. Links against Core and the samplers, no scene is traced
+#include <Core/Integrator.h>
+#include <Core/Camera.h>
+#include <Core/Film.h>
+#include <Filters/GaussianFilter.h>
+#include <Samplers/RandomSampler.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Aya;
+
+static const int WIDTH = 150;
+static const int HEIGHT = 100;
+static const uint32_t SPP = 6;
+static const char *CHECKPOINT_PATH = "CheckpointResume.ayck";
+
+// Radiance from the sampler alone, raises the abort flag after a given number of samples
+class AbortingIntegrator : public TiledIntegrator {
+private:
+	TaskSynchronizer &m_owner;
+	mutable std::atomic<int> m_samples;
+	int m_abortAfter;
+
+public:
+	AbortingIntegrator(TaskSynchronizer &task, const uint32_t &spp, const int abort_after)
+		: TiledIntegrator(task, spp), m_owner(task), m_samples(0), m_abortAfter(abort_after) {
+	}
+
+	Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG& rng, MemoryPool &memory,
+		SampledWavelengths &wavelengths) const override {
+		if (++m_samples == m_abortAfter)
+			m_owner.setAbort(true);
+		return Spectrum(sampler->get1D() + Abs(ray.m_dir.x));
+	}
+};
+
+static void Render(Film *film, const int abort_after, const char *checkpoint_path) {
+	TaskSynchronizer task(WIDTH, HEIGHT);
+	Camera camera(Point3(0.f, 0.f, -5.f), Point3(0.f, 0.f, 0.f), Vector3(0.f, 1.f, 0.f), WIDTH, HEIGHT);
+	RandomSampler sampler(7);
+	AbortingIntegrator integrator(task, SPP, abort_after);
+	if (checkpoint_path)
+		integrator.setCheckpoint(checkpoint_path, 2);
+	integrator.render(nullptr, &camera, &sampler, film);
+}
+
+static int CompareFilms(const Film &a, const Film &b) {
+	int mismatches = 0;
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			const StoredSpectrum pa = a.getPixel(x, y), pb = b.getPixel(x, y);
+			if (memcmp(&pa, &pb, sizeof(StoredSpectrum)) != 0 || a.getPixelSampleCount(x, y) != b.getPixelSampleCount(x, y)) {
+				if (mismatches++ < 8)
+					printf("Pixel (%d, %d) differs\n", x, y);
+			}
+		}
+	}
+	return mismatches;
+}
+
+// Copies the checkpoint with its size changed by delta bytes
+static bool CopyResized(const char *src, const char *dst, const long delta) {
+	FILE *in = fopen(src, "rb");
+	if (!in)
+		return false;
+	std::vector<char> bytes;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+		bytes.insert(bytes.end(), buf, buf + n);
+	fclose(in);
+	bytes.resize(bytes.size() + delta, 0);
+
+	FILE *out = fopen(dst, "wb");
+	if (!out)
+		return false;
+	fwrite(bytes.data(), 1, bytes.size(), out);
+	fclose(out);
+	return true;
+}
+
+int main() {
+	int failures = 0;
+
+	Film reference(WIDTH, HEIGHT, new GaussianFilter(.5f));
+	Render(&reference, 0, nullptr);
+
+	// Abort in the middle of the fourth pass, then resume to the end
+	remove(CHECKPOINT_PATH);
+	Film resumed(WIDTH, HEIGHT, new GaussianFilter(.5f));
+	Render(&resumed, 3 * WIDTH * HEIGHT + WIDTH * HEIGHT / 3 + 17, CHECKPOINT_PATH);
+	Film resumed_end(WIDTH, HEIGHT, new GaussianFilter(.5f));
+	Render(&resumed_end, 0, CHECKPOINT_PATH);
+
+	const int mismatches = CompareFilms(reference, resumed_end);
+	printf("Resume after abort: %d pixel(s) differ from the uninterrupted render\n", mismatches);
+	failures += mismatches > 0;
+
+	// A checkpoint cut short or with bytes appended must not load
+	const char *damaged_path = "CheckpointResume_damaged.ayck";
+	for (const long delta : { -1L, 1L }) {
+		Film film(WIDTH, HEIGHT, new GaussianFilter(.5f));
+		uint32_t pass_index = 0;
+		const bool loaded = CopyResized(CHECKPOINT_PATH, damaged_path, delta) && film.loadCheckpoint(damaged_path, &pass_index);
+		printf("Checkpoint with %+ld byte(s): %s\n", delta, loaded ? "loaded" : "refused");
+		failures += loaded;
+	}
+	remove(damaged_path);
+	remove(CHECKPOINT_PATH);
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
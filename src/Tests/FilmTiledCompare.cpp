@@ -0,0 +1,93 @@
+// Renders the same image into the in-core Film and into FilmTiled and compares the PFM the
+// tiled film writes with the resolved in-core pixels. ZSobolSampler gives both paths the same
+// samples, only the summation order differs. Links against Core, Films and the samplers
+#include <Core/Integrator.h>
+#include <Core/Camera.h>
+#include <Core/Film.h>
+#include <Films/FilmTiled.h>
+#include <Filters/GaussianFilter.h>
+#include <Samplers/ZSobolSampler.h>
+
+#include <cstdio>
+#include <vector>
+
+using namespace Aya;
+
+static const int WIDTH = 173;
+static const int HEIGHT = 119;
+static const uint32_t SPP = 4;
+static const char *OUTPUT_PATH = "FilmTiledCompare.pfm";
+static const float TOLERANCE = 1e-4f;
+
+// Checkerboard of about a pixel per cell, a guard band lost at a tile border shows up
+class CheckerIntegrator : public TiledIntegrator {
+public:
+	CheckerIntegrator(const TaskSynchronizer &task, const uint32_t &spp)
+		: TiledIntegrator(task, spp) {
+	}
+
+	Spectrum li(const RayDifferential &ray, const Scene *scene, Sampler *sampler, RNG& rng, MemoryPool &memory,
+		SampledWavelengths &wavelengths) const override {
+		const int cell = int(std::floor(ray.m_dir.x * 250.f)) + int(std::floor(ray.m_dir.y * 250.f));
+		return Spectrum((cell & 1) ? 1.f : .2f) + Spectrum(.1f * sampler->get1D());
+	}
+};
+
+static void Render(Film *film) {
+	TaskSynchronizer task(WIDTH, HEIGHT);
+	Camera camera(Point3(0.f, 0.f, -5.f), Point3(0.f, 0.f, 0.f), Vector3(0.f, 1.f, 0.f), WIDTH, HEIGHT);
+	ZSobolSampler sampler(WIDTH, HEIGHT, SPP);
+	CheckerIntegrator integrator(task, SPP);
+	integrator.render(nullptr, &camera, &sampler, film);
+}
+
+static bool ReadPFM(const char *path, std::vector<float> *rgb) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	int width = 0, height = 0;
+	float scale = 0.f;
+	const bool ok = fscanf(fp, "PF\n%d %d\n%f", &width, &height, &scale) == 3 && fgetc(fp) == '\n' &&
+		width == WIDTH && height == HEIGHT;
+	rgb->resize(3 * size_t(WIDTH) * HEIGHT);
+	const bool read = ok && fread(rgb->data(), sizeof(float), rgb->size(), fp) == rgb->size();
+	fclose(fp);
+	return read;
+}
+
+int main() {
+	Film reference(WIDTH, HEIGHT, new GaussianFilter(.5f));
+	Render(&reference);
+
+	{
+		FilmTiled tiled(WIDTH, HEIGHT, new GaussianFilter(.5f), OUTPUT_PATH, RenderTile::TILE_SIZE);
+		Render(&tiled);
+	}
+
+	std::vector<float> rgb;
+	if (!ReadPFM(OUTPUT_PATH, &rgb)) {
+		printf("Cannot read %s\nFAILED\n", OUTPUT_PATH);
+		return 1;
+	}
+
+	int mismatches = 0;
+	float max_error = 0.f;
+	for (int y = 0; y < HEIGHT; y++) {
+		for (int x = 0; x < WIDTH; x++) {
+			// The in-core film keeps rows top to bottom, PFM rows are bottom to top
+			const RGBSpectrum expected = reference.getPixel(x, HEIGHT - 1 - y).toRGBSpectrum();
+			const float *got = &rgb[3 * (size_t(y) * WIDTH + x)];
+			for (int c = 0; c < 3; c++) {
+				const float error = Abs(got[c] - expected[c]) / Max(Abs(expected[c]), 1e-3f);
+				max_error = Max(max_error, error);
+				if (error > TOLERANCE && mismatches++ < 8)
+					printf("Pixel (%d, %d) channel %d: %f, in-core %f\n", x, y, c, got[c], expected[c]);
+			}
+		}
+	}
+	remove(OUTPUT_PATH);
+
+	printf("%d channel(s) differ by more than %g, largest relative error %g\n", mismatches, TOLERANCE, max_error);
+	printf(mismatches ? "FAILED\n" : "PASSED\n");
+	return mismatches ? 1 : 0;
+}
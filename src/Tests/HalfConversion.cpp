@@ -0,0 +1,43 @@
+// Checks FloatToHalf and HalfToFloat against the F16C instructions, every half value
+// and every float bit pattern. Needs a CPU with F16C, build with /arch:AVX2 or -mf16c
+#include <Math/MathUtility.h>
+
+#include <immintrin.h>
+#include <cstdio>
+
+using namespace Aya;
+
+static inline uint32_t FloatBits(const float val) {
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(float));
+	return bits;
+}
+
+int main() {
+	uint32_t failures = 0;
+
+	// Half to float, NaNs come out quiet from F16C
+	for (uint32_t h = 0; h < 0x10000; h++) {
+		const uint32_t expected = FloatBits(_cvtsh_ss(uint16_t(h)));
+		const uint32_t got = FloatBits(HalfToFloat(uint16_t(h)));
+		if (got != expected && failures++ < 16)
+			printf("HalfToFloat(0x%04x): 0x%08x, F16C 0x%08x\n", h, got, expected);
+	}
+	printf("HalfToFloat: %u mismatch(es) over 65536 halves\n", failures);
+
+	// Float to half with round to nearest even, the whole 32-bit range
+	uint32_t float_failures = 0;
+	uint32_t bits = 0;
+	do {
+		float val;
+		memcpy(&val, &bits, sizeof(float));
+		const uint16_t expected = _cvtss_sh(val, _MM_FROUND_TO_NEAREST_INT);
+		const uint16_t got = FloatToHalf(val);
+		if (got != expected && float_failures++ < 16)
+			printf("FloatToHalf(0x%08x): 0x%04x, F16C 0x%04x\n", bits, got, expected);
+	} while (++bits != 0);
+	printf("FloatToHalf: %u mismatch(es) over 2^32 floats\n", float_failures);
+
+	failures += float_failures;
+	return failures == 0 ? 0 : 1;
+}
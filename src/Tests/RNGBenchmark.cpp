@@ -0,0 +1,77 @@
+// Draws 1e8 floats from each generator and prints the wall time, the numbers next to
+// the generators in RNG.h come from this program. Build in release, add /arch:AVX2 or
+// -mavx2 for the AVX2 paths of PCG32x8 and BufferedRNG
+#include <Core/RNG.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace Aya;
+
+static const int DRAW_COUNT = 100000000;
+static const int BLOCK_SIZE = 4096;
+
+static const int RUN_COUNT = 5;
+
+// Every generator writes blocks of draws to memory, one value per block is read back
+// so the draws stay alive without a running sum bounding the loop. The fastest of
+// RUN_COUNT runs is printed, the others are disturbed by whatever else runs
+template<typename Func>
+static void Measure(const char *name, Func draw_block) {
+	std::vector<float> values(BLOCK_SIZE);
+	float check = 0.f;
+	float best_ms = 0.f;
+
+	for (int run = 0; run < RUN_COUNT; run++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < DRAW_COUNT; i += BLOCK_SIZE) {
+			draw_block(values.data());
+			check += values[(i / BLOCK_SIZE) % BLOCK_SIZE];
+		}
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best_ms = run == 0 ? ms : Min(best_ms, ms);
+	}
+	printf("%-36s %8.0f ms (mean of checked draws %.3f)\n", name, best_ms, check / (RUN_COUNT * (DRAW_COUNT / BLOCK_SIZE)));
+}
+
+int main() {
+#if defined(AYA_USE_AVX2)
+	printf("AVX2 paths enabled\n");
+#else
+	printf("AVX2 paths disabled\n");
+#endif
+
+	// Through the base class like the renderer used to, new keeps the call indirect
+	std::unique_ptr<rng> pbrt(new PbrtRNG());
+	Measure("PbrtRNG through the base class", [&](float *values) {
+		for (int j = 0; j < BLOCK_SIZE; j++)
+			values[j] = pbrt->drand48();
+	});
+
+	std::unique_ptr<rng> mt(new MT19937RNG());
+	Measure("MT19937RNG through the base class", [&](float *values) {
+		for (int j = 0; j < BLOCK_SIZE; j++)
+			values[j] = mt->drand48();
+	});
+
+	PCG32 pcg;
+	Measure("PCG32", [&](float *values) {
+		for (int j = 0; j < BLOCK_SIZE; j++)
+			values[j] = pcg.drand48();
+	});
+
+	PCG32x8 lanes;
+	Measure("PCG32x8, one fill per block", [&](float *values) {
+		lanes.fill(values, BLOCK_SIZE);
+	});
+
+	BufferedRNG buffered;
+	Measure("BufferedRNG, single draws", [&](float *values) {
+		for (int j = 0; j < BLOCK_SIZE; j++)
+			values[j] = buffered.drand48();
+	});
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+// Times bilinear and trilinear lookups into eagerly built mip levels under random and
+// coherent UVs. Build it twice in release, once as is and once with -DAYA_BLOCKED_TEXELS
+// for the Morton blocked levels, and compare the two outputs
+#include <Core/Texture.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Aya;
+
+static const int LOOKUP_COUNT = 4000000;
+
+static const int RUN_COUNT = 3;
+
+// Millions of lookups per second, the fastest of RUN_COUNT runs. The first lookup of
+// every run is read back with the rest so the loop is not dropped
+template<typename Func>
+static float Measure(Func lookup, float *check) {
+	float best_ms = 0.f;
+	for (int run = 0; run < RUN_COUNT; run++) {
+		const auto start = std::chrono::steady_clock::now();
+		float sum = 0.f;
+		for (int i = 0; i < LOOKUP_COUNT; i++)
+			sum += lookup(i);
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best_ms = run == 0 ? ms : Min(best_ms, ms);
+		*check += sum;
+	}
+	return float(LOOKUP_COUNT) / (best_ms * 1e3f);
+}
+
+template<class T>
+static void Run(const char *name, const int width, const int height) {
+	T *texels = new T[size_t(width) * height];
+	for (size_t i = 0; i < size_t(width) * height; i++)
+		texels[i] = T(RGBSpectrum((i % 97) / 97.f, (i % 13) / 13.f, .5f));
+	Mipmap2D<T> mipmap;
+	mipmap.generate(Vector2i(width, height), texels);
+	delete[] texels;
+
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<float> uniform(0.f, 1.f);
+	std::vector<Vector2f> random_uv(LOOKUP_COUNT), walk_uv(LOOKUP_COUNT);
+	for (auto &uv : random_uv)
+		uv = Vector2f(uniform(gen), uniform(gen));
+	// Short steps of a few texels, like neighbouring pixels of a tile
+	Vector2f walk(.5f, .5f);
+	for (auto &uv : walk_uv) {
+		walk.x += (uniform(gen) - .5f) * 8.f / width;
+		walk.y += (uniform(gen) - .5f) * 8.f / height;
+		walk.x -= FloorToInt(walk.x);
+		walk.y -= FloorToInt(walk.y);
+		uv = walk;
+	}
+	const Vector2f diffs[2] = { Vector2f(1.5f / width, 0.f), Vector2f(0.f, 1.5f / height) };
+
+	float check = 0.f;
+	const float bilinear = Measure([&](const int i) {
+		return RGBSpectrum(mipmap.levelLinearSample(random_uv[i], 0))[0];
+	}, &check);
+	const float trilinear = Measure([&](const int i) {
+		return RGBSpectrum(mipmap.triLinearSample(random_uv[i], diffs))[0];
+	}, &check);
+	const float coherent = Measure([&](const int i) {
+		return RGBSpectrum(mipmap.levelLinearSample(walk_uv[i], 0))[0];
+	}, &check);
+
+	printf("%-6s %5dx%-5d random bilinear %5.1f, random trilinear %5.1f, coherent bilinear %5.1f Mlookups/s (check %g)\n",
+		name, width, height, bilinear, trilinear, coherent, check);
+}
+
+int main() {
+#if defined(AYA_BLOCKED_TEXELS)
+	printf("Mip levels in 4x4 Morton blocks\n");
+#else
+	printf("Mip levels in rows\n");
+#endif
+
+	Run<RGBSpectrum>("rgb", 4096, 4096);
+	Run<sRGB8Spectrum>("srgb8", 8192, 8192);
+	Run<halfSpectrum>("half", 4096, 4096);
+
+	return 0;
+}
@@ -1,4 +1,5 @@
-#include "Core/integrator.h"
+#include "Core/Integrator.h"
+#include <ctime>
 #include "Core/Medium.h"
 #include <array>
 #include "Media/Homogeneous.h"
@@ -24,6 +25,7 @@
 
 #include "Samplers\RandomSampler.h"
 #include "Samplers\SobolSampler.h"
+#include "Samplers\ZSobolSampler.h"
 
 #include "Filters\BoxFilter.h"
 #include "Filters\GaussianFilter.h"
@@ -42,11 +44,11 @@ void ayaInit() {
 
 std::unique_ptr<BSDF> scene_parser_lambertian(const ObjMaterial &mtl) {
 	std::unique_ptr<BSDF> bsdf;
-	if (mtl.Tf != Spectrum(0.f)) {
+	if (mtl.Tf != RGBSpectrum(0.f)) {
 		bsdf = std::make_unique<Glass>(mtl.Tf, 1.f, mtl.Ni);
 	}
 	else if (mtl.Ks[0] > 0.4f) {
-		bsdf = std::make_unique<Glass>(Spectrum(1.f, 1.f, 1.f), 1.f, 1.5f);
+		bsdf = std::make_unique<Glass>(StoredSpectrum(1.f, 1.f, 1.f), 1.f, 1.5f);
 	}
 	else {
 		/*std::unique_ptr<Texture2D<float>> specular;
@@ -63,7 +65,7 @@ std::unique_ptr<BSDF> scene_parser_lambertian(const ObjMaterial &mtl) {
 		if (mtl.map_Kd[0])
 			bsdf = std::make_unique<LambertianDiffuse>(mtl.map_Kd);
 		else
-			bsdf = std::make_unique<LambertianDiffuse>(Spectrum(mtl.Kd));
+			bsdf = std::make_unique<LambertianDiffuse>(StoredSpectrum(mtl.Kd));
 	}
 	//if (mtl.map_Bump[0])
 	//	bsdf->setNormalMap(mtl.map_Bump);
@@ -72,7 +74,7 @@ std::unique_ptr<BSDF> scene_parser_lambertian(const ObjMaterial &mtl) {
 }
 RNG rr;
 std::unique_ptr<BSDF> hahaha(const ObjMaterial &mtl) {
-	return std::make_unique<Disney>(Spectrum::fromRGB(rr.drand48(), rr.drand48(), rr.drand48()),
+	return std::make_unique<Disney>(StoredSpectrum::fromRGB(rr.drand48(), rr.drand48(), rr.drand48()),
 		std::make_unique<ConstantTexture2D<float>>(0.1f),
 		std::make_unique<ConstantTexture2D<float>>(0.9f));
 }
@@ -125,12 +127,13 @@ int main(void) {
 	//mur->loadMesh(murb, "mur.obj", true);
 	RNG dr;
 	dr.srand(time(0));
+	//MemoryTracker::setBudget(size_t(4) << 30);
 	printf("Reading models...\n");
 	bunny0->loadMesh(bunnyb, "bunny.obj",
-		[](const ObjMaterial &mtl) { return std::make_unique<Glass>(Spectrum::fromRGB(1.f, 1.f, 1.f), 1.f, 2.f); }
+		[](const ObjMaterial &mtl) { return std::make_unique<Glass>(StoredSpectrum::fromRGB(1.f, 1.f, 1.f), 1.f, 2.f); }
 	, true, true);
 	bunny->loadMesh(bunnyc, "bunny.obj",
-		[](const ObjMaterial &mtl) { return std::make_unique<LambertianDiffuse>(Spectrum::fromRGB(100.f / 255.f, 149.f / 255.f, 225.0f / 255.0f)); }
+		[](const ObjMaterial &mtl) { return std::make_unique<LambertianDiffuse>(StoredSpectrum::fromRGB(100.f / 255.f, 149.f / 255.f, 225.0f / 255.0f)); }
 	, true, true);
 	//bunny->loadMesh(bunnyc, "bunny.obj", true, true, std::make_unique<Disney>(Spectrum::fromRGB(100.f / 255.f, 149.f / 255.f, 225.0f / 255.0f), 0.1f, 0.9f));
 	//plane->loadPlane(o2w, 1, std::make_unique<Disney>("background.jpg", 0.0f, 1.0f));
@@ -168,7 +171,7 @@ int main(void) {
 	//scene->addLight(new AreaLight(l1, Spectrum(10.f, 10.f, 10.f)));
 	//scene->addLight(new AreaLight(l2, Spectrum(0.f, 0, 1.f)));
 	//scene->addLight(new PointLight(Point3(0.6, 3.0, 1.2), Spectrum(1.f, 55.0 / 255.0 * 1, 0.f)));
-	scene->addLight(new PointLight(Point3(0, 3.10f, 0), Spectrum(8.f, 8.f, 8.f)));
+	scene->addLight(new PointLight(Point3(0, 3.10f, 0), StoredSpectrum(8.f, 8.f, 8.f)));
 	//scene->addLight(new AreaLight(light_p, Spectrum::fromRGB(10.f, 10.f, 10.f)));
 	//scene->addLight(new EnvironmentLight("uffizi-large.hdr", scene, 1.f));
 	//scene->addLight(new EnvironmentLight(Spectrum::fromRGB(8.f, 8.f, 8.f), scene));
@@ -186,9 +189,14 @@ int main(void) {
 	MemoryPool memory;
 	bdpt->render(scene, cam, random_sampler, film);
 	//vcm->render(scene, cam, random_sampler, film);
+	//bdpt->render(scene, cam, std::make_unique<ZSobolSampler>(testnumx, testnumy, spp).get(), film);
 	//pt->render(scene, cam, sobol_sampler , film);
 	//dl->render(scene, cam, sobol_sampler, film);
 	cout << clock() - st << endl;
 	Bitmap::save("test.bmp", (float*)film->getPixelBuffer(), testnumx, testnumy, RGBA_32);
+	std::vector<float> hdr;
+	film->resolveLinear(&hdr);
+	Bitmap::saveAsync("test.exr", hdr.data(), testnumx, testnumy, RGBA_32);
+	Bitmap::waitAsync();
 	return 0;
 }
\ No newline at end of file